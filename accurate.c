@@ -0,0 +1,337 @@
+#include <float.h>
+#include <stdint.h>
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "accurate.h"
+#include "kernels.h"
+
+// =============================================================== \\
+// Scalar versions
+
+// Kahan compensation: the low order bits lost by each addition are added back to the next value
+// (Neumaier's variant keeps them aside until the end, but then the compensation itself stalls once it reaches 2^24)
+__attribute__((optimize("no-tree-vectorize")))
+float norm_kahan(float *U, size_t N) {
+    float s = 0.0f;
+    float c = 0.0f;
+
+    for (size_t i = 0; i < N; i++) {
+        float y = sqrtf(fabsf(U[i])) - c;
+        float t = s + y;
+
+        // Low order bits lost by the addition (with the opposite sign)
+        c = (t - s) - y;
+        s = t;
+    }
+
+    return s;
+}
+
+// The error grows with log(N) instead of N
+float norm_pairwise(float *U, size_t N) {
+    if (N <= PAIRWISE_BLOCK)
+        return norm(U, N);
+
+    size_t half = N / 2;
+
+    return norm_pairwise(U, half) + norm_pairwise(U + half, N - half);
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+float norm_double(float *U, size_t N) {
+    double d = 0;
+
+    for (size_t i = 0; i < N; i++)
+        d += sqrtf(fabsf(U[i]));
+
+    return (float) d;
+}
+
+// x * rsqrt(x) with the scalar SSE instruction (part of x86-64), same approximation as the vector one
+static inline float sqrt_rsqrt_ss(float x, int newton) {
+    float r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+
+    // Newton-Raphson on 1/sqrt(x): r' = r * (1.5 - 0.5 * x * r * r), the error goes from e to about 1.5 * e^2
+    if (newton)
+        r = r * (1.5f - 0.5f * x * r * r);
+
+    // rsqrt(0) = inf and 0 * inf = NaN (denormals are flushed to 0 by rsqrt), a NaN input stays NaN
+    return x < FLT_MIN ? 0.0f : x * r;
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+float norm_rsqrt(float *U, size_t N) {
+    float d = 0.0f;
+
+    for (size_t i = 0; i < N; i++)
+        d += sqrt_rsqrt_ss(fabsf(U[i]), 0);
+
+    return d;
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+float norm_rsqrt_newton(float *U, size_t N) {
+    float d = 0.0f;
+
+    for (size_t i = 0; i < N; i++)
+        d += sqrt_rsqrt_ss(fabsf(U[i]), 1);
+
+    return d;
+}
+
+// =============================================================== \\
+// AVX2 versions
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+// Mask selecting the n first lanes of a vector (n <= 8)
+static inline __m256i first_lanes(unsigned int n) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32((int) n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+// One Kahan step on each lane
+static inline __m256 kahan(__m256 s, __m256 x, __m256 *c) {
+    __m256 y = _mm256_sub_ps(x, *c);
+    __m256 t = _mm256_add_ps(s, y);
+
+    *c = _mm256_sub_ps(_mm256_sub_ps(t, s), y);
+
+    return t;
+}
+
+float vect_norm_kahan_avx2(float *U, size_t N) {
+    // Two independent (sum, compensation) pairs to hide the latency
+    __m256 s0 = _mm256_setzero_ps(), c0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps(), c1 = _mm256_setzero_ps();
+
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+
+    size_t i = 0;
+
+    for (; i + 16 <= N; i += 16) {
+        s0 = kahan(s0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i))), &c0);
+        s1 = kahan(s1, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i + 8))), &c1);
+    }
+
+    for (; i + 8 <= N; i += 8)
+        s0 = kahan(s0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i))), &c0);
+
+    // Tail: the masked lanes are loaded as 0
+    if (i < N) {
+        __m256 x = _mm256_maskload_ps(U + i, first_lanes((unsigned int) (N - i)));
+        s0 = kahan(s0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, x)), &c0);
+    }
+
+    // The 16 partial sums are added in double, minus what is left in the compensations, then rounded once
+    float s0_f[8], c0_f[8], s1_f[8], c1_f[8];
+    _mm256_storeu_ps(s0_f, s0);
+    _mm256_storeu_ps(c0_f, c0);
+    _mm256_storeu_ps(s1_f, s1);
+    _mm256_storeu_ps(c1_f, c1);
+
+    double result = 0;
+    for (unsigned int k = 0; k < 8; k++)
+        result += (double) s0_f[k] + (double) s1_f[k] - (double) c0_f[k] - (double) c1_f[k];
+
+    return (float) result;
+}
+
+float vect_norm_pairwise_avx2(float *U, size_t N) {
+    if (N <= PAIRWISE_BLOCK)
+        return vect_norm_avx2(U, N);
+
+    // Multiple of 8 to keep the second half as aligned as U
+    size_t half = (N / 2) & ~(size_t) 7;
+
+    return vect_norm_pairwise_avx2(U, half) + vect_norm_pairwise_avx2(U + half, N - half);
+}
+
+// sqrt in float (as the other kernels), then each half of the vector is widened to 4 doubles
+static inline void add_widened(__m256 x, __m256d *lo, __m256d *hi) {
+    *lo = _mm256_add_pd(*lo, _mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+    *hi = _mm256_add_pd(*hi, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+}
+
+float vect_norm_double_avx2(float *U, size_t N) {
+    __m256d lo0 = _mm256_setzero_pd(), hi0 = _mm256_setzero_pd();
+    __m256d lo1 = _mm256_setzero_pd(), hi1 = _mm256_setzero_pd();
+
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+
+    size_t i = 0;
+
+    for (; i + 16 <= N; i += 16) {
+        add_widened(_mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i))), &lo0, &hi0);
+        add_widened(_mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i + 8))), &lo1, &hi1);
+    }
+
+    for (; i + 8 <= N; i += 8)
+        add_widened(_mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i))), &lo0, &hi0);
+
+    if (i < N) {
+        __m256 x = _mm256_maskload_ps(U + i, first_lanes((unsigned int) (N - i)));
+        add_widened(_mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, x)), &lo0, &hi0);
+    }
+
+    __m256d acc = _mm256_add_pd(_mm256_add_pd(lo0, hi0), _mm256_add_pd(lo1, hi1));
+
+    double acc_d[4];
+    _mm256_storeu_pd(acc_d, acc);
+
+    return (float) (acc_d[0] + acc_d[1] + acc_d[2] + acc_d[3]);
+}
+
+// Vector version of sqrt_rsqrt_ss
+static inline __attribute__((always_inline)) __m256 sqrt_rsqrt(__m256 x, const int newton) {
+    __m256 r = _mm256_rsqrt_ps(x);
+
+    if (newton) {
+        __m256 xrr = _mm256_mul_ps(_mm256_mul_ps(x, r), r);
+        r = _mm256_mul_ps(r, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(_mm256_set1_ps(0.5f), xrr)));
+    }
+
+    // Zero (and denormal) lanes: 0 instead of 0 * inf, the comparison is false for NaN which goes through
+    return _mm256_andnot_ps(_mm256_cmp_ps(x, _mm256_set1_ps(FLT_MIN), _CMP_LT_OQ), _mm256_mul_ps(x, r));
+}
+
+// 4 accumulators as the fast kernel: without the sqrt the adds are the bottleneck again
+static inline __attribute__((always_inline)) float vect_norm_rsqrt_body(float *U, size_t N, const int newton) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+
+    size_t i = 0;
+
+    for (; i + 32 <= N; i += 32) {
+        acc0 = _mm256_add_ps(acc0, sqrt_rsqrt(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i)), newton));
+        acc1 = _mm256_add_ps(acc1, sqrt_rsqrt(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i + 8)), newton));
+        acc2 = _mm256_add_ps(acc2, sqrt_rsqrt(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i + 16)), newton));
+        acc3 = _mm256_add_ps(acc3, sqrt_rsqrt(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i + 24)), newton));
+    }
+
+    for (; i + 8 <= N; i += 8)
+        acc0 = _mm256_add_ps(acc0, sqrt_rsqrt(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i)), newton));
+
+    // Tail: the masked lanes are loaded as 0, which gives 0
+    if (i < N) {
+        __m256 x = _mm256_maskload_ps(U + i, first_lanes((unsigned int) (N - i)));
+        acc0 = _mm256_add_ps(acc0, sqrt_rsqrt(_mm256_andnot_ps(sign_mask, x), newton));
+    }
+
+    acc0 = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+
+    float acc_f[8];
+    _mm256_storeu_ps(acc_f, acc0);
+
+    float result = 0;
+    for (unsigned int k = 0; k < 8; k++)
+        result += acc_f[k];
+
+    return result;
+}
+
+float vect_norm_rsqrt_avx2(float *U, size_t N) {
+    return vect_norm_rsqrt_body(U, N, 0);
+}
+
+float vect_norm_rsqrt_newton_avx2(float *U, size_t N) {
+    return vect_norm_rsqrt_body(U, N, 1);
+}
+
+void sqrt_approx_avx2(const float *U, float *out, size_t N, int newton) {
+    size_t i = 0;
+
+    for (; i + 8 <= N; i += 8) {
+        __m256 x = _mm256_loadu_ps(U + i);
+        _mm256_storeu_ps(out + i, newton ? sqrt_rsqrt(x, 1) : sqrt_rsqrt(x, 0));
+    }
+
+    for (; i < N; i++)
+        out[i] = sqrt_rsqrt_ss(U[i], newton);
+}
+
+#pragma GCC pop_options
+
+// =============================================================== \\
+// Selection
+
+// The kernel selected at startup (SIMDNORM_KERNEL) or by kernel_select: below AVX2 the scalar versions, as vect_norm
+
+float vect_norm_kahan(float *U, size_t N) {
+    return kernel_current() >= KERNEL_AVX2 ? vect_norm_kahan_avx2(U, N) : norm_kahan(U, N);
+}
+
+float vect_norm_pairwise(float *U, size_t N) {
+    return kernel_current() >= KERNEL_AVX2 ? vect_norm_pairwise_avx2(U, N) : norm_pairwise(U, N);
+}
+
+float vect_norm_double(float *U, size_t N) {
+    return kernel_current() >= KERNEL_AVX2 ? vect_norm_double_avx2(U, N) : norm_double(U, N);
+}
+
+float vect_norm_rsqrt(float *U, size_t N) {
+    return kernel_current() >= KERNEL_AVX2 ? vect_norm_rsqrt_avx2(U, N) : norm_rsqrt(U, N);
+}
+
+float vect_norm_rsqrt_newton(float *U, size_t N) {
+    return kernel_current() >= KERNEL_AVX2 ? vect_norm_rsqrt_newton_avx2(U, N) : norm_rsqrt_newton(U, N);
+}
+
+void sqrt_approx_scalar(const float *U, float *out, size_t N, int newton) {
+    for (size_t i = 0; i < N; i++)
+        out[i] = sqrt_rsqrt_ss(U[i], newton);
+}
+
+void sqrt_approx(const float *U, float *out, size_t N, int newton) {
+    if (kernel_current() >= KERNEL_AVX2)
+        sqrt_approx_avx2(U, out, N, newton);
+    else
+        sqrt_approx_scalar(U, out, N, newton);
+}
+
+float norm_accurate(float *U, size_t N, int accuracy) {
+    switch (accuracy) {
+        case ACCURACY_KAHAN:
+            return norm_kahan(U, N);
+        case ACCURACY_PAIRWISE:
+            return norm_pairwise(U, N);
+        case ACCURACY_DOUBLE:
+            return norm_double(U, N);
+        case ACCURACY_RSQRT:
+            return norm_rsqrt(U, N);
+        case ACCURACY_RSQRT_NEWTON:
+            return norm_rsqrt_newton(U, N);
+        default:
+            return norm(U, N);
+    }
+}
+
+float vect_norm_accurate(float *U, size_t N, int accuracy) {
+    switch (accuracy) {
+        case ACCURACY_KAHAN:
+            return vect_norm_kahan(U, N);
+        case ACCURACY_PAIRWISE:
+            return vect_norm_pairwise(U, N);
+        case ACCURACY_DOUBLE:
+            return vect_norm_double(U, N);
+        case ACCURACY_RSQRT:
+            return vect_norm_rsqrt(U, N);
+        case ACCURACY_RSQRT_NEWTON:
+            return vect_norm_rsqrt_newton(U, N);
+        default:
+            return vect_norm(U, N);
+    }
+}
+
+const char *accuracy_name(int accuracy) {
+    static const char *names[ACCURACY_COUNT] = {"fast", "kahan", "pairwise", "double", "rsqrt", "rsqrt_newton"};
+
+    if (accuracy < 0 || accuracy >= ACCURACY_COUNT)
+        return "unknown";
+
+    return names[accuracy];
+}
@@ -0,0 +1,66 @@
+#ifndef ACCURATE_H
+#define ACCURATE_H
+
+#include <stddef.h>
+
+// Accuracy modes of the norm
+// Once a float accumulator reaches 2^24 adding a value <= 1 is a no-op: the scalar norm stalls at 2^24 and each lane
+// of the vectorized one does the same once N is a few hundred millions. The modes below trade some throughput for it
+#define ACCURACY_FAST 0       // plain float accumulation (vect_norm)
+#define ACCURACY_KAHAN 1      // Kahan compensation, one compensation term per lane
+#define ACCURACY_PAIRWISE 2   // blocks of PAIRWISE_BLOCK floats added pairwise
+#define ACCURACY_DOUBLE 3     // float -> double widening accumulation
+// Approximate square roots, for the ranking like uses: sqrt(x) ~ x * rsqrt(x) (plain float accumulation)
+// rsqrt has a much better throughput than sqrt but only 11-12 correct bits
+#define ACCURACY_RSQRT 4          // no refinement, relative error <= 1.5 * 2^-12
+#define ACCURACY_RSQRT_NEWTON 5   // one Newton-Raphson step on rsqrt, about 1e-7 relative error
+#define ACCURACY_COUNT 6
+
+// Max error of the approximate square roots in ULP, on every positive normal float
+// RSQRT: from Intel's bound on rsqrt (1.5 * 2^-12, i.e. 6144 ULP of a result in [1, 2)), NEWTON: measured (4096 and
+// 4 ULP at most on my machine). Both are checked over all the float32 inputs by `projetrsqrt check`
+// Zero, denormal and negative zero inputs give 0 (rsqrt flushes denormals), infinities and NaN give NaN
+#define RSQRT_MAX_ULP 6144
+#define RSQRT_NEWTON_MAX_ULP 4
+
+// Size of the blocks of the pairwise mode (summed with the fast kernel, then added pairwise)
+#ifndef PAIRWISE_BLOCK
+#define PAIRWISE_BLOCK 1024
+#endif
+
+// Scalar versions
+float norm_kahan(float *U, size_t N);
+float norm_pairwise(float *U, size_t N);
+float norm_double(float *U, size_t N);
+float norm_rsqrt(float *U, size_t N);
+float norm_rsqrt_newton(float *U, size_t N);
+
+// AVX2 versions, they can only be called if the CPU supports AVX2 (see kernel_supported)
+// U can have any alignment and N any value, they can be given to the reduction engine as kernels
+float vect_norm_kahan_avx2(float *U, size_t N);
+float vect_norm_pairwise_avx2(float *U, size_t N);
+float vect_norm_double_avx2(float *U, size_t N);
+float vect_norm_rsqrt_avx2(float *U, size_t N);
+float vect_norm_rsqrt_newton_avx2(float *U, size_t N);
+
+// Vectorized versions: the AVX2 ones if the selected kernel (kernel_current, SIMDNORM_KERNEL) is at least AVX2,
+// the scalar ones otherwise, as vect_norm
+float vect_norm_kahan(float *U, size_t N);
+float vect_norm_pairwise(float *U, size_t N);
+float vect_norm_double(float *U, size_t N);
+float vect_norm_rsqrt(float *U, size_t N);
+float vect_norm_rsqrt_newton(float *U, size_t N);
+
+// Approximate square roots themselves: out[i] ~ sqrt(U[i]), as computed by the rsqrt modes (for the error checks)
+// sqrt_approx follows the selected kernel as the functions above
+void sqrt_approx(const float *U, float *out, size_t N, int newton);
+void sqrt_approx_scalar(const float *U, float *out, size_t N, int newton);
+void sqrt_approx_avx2(const float *U, float *out, size_t N, int newton);
+
+// Norm with the given accuracy mode, chosen per call
+float norm_accurate(float *U, size_t N, int accuracy);
+float vect_norm_accurate(float *U, size_t N, int accuracy);
+
+const char *accuracy_name(int accuracy);
+
+#endif //ACCURATE_H
@@ -0,0 +1,283 @@
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "async.h"
+#include "numa.h"
+
+double async_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (double) t.tv_sec + (double) t.tv_nsec * 1E-9;
+}
+
+static void unref(async_future_t *future) {
+    if (atomic_fetch_sub_explicit(&future->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+    if (future->fd >= 0)
+        close(future->fd);
+    pthread_cond_destroy(&future->cond);
+    pthread_mutex_destroy(&future->lock);
+    free(future);
+}
+
+// Publish the result, wake up the waiters and signal the eventfd
+static void complete(async_t *async, async_future_t *future, float result) {
+    pthread_mutex_lock(&future->lock);
+    future->result = result;
+    future->completed = async_now();
+    atomic_store_explicit(&future->done, 1, memory_order_release);
+
+    if (future->fd >= 0) {
+        uint64_t one = 1;
+        ssize_t r = write(future->fd, &one, sizeof(one));
+        (void) r;
+    }
+
+    pthread_cond_broadcast(&future->cond);
+    pthread_mutex_unlock(&future->lock);
+
+    atomic_fetch_add_explicit(&async->requests, 1, memory_order_relaxed);
+    unref(future);
+}
+
+// The dispatcher: big arrays one by one over every thread, consecutive small ones in a single batch
+static void *dispatch(void *args) {
+    async_t *async = (async_t *) args;
+    async_future_t *batch[ASYNC_BATCH];
+    const float *ptrs[ASYNC_BATCH];
+    size_t lens[ASYNC_BATCH];
+    float out[ASYNC_BATCH];
+
+    pthread_mutex_lock(&async->lock);
+    for (;;) {
+        while (async->head == NULL && !async->stop)
+            pthread_cond_wait(&async->cond, &async->lock);
+
+        // Stopped and drained
+        if (async->head == NULL)
+            break;
+
+        unsigned int count = 0;
+        if (async->head->N >= ASYNC_SMALL) {
+            batch[count++] = async->head;
+            async->head = async->head->next;
+        } else {
+            while (async->head != NULL && async->head->N < ASYNC_SMALL && count < ASYNC_BATCH) {
+                batch[count++] = async->head;
+                async->head = async->head->next;
+            }
+        }
+        if (async->head == NULL)
+            async->tail = NULL;
+        async->queued -= count;
+
+        pthread_mutex_unlock(&async->lock);
+
+        if (count == 1) {
+            complete(async, batch[0], simdnorm_l1sqrt(async->ctx, batch[0]->U, batch[0]->N));
+        } else {
+            for (unsigned int k = 0; k < count; k++) {
+                ptrs[k] = batch[k]->U;
+                lens[k] = batch[k]->N;
+            }
+
+            simdnorm_l1sqrt_batch(async->ctx, ptrs, lens, count, out);
+
+            for (unsigned int k = 0; k < count; k++)
+                complete(async, batch[k], out[k]);
+            atomic_fetch_add_explicit(&async->batched, count, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&async->jobs, 1, memory_order_relaxed);
+
+        pthread_mutex_lock(&async->lock);
+    }
+    pthread_mutex_unlock(&async->lock);
+
+    return NULL;
+}
+
+// The pool is created by the dispatcher itself: the pool_run calls come from it
+typedef struct {
+    async_t *async;
+    unsigned int nb_thread;
+    int pin;
+    // 1 once ctx is published, -1 if it could not be created
+    int started;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} start_t;
+
+static void *start(void *args) {
+    start_t *s = (start_t *) args;
+    async_t *async = s->async;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(s->nb_thread);
+
+    // The dispatcher is the worker 0: pinned along with the others
+    if (ctx != NULL && s->pin)
+        numa_pin_pool(ctx->pool);
+
+    pthread_mutex_lock(&s->lock);
+    async->ctx = ctx;
+    s->started = ctx != NULL ? 1 : -1;
+    pthread_cond_signal(&s->ready);
+    pthread_mutex_unlock(&s->lock);
+
+    if (ctx == NULL)
+        return NULL;
+
+    // s is gone once ctx is published
+    return dispatch(async);
+}
+
+async_t *async_create(unsigned int nb_thread, int pin) {
+    async_t *async = (async_t *) calloc(1, sizeof(async_t));
+
+    pthread_mutex_init(&async->lock, NULL);
+    pthread_cond_init(&async->cond, NULL);
+    atomic_init(&async->requests, 0);
+    atomic_init(&async->jobs, 0);
+    atomic_init(&async->batched, 0);
+
+    start_t s = {async, nb_thread, pin, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+    pthread_mutex_lock(&s.lock);
+    int created = pthread_create(&async->dispatcher, NULL, start, &s) == 0;
+    while (created && s.started == 0)
+        pthread_cond_wait(&s.ready, &s.lock);
+    pthread_mutex_unlock(&s.lock);
+
+    // No dispatcher, or no pool for it
+    if (!created || s.started < 0) {
+        if (created)
+            pthread_join(async->dispatcher, NULL);
+        pthread_mutex_destroy(&s.lock);
+        pthread_cond_destroy(&s.ready);
+        pthread_cond_destroy(&async->cond);
+        pthread_mutex_destroy(&async->lock);
+        free(async);
+        return NULL;
+    }
+
+    return async;
+}
+
+simdnorm_ctx_t *async_context(async_t *async) {
+    return async->ctx;
+}
+
+void async_destroy(async_t *async) {
+    pthread_mutex_lock(&async->lock);
+    async->stop = 1;
+    pthread_cond_signal(&async->cond);
+    pthread_mutex_unlock(&async->lock);
+
+    pthread_join(async->dispatcher, NULL);
+
+    simdnorm_destroy(async->ctx);
+    pthread_cond_destroy(&async->cond);
+    pthread_mutex_destroy(&async->lock);
+    free(async);
+}
+
+async_future_t *async_submit(async_t *async, const float *U, size_t N) {
+    async_future_t *future = (async_future_t *) malloc(sizeof(async_future_t));
+
+    future->U = U;
+    future->N = N;
+    future->result = NAN;
+    atomic_init(&future->done, 0);
+    atomic_init(&future->refs, 2);
+    future->fd = -1;
+    future->next = NULL;
+    future->completed = 0;
+
+    // The condition variable of the timed waits runs on CLOCK_MONOTONIC
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&future->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&future->lock, NULL);
+
+    future->submitted = async_now();
+
+    pthread_mutex_lock(&async->lock);
+    if (async->tail != NULL)
+        async->tail->next = future;
+    else
+        async->head = future;
+    async->tail = future;
+    async->queued++;
+    pthread_cond_signal(&async->cond);
+    pthread_mutex_unlock(&async->lock);
+
+    return future;
+}
+
+int async_poll(async_future_t *future) {
+    return atomic_load_explicit(&future->done, memory_order_acquire);
+}
+
+int async_wait(async_future_t *future, double timeout) {
+    if (async_poll(future))
+        return 0;
+    if (timeout == 0)
+        return -1;
+
+    struct timespec deadline;
+    if (timeout > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        double t = (double) deadline.tv_sec + (double) deadline.tv_nsec * 1E-9 + timeout;
+        deadline.tv_sec = (time_t) t;
+        deadline.tv_nsec = (long) ((t - (double) deadline.tv_sec) * 1E9);
+    }
+
+    pthread_mutex_lock(&future->lock);
+    while (!atomic_load_explicit(&future->done, memory_order_acquire)) {
+        if (timeout < 0) {
+            pthread_cond_wait(&future->cond, &future->lock);
+        } else if (pthread_cond_timedwait(&future->cond, &future->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&future->lock);
+
+    return async_poll(future) ? 0 : -1;
+}
+
+float async_result(async_future_t *future) {
+    return async_poll(future) ? future->result : NAN;
+}
+
+int async_eventfd(async_future_t *future) {
+    pthread_mutex_lock(&future->lock);
+
+    if (future->fd < 0) {
+        future->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        // Already done: nobody will write it anymore
+        if (future->fd >= 0 && atomic_load_explicit(&future->done, memory_order_acquire)) {
+            uint64_t one = 1;
+            ssize_t r = write(future->fd, &one, sizeof(one));
+            (void) r;
+        }
+    }
+
+    int fd = future->fd;
+    pthread_mutex_unlock(&future->lock);
+
+    return fd;
+}
+
+void async_release(async_future_t *future) {
+    unref(future);
+}
@@ -0,0 +1,102 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "simdnorm.h"
+
+// Non-blocking norms: async_submit queues the array and returns a future at once, a dispatcher thread runs the
+// queue on the pool of its own context (the dispatcher is the worker 0 of the pool, so the threads of the
+// calling program never compute). The caller polls the future, waits for it with a timeout, or registers its
+// eventfd in an epoll set
+//
+// The queue is served in the order of submission. Consecutive small arrays at the head of the queue go together
+// in a single batch (simdnorm_l1sqrt_batch: one array per thread instead of each array split over the threads),
+// the big ones alone, split over every thread
+
+// Arrays smaller than this (floats) are batched
+#ifndef ASYNC_SMALL
+#define ASYNC_SMALL ((size_t) 1 << 16)
+#endif
+
+// Arrays per batch
+#ifndef ASYNC_BATCH
+#define ASYNC_BATCH 64
+#endif
+
+typedef struct async_future {
+    const float *U;
+    size_t N;
+    float result;
+
+    // Set (release) once result is written
+    atomic_int done;
+    // Held by the submitter and by the dispatcher, the last one frees the future
+    atomic_int refs;
+
+    // For async_wait and the eventfd (created on demand)
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int fd;
+
+    // CLOCK_MONOTONIC seconds, for the latencies
+    double submitted;
+    double completed;
+
+    struct async_future *next;
+} async_future_t;
+
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    pthread_t dispatcher;
+
+    // Queue of the futures not started yet
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    async_future_t *head;
+    async_future_t *tail;
+    size_t queued;
+    int stop;
+
+    // Statistics: requests completed, pool jobs (batches or big arrays) run, requests which went in a batch
+    atomic_ullong requests;
+    atomic_ullong jobs;
+    atomic_ullong batched;
+} async_t;
+
+// Start a dispatcher with a pool of nb_thread threads (the dispatcher included)
+// With pin, each thread of the pool is pinned on a core (numa_pin_pool), by the dispatcher itself
+// NULL if the dispatcher thread or its pool could not be started
+async_t *async_create(unsigned int nb_thread, int pin);
+
+// Context of the dispatcher: its kernel / accuracy / reduction can only be changed before the first submit
+simdnorm_ctx_t *async_context(async_t *async);
+
+// Finish every request already queued, then stop the threads (the futures stay valid until released)
+void async_destroy(async_t *async);
+
+// Queue the l1sqrt of U[0, N), U has to stay valid until the future is done. Never blocks on a computation
+async_future_t *async_submit(async_t *async, const float *U, size_t N);
+
+// 1 if the result is available
+int async_poll(async_future_t *future);
+
+// Wait at most timeout seconds (forever if timeout < 0). Returns 0 if the result is available, -1 otherwise
+int async_wait(async_future_t *future, double timeout);
+
+// Result of a done future (NAN before)
+float async_result(async_future_t *future);
+
+// eventfd which becomes readable (a counter of 1) once the future is done, for epoll / poll / select
+// Created on the first call, closed by async_release. -1 if it could not be created
+int async_eventfd(async_future_t *future);
+
+// The caller does not need the future anymore (even if it is not done yet: the dispatcher frees it then)
+void async_release(async_future_t *future);
+
+// CLOCK_MONOTONIC in seconds, the clock of submitted / completed
+double async_now();
+
+#endif //ASYNC_H
@@ -0,0 +1,208 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <math.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "async.h"
+#include "harness.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Requests in flight per submitter
+#define DEPTH 8
+// One big request out of BIG_EVERY
+#define BIG_EVERY 16
+#define MAX_SAMPLES (1 << 20)
+
+typedef struct {
+    async_t *async;
+    const float *U;
+    size_t small;
+    size_t big;
+    double duration;
+    unsigned int id;
+
+    // Results: latencies (submit -> completion) and the longest async_submit call
+    double *latencies;
+    unsigned int count;
+    double max_submit;
+} submitter_t;
+
+void *submitter(void *args) {
+    submitter_t *s = (submitter_t *) args;
+    async_future_t *ring[DEPTH];
+    unsigned int head = 0, in_flight = 0;
+    unsigned long k = s->id;
+
+    double end = async_now() + s->duration;
+    while (async_now() < end || in_flight > 0) {
+        // Oldest request done (or the ring is full, or we are draining): collect it
+        if (in_flight == DEPTH || (in_flight > 0 && async_now() >= end) ||
+            (in_flight > 0 && async_poll(ring[head]))) {
+            async_future_t *f = ring[head];
+            async_wait(f, -1);
+            if (s->count < MAX_SAMPLES)
+                s->latencies[s->count++] = f->completed - f->submitted;
+            async_release(f);
+            head = (head + 1) % DEPTH;
+            in_flight--;
+            continue;
+        }
+
+        // The small arrays start anywhere in U
+        size_t n = (k % BIG_EVERY == 0) ? s->big : s->small;
+        size_t offset = (k * 2654435761u) % (s->big - n + 1);
+        k++;
+
+        double t = async_now();
+        ring[(head + in_flight) % DEPTH] = async_submit(s->async, s->U + offset, n);
+        t = async_now() - t;
+        if (t > s->max_submit)
+            s->max_submit = t;
+        in_flight++;
+    }
+
+    return NULL;
+}
+
+// An event loop: every future in an epoll set through its eventfd, the results checked against a direct call
+int event_loop(async_t *async, simdnorm_ctx_t *ctx, const float *U, size_t small, size_t big) {
+    const unsigned int count = 64;
+    async_future_t *futures[64];
+    int ok = 1;
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    for (unsigned int k = 0; k < count; k++) {
+        size_t n = (k % BIG_EVERY == 0) ? big : small;
+        futures[k] = async_submit(async, U + (k * 977) % (big - n + 1), n);
+
+        struct epoll_event ev = {EPOLLIN, {.u32 = k}};
+        epoll_ctl(ep, EPOLL_CTL_ADD, async_eventfd(futures[k]), &ev);
+    }
+
+    unsigned int done = 0;
+    while (done < count) {
+        struct epoll_event events[16];
+        int nb = epoll_wait(ep, events, 16, 1000);
+        if (nb <= 0) {
+            ok = 0;
+            break;
+        }
+
+        for (int e = 0; e < nb; e++) {
+            async_future_t *f = futures[events[e].data.u32];
+            epoll_ctl(ep, EPOLL_CTL_DEL, async_eventfd(f), NULL);
+
+            float expected = simdnorm_l1sqrt(ctx, f->U, f->N);
+            ok &= async_poll(f) && fabsf(async_result(f) - expected) <= 1E-5f * expected;
+            done++;
+        }
+    }
+
+    close(ep);
+    for (unsigned int k = 0; k < count; k++)
+        async_release(futures[k]);
+
+    return ok;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of threads of the pool
+    unsigned int nb_thread = argc > 1 ? (unsigned int) atoi(argv[1]) : 2;
+
+    // Seconds per number of submitters
+    double duration = argc > 2 ? atof(argv[2]) : 1.0;
+
+    // Sizes of the small and of the big requests
+    size_t small = argc > 3 ? (size_t) strtoull(argv[3], NULL, 10) : 4096;
+    size_t big = argc > 4 ? (size_t) strtoull(argv[4], NULL, 10) : (size_t) 1 << 22;
+
+    if (small == 0 || big < small) {
+        printf("Usage: %s [nb_threads] [seconds] [small_elts] [big_elts >= small_elts]\n", argv[0]);
+        exit(1);
+    }
+
+    async_t *async = async_create(nb_thread, 0);
+    if (async == NULL) {
+        printf("Could not start the dispatcher\n");
+        exit(1);
+    }
+    simdnorm_ctx_t *ctx = simdnorm_create(1);
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * big + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+    simdnorm_generate(ctx, U, big, PRNG_UNIFORM, -1.0f, 1.0f, (unsigned long long) time(NULL));
+
+    printf("%u threads, kernel %s, requests of %zu floats, 1 in %d of %zu floats, %d in flight per submitter\n",
+           nb_thread, kernel_name(kernel_current()), small, BIG_EVERY, big, DEPTH);
+
+    int ok = event_loop(async, ctx, U, small, big);
+    printf("epoll on the eventfds, results checked: %s\n", ok ? "OK" : "FAILED");
+
+    printf("submitters, requests/s, p50 latency s, p99 latency s, max latency s, longest submit s, batched %%\n");
+    const unsigned int counts[4] = {1, 2, 4, 8};
+    for (int c = 0; c < 4; c++) {
+        unsigned int nb_sub = counts[c];
+        submitter_t *subs = (submitter_t *) calloc(nb_sub, sizeof(submitter_t));
+        pthread_t *threads = (pthread_t *) malloc(sizeof(pthread_t) * nb_sub);
+
+        unsigned long long requests = atomic_load(&async->requests), batched = atomic_load(&async->batched);
+        double start = async_now();
+
+        for (unsigned int i = 0; i < nb_sub; i++) {
+            submitter_t s = {async, U, small, big, duration, i, (double *) malloc(sizeof(double) * MAX_SAMPLES), 0, 0};
+            subs[i] = s;
+            pthread_create(&threads[i], NULL, submitter, &subs[i]);
+        }
+
+        unsigned int total = 0;
+        double max_submit = 0;
+        for (unsigned int i = 0; i < nb_sub; i++) {
+            pthread_join(threads[i], NULL);
+            total += subs[i].count;
+            if (subs[i].max_submit > max_submit)
+                max_submit = subs[i].max_submit;
+        }
+        double elapsed = async_now() - start;
+
+        // Every latency together
+        double *all = (double *) malloc(sizeof(double) * (total > 0 ? total : 1));
+        unsigned int n = 0;
+        for (unsigned int i = 0; i < nb_sub; i++)
+            for (unsigned int j = 0; j < subs[i].count; j++)
+                all[n++] = subs[i].latencies[j];
+
+        harness_stats_t stats = {0, 0, 0, 0, 0};
+        if (n > 0)
+            harness_stats(all, n, &stats);
+
+        requests = atomic_load(&async->requests) - requests;
+        batched = atomic_load(&async->batched) - batched;
+
+        printf("%u, %0.0f, %e, %e, %e, %e, %0.1f\n", nb_sub, (double) total / elapsed, stats.median, stats.p99,
+               stats.max, max_submit, requests > 0 ? 100.0 * (double) batched / (double) requests : 0.0);
+
+        for (unsigned int i = 0; i < nb_sub; i++)
+            free(subs[i].latencies);
+        free(all);
+        free(subs);
+        free(threads);
+    }
+
+    async_destroy(async);
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "harness.h"
+#include "tune.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Largest array of the comparison (256 MB), above the last size class
+#define MAX_LOG 26
+
+// What is measured
+#define MODE_TUNED 0     // tune_l1sqrt: settings of the profile for N
+#define MODE_POOL 1      // every thread, tree reduction, kernel picked at startup (what the drivers do)
+#define MODE_SINGLE 2    // one thread, kernel picked at startup
+#define MODE_COUNT 3
+
+typedef struct {
+    int mode;
+    tune_t *tune;
+    simdnorm_ctx_t *ctx;
+    const float *U;
+    size_t N;
+    volatile float result;
+} call_t;
+
+void call(call_t *c) {
+    if (c->mode == MODE_TUNED)
+        c->result = tune_l1sqrt(c->tune, c->U, c->N);
+    else if (c->mode == MODE_POOL)
+        c->result = simdnorm_l1sqrt(c->ctx, c->U, c->N);
+    else
+        c->result = simdnorm_l1sqrt_single(c->ctx, c->U, c->N);
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get the largest number of threads to probe (0: every CPU)
+    unsigned int max_thread = argc > 1 ? (unsigned int) atoi(argv[1]) : 0;
+
+    // Options: probe (probe again even if the profile is there), profile=path, and the overrides of TUNE_ENV
+    const char *path = NULL;
+    const char *forced = NULL;
+    int probe = 0;
+    for (int a = 2; a < argc; a++) {
+        if (strcmp(argv[a], "probe") == 0)
+            probe = 1;
+        else if (strncmp(argv[a], "profile=", 8) == 0)
+            path = argv[a] + 8;
+        else
+            forced = argv[a];
+    }
+
+    double start = harness_now();
+    tune_t *tune = tune_create(path, max_thread, 0.02);
+    if (tune == NULL) {
+        printf("Could not allocate the tuner\n");
+        exit(1);
+    }
+    if (probe && !tune->probed) {
+        if (tune_probe(tune, 0.02) != 0) {
+            printf("Could not allocate the array of the probe\n");
+            exit(1);
+        }
+        tune_save(tune, path != NULL ? path : (getenv(TUNE_FILE_ENV) != NULL ? getenv(TUNE_FILE_ENV) : TUNE_FILE));
+    }
+    printf("Tuner ready in %0.2f s\n", harness_now() - start);
+
+    if (forced != NULL && tune_override_string(tune, forced) != 0) {
+        printf("Usage: %s [max_threads] [probe] [profile=path] [threads=n,reduction=name,kernel=name]\n", argv[0]);
+        exit(1);
+    }
+
+    tune_report(tune, stdout);
+
+    simdnorm_ctx_t *ctx = simdnorm_create(tune->max_thread);
+
+    size_t max_N = (size_t) 1 << MAX_LOG;
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * max_N);
+    simdnorm_generate(ctx, U, max_N, PRNG_UNIFORM, -1.0f, 1.0f, (unsigned long long) time(NULL));
+
+    // Every size in between two classes too: the settings of the nearest class must still hold there
+    harness_config_t config = {1, 1000, 3, 0.05, NULL, 0};
+    harness_result_t r[MODE_COUNT];
+    int ok = 1;
+
+    printf("\nN, threads, reduction, kernel, tuned s, %u threads s, 1 thread s, vs %u threads, vs 1 thread\n",
+           tune->max_thread, tune->max_thread);
+    for (size_t N = (size_t) 1 << TUNE_MIN_LOG; N <= max_N; N *= 2) {
+        tune_choice_t choice = tune_decide(tune, N);
+
+        for (int mode = 0; mode < MODE_COUNT; mode++) {
+            call_t c = {mode, tune, ctx, U, N, 0};
+            harness_measure((harness_fn_t) call, &c, &config, &r[mode]);
+        }
+
+        // Other kernel, other cut: the result only moves in the last bits
+        float tuned = tune_l1sqrt(tune, U, N), expected = simdnorm_l1sqrt(ctx, U, N);
+        ok &= fabsf(tuned - expected) <= 1E-5f * expected;
+
+        printf("%zu, %u, %s, %s, %e, %e, %e, x%0.2f, x%0.2f\n", N, choice.nb_thread,
+               tune_reduction_name(choice.reduction), tune_variant_name(choice.variant), r[MODE_TUNED].seconds.median,
+               r[MODE_POOL].seconds.median, r[MODE_SINGLE].seconds.median,
+               r[MODE_POOL].seconds.median / r[MODE_TUNED].seconds.median,
+               r[MODE_SINGLE].seconds.median / r[MODE_TUNED].seconds.median);
+    }
+    printf("Results against the default settings: %s\n\n", ok ? "OK" : "FAILED");
+
+    // The decisions with the calls made above
+    tune_report(tune, stdout);
+
+    tune_destroy(tune);
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+
+
+    return ok ? 0 : 1;
+}
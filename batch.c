@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Number of calls timed for each mode, we keep the fastest one
+#define REPEAT 5
+
+// Floats of the matrix when the number of rows is not given (4 MB, the rows stay in the last level cache)
+#define DEFAULT_FLOATS ((size_t) 1 << 20)
+
+
+struct timespec diff(struct timespec start, struct timespec end)
+{
+    struct timespec temp;
+
+    if (end.tv_nsec-start.tv_nsec<0)
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec-1;
+        temp.tv_nsec = 1000000000+end.tv_nsec-start.tv_nsec;
+    }
+    else
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec;
+        temp.tv_nsec = end.tv_nsec-start.tv_nsec;
+    }
+    return temp;
+}
+
+// Way the rows are computed by time_mode
+#define MODE_LOOP 0           // vect_norm on each row, one thread
+#define MODE_ROWS_SINGLE 1    // 8-rows kernel, one thread
+#define MODE_BATCH 2          // (ptr, len) batch over the threads
+#define MODE_ROWS 3           // matrix batch over the threads
+#define MODE_COUNT 4
+
+// Fastest of REPEAT calls, in seconds
+double time_mode(int mode, simdnorm_ctx_t *ctx, const float *M, const float *const *ptrs, const size_t *lens,
+                 size_t rows, size_t cols, float *out) {
+    double best = 1E9;
+
+    for (unsigned int r = 0; r < REPEAT; r++) {
+        struct timespec begining, end;
+        clock_gettime(CLOCK_MONOTONIC, &begining);
+
+        switch (mode) {
+            case MODE_LOOP:
+                for (size_t i = 0; i < rows; i++)
+                    out[i] = vect_norm((float *) (M + i * cols), cols);
+                break;
+            case MODE_ROWS_SINGLE:
+                simdnorm_l1sqrt_rows_single(ctx, M, rows, cols, cols, out);
+                break;
+            case MODE_BATCH:
+                simdnorm_l1sqrt_batch(ctx, ptrs, lens, rows, out);
+                break;
+            default:
+                simdnorm_l1sqrt_rows(ctx, M, rows, cols, cols, out);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        struct timespec t = diff(begining, end);
+        double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+        if (d < best)
+            best = d;
+    }
+
+    return best;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of threads
+    unsigned int nb_thread = argc > 1 ? (unsigned int) atoi(argv[1]) : 2;
+
+    // Number of rows, by default DEFAULT_FLOATS floats whatever the length of the rows
+    size_t forced_rows = argc > 2 ? (size_t) strtoull(argv[2], NULL, 10) : 0;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    const size_t lengths[6] = {128, 256, 512, 1024, 2048, 4096};
+    const char *modes[MODE_COUNT] = {"vect_norm loop", "rows single thread", "batch", "rows"};
+
+    printf("Kernel: %s, %u threads\n", kernel_name(kernel_current()), nb_thread);
+    printf("cols, rows, mode, time, Mrows/s, speedup vs loop, max relative difference\n");
+
+    for (unsigned int l = 0; l < 6; l++) {
+        size_t cols = lengths[l];
+        size_t rows = forced_rows > 0 ? forced_rows : DEFAULT_FLOATS / cols;
+
+        float *M = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * rows * cols);
+        const float **ptrs = (const float **) malloc(sizeof(float *) * rows);
+        size_t *lens = (size_t *) malloc(sizeof(size_t) * rows);
+        float *ref = (float *) malloc(sizeof(float) * rows);
+        float *out = (float *) malloc(sizeof(float) * rows);
+
+        for (size_t i = 0; i < rows * cols; i++)
+            M[i] = ((float) rand() / (float) (RAND_MAX));
+
+        for (size_t i = 0; i < rows; i++) {
+            ptrs[i] = M + i * cols;
+            lens[i] = cols;
+        }
+
+        double loop = time_mode(MODE_LOOP, ctx, M, ptrs, lens, rows, cols, ref);
+
+        for (int mode = MODE_LOOP; mode < MODE_COUNT; mode++) {
+            double t = time_mode(mode, ctx, M, ptrs, lens, rows, cols, out);
+
+            // The additions are not done in the same order as vect_norm
+            double max_diff = 0;
+            for (size_t i = 0; i < rows; i++) {
+                double d = fabs((double) out[i] - ref[i]) / ref[i];
+                if (d > max_diff)
+                    max_diff = d;
+            }
+
+            printf("%zu, %zu, %s, %e, %0.2f, x%0.2f, %e\n", cols, rows, modes[mode], t, (double) rows / t * 1E-6,
+                   loop / t, max_diff);
+        }
+
+        free(M);
+        free(ptrs);
+        free(lens);
+        free(ref);
+        free(out);
+    }
+
+    simdnorm_destroy(ctx);
+
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "harness.h"
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Seed of the data: the same input from one build to the other
+#define SEED 42
+
+// Most thread counts given with -t
+#define MAX_THREAD_COUNTS 16
+
+#define FORMAT_CSV 0
+#define FORMAT_JSON 1
+
+// What is measured
+#define MODE_SCALAR 0      // norm, 1 thread
+#define MODE_SINGLE 1      // vect_norm, 1 thread
+#define MODE_THREADED 2    // simdnorm_l1sqrt on the threads of a context
+
+typedef struct {
+    int mode;
+    simdnorm_ctx_t *ctx;
+    float *U;
+    size_t N;
+    volatile float result;
+} call_t;
+
+void call(call_t *c) {
+    if (c->mode == MODE_SCALAR)
+        c->result = norm(c->U, c->N);
+    else if (c->mode == MODE_SINGLE)
+        c->result = vect_norm(c->U, c->N);
+    else
+        c->result = simdnorm_l1sqrt(c->ctx, c->U, c->N);
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-n min_elts] [-N max_elts] [-t threads,...] [-r reps] [-w warmup] [-b budget_s] [-c] "
+           "[-f csv|json] [-R lockfree|tree|join|steal] [-o file]\n", name);
+    printf("  -c: cold caches (the array is flushed before each call), warm by default\n");
+    exit(1);
+}
+
+// Parse "1,2,4" into threads, returns the number of values
+int parse_threads(char *list, unsigned int *threads) {
+    int n = 0;
+
+    for (char *tok = strtok(list, ","); tok != NULL && n < MAX_THREAD_COUNTS; tok = strtok(NULL, ",")) {
+        int t = atoi(tok);
+        if (t <= 0)
+            return -1;
+        threads[n++] = (unsigned int) t;
+    }
+
+    return n;
+}
+
+int reduction_from_name(const char *name) {
+    const char *names[4] = {"lockfree", "tree", "join", "steal"};
+    const int modes[4] = {REDUCE_LOCKFREE, REDUCE_TREE, REDUCE_JOIN, REDUCE_STEAL};
+
+    for (int i = 0; i < 4; i++)
+        if (strcmp(name, names[i]) == 0)
+            return modes[i];
+
+    return -1;
+}
+
+// One line (CSV) or one object (JSON) per measure
+void print_result(FILE *out, int format, int first, const char *mode, unsigned int threads, size_t N, int cold,
+                  const harness_result_t *r) {
+    double gbs = (double) N * sizeof(float) / r->seconds.median * 1E-9;
+
+    if (format == FORMAT_CSV) {
+        fprintf(out, "%s,%s,%u,%zu,%zu,%s,%u,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.3f\n", kernel_name(kernel_current()),
+                mode, threads, N, N * sizeof(float), cold ? "cold" : "warm", r->reps, r->seconds.min * 1E9,
+                r->seconds.median * 1E9, r->seconds.p99 * 1E9, r->seconds.max * 1E9, r->seconds.mean * 1E9,
+                r->cycles.min, r->cycles.median, gbs);
+    } else {
+        fprintf(out, "%s    {\"kernel\": \"%s\", \"mode\": \"%s\", \"threads\": %u, \"n\": %zu, \"bytes\": %zu, "
+                     "\"cache\": \"%s\", \"reps\": %u, \"min_ns\": %.0f, \"median_ns\": %.0f, \"p99_ns\": %.0f, "
+                     "\"max_ns\": %.0f, \"mean_ns\": %.0f, \"min_cycles\": %.0f, \"median_cycles\": %.0f, "
+                     "\"gbs\": %.3f}", first ? "" : ",\n", kernel_name(kernel_current()), mode, threads, N,
+                N * sizeof(float), cold ? "cold" : "warm", r->reps, r->seconds.min * 1E9, r->seconds.median * 1E9,
+                r->seconds.p99 * 1E9, r->seconds.max * 1E9, r->seconds.mean * 1E9, r->cycles.min, r->cycles.median,
+                gbs);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // From L1 resident (4 KB) to DRAM resident (256 MB) by default
+    size_t min_n = 1024, max_n = (size_t) 1 << 26;
+    unsigned int threads[MAX_THREAD_COUNTS] = {1, 2, 4};
+    int nb_counts = 3;
+    harness_config_t config = {5, 100, 5, 1.0, NULL, 0};
+    int cold = 0, format = FORMAT_CSV, reduction = REDUCE_TREE;
+    FILE *out = stdout;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:N:t:r:w:b:cf:R:o:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                min_n = (size_t) strtoull(optarg, NULL, 10);
+                break;
+            case 'N':
+                max_n = (size_t) strtoull(optarg, NULL, 10);
+                break;
+            case 't':
+                nb_counts = parse_threads(optarg, threads);
+                if (nb_counts <= 0)
+                    usage(argv[0]);
+                break;
+            case 'r':
+                config.reps = (unsigned int) atoi(optarg);
+                break;
+            case 'w':
+                config.warmup = (unsigned int) atoi(optarg);
+                break;
+            case 'b':
+                config.budget = atof(optarg);
+                break;
+            case 'c':
+                cold = 1;
+                break;
+            case 'f':
+                if (strcmp(optarg, "csv") == 0)
+                    format = FORMAT_CSV;
+                else if (strcmp(optarg, "json") == 0)
+                    format = FORMAT_JSON;
+                else
+                    usage(argv[0]);
+                break;
+            case 'R':
+                reduction = reduction_from_name(optarg);
+                if (reduction < 0)
+                    usage(argv[0]);
+                break;
+            case 'o':
+                out = fopen(optarg, "w");
+                if (out == NULL) {
+                    printf("Cannot open %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (min_n == 0 || max_n < min_n || config.reps == 0)
+        usage(argv[0]);
+
+    if (config.min_reps > config.reps)
+        config.min_reps = config.reps;
+
+    // Filled once with a fixed seed: every measure (and every build) reads the same data
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * max_n + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+    srand(SEED);
+    for (size_t i = 0; i < max_n; i++)
+        U[i] = ((float) rand() / (float) (RAND_MAX));
+
+    if (format == FORMAT_CSV)
+        fprintf(out, "kernel,mode,threads,n,bytes,cache,reps,min_ns,median_ns,p99_ns,max_ns,mean_ns,min_cycles,"
+                     "median_cycles,gbs_median\n");
+    else
+        fprintf(out, "{\n  \"results\": [\n");
+
+    int first = 1;
+    for (size_t n = min_n; n <= max_n; n *= 2) {
+        call_t c = {MODE_SCALAR, NULL, U, n, 0};
+        harness_result_t r;
+
+        // A cold measure only flushes the part of the array it reads
+        config.flush = cold ? U : NULL;
+        config.flush_bytes = n * sizeof(float);
+
+        harness_measure((harness_fn_t) call, &c, &config, &r);
+        print_result(out, format, first, "scalar", 1, n, cold, &r);
+        first = 0;
+
+        c.mode = MODE_SINGLE;
+        harness_measure((harness_fn_t) call, &c, &config, &r);
+        print_result(out, format, first, "vect", 1, n, cold, &r);
+
+        c.mode = MODE_THREADED;
+        for (int t = 0; t < nb_counts; t++) {
+            c.ctx = simdnorm_create(threads[t]);
+            simdnorm_set_reduction(c.ctx, reduction);
+
+            harness_measure((harness_fn_t) call, &c, &config, &r);
+            print_result(out, format, first, "threaded", threads[t], n, cold, &r);
+
+            simdnorm_destroy(c.ctx);
+        }
+
+        fflush(out);
+    }
+
+    if (format == FORMAT_JSON)
+        fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+
+    // free our memory
+    free(U);
+
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <linux/mman.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "buffer.h"
+
+#define PAGE_4K ((size_t) 4096)
+#define PAGE_2M ((size_t) 2 << 20)
+#define PAGE_1G ((size_t) 1 << 30)
+
+static const char *backing_names[BUFFER_COUNT] = {"plain", "thp", "hugetlb_2m", "hugetlb_1g"};
+
+const char *buffer_backing_name(int backing) {
+    return (backing >= 0 && backing < BUFFER_COUNT) ? backing_names[backing] : "unknown";
+}
+
+int buffer_backing_from_name(const char *name) {
+    for (int b = 0; b < BUFFER_COUNT; b++)
+        if (strcmp(name, backing_names[b]) == 0)
+            return b;
+
+    return -1;
+}
+
+static size_t round_up(size_t x, size_t page) {
+    return (x + page - 1) / page * page;
+}
+
+// Page size used to share the buffer out between the workers: a huge page is touched by a single worker
+static size_t page_size(int backing) {
+    switch (backing) {
+        case BUFFER_HUGETLB_1G:
+            return PAGE_1G;
+        case BUFFER_HUGETLB_2M:
+        case BUFFER_THP:
+            return PAGE_2M;
+        default:
+            return PAGE_4K;
+    }
+}
+
+// Explicit huge pages: the mapping is reserved at once (MAP_PRIVATE without MAP_NORESERVE), so it fails here
+// instead of a SIGBUS at the first touch when the pool of huge pages is too small
+static int map_hugetlb(buffer_t *buf, size_t bytes, int backing) {
+    size_t page = page_size(backing);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (backing == BUFFER_HUGETLB_1G ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+
+    void *p = mmap(NULL, round_up(bytes, page), PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (p == MAP_FAILED)
+        return -1;
+
+    buf->map = p;
+    buf->map_bytes = round_up(bytes, page);
+    buf->ptr = p;
+
+    return 0;
+}
+
+// 4 KB pages, over-allocated by 2 MB so the buffer can start on a 2 MB boundary (a huge page can only back an
+// aligned 2 MB range), then MADV_HUGEPAGE on it for BUFFER_THP
+static int map_anonymous(buffer_t *buf, size_t bytes, int backing) {
+    size_t map_bytes = round_up(bytes, PAGE_2M) + PAGE_2M;
+
+    void *p = mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return -1;
+
+    buf->map = p;
+    buf->map_bytes = map_bytes;
+    buf->ptr = (void *) round_up((size_t) (uintptr_t) p, PAGE_2M);
+
+    if (backing == BUFFER_THP && madvise(buf->ptr, round_up(bytes, PAGE_2M), MADV_HUGEPAGE) != 0) {
+        // Kernel without THP: the mapping is kept as plain pages
+        return 1;
+    }
+
+    return 0;
+}
+
+// Each worker writes one byte per 4 KB page of its slice (whole pages of the backing)
+static void prefault_job(buffer_t *buf, unsigned int worker, unsigned int nb_thread) {
+    size_t page = page_size(buf->backing);
+    size_t nb_pages = (buf->bytes + page - 1) / page;
+
+    size_t begin = ((nb_pages * worker) / nb_thread) * page;
+    size_t end = ((nb_pages * (worker + 1)) / nb_thread) * page;
+    if (end > buf->bytes)
+        end = buf->bytes;
+
+    volatile char *p = (volatile char *) buf->ptr;
+    for (size_t i = begin; i < end; i += PAGE_4K)
+        p[i] = 0;
+}
+
+typedef struct {
+    buffer_t *buf;
+    threadpool_t *pool;
+} prefault_t;
+
+static void prefault_pool_job(prefault_t *job, unsigned int worker) {
+    prefault_job(job->buf, worker, job->pool->nb_thread);
+}
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+
+    return (double) t.tv_sec + (double) t.tv_nsec * 1E-9;
+}
+
+int buffer_alloc(buffer_t *buf, size_t bytes, int best, threadpool_t *pool) {
+    memset(buf, 0, sizeof(buffer_t));
+    buf->bytes = bytes;
+
+    if (best < 0 || best >= BUFFER_COUNT)
+        best = BUFFER_COUNT - 1;
+    if (bytes == 0)
+        bytes = 1;
+
+    int mapped = 0;
+    for (int backing = best; backing >= BUFFER_PLAIN && !mapped; backing--) {
+        if (backing >= BUFFER_HUGETLB_2M) {
+            mapped = map_hugetlb(buf, bytes, backing) == 0;
+            buf->backing = backing;
+        } else {
+            int r = map_anonymous(buf, bytes, backing);
+            if (r < 0)
+                return -1;
+
+            mapped = 1;
+            buf->backing = r == 0 ? backing : BUFFER_PLAIN;
+        }
+    }
+
+    if (pool != NULL && buf->bytes > 0) {
+        double start = now();
+        prefault_t job = {buf, pool};
+        pool_run(pool, (pool_job_t) prefault_pool_job, &job);
+        buf->prefault_seconds = now() - start;
+    }
+
+    return 0;
+}
+
+void buffer_free(buffer_t *buf) {
+    if (buf->map != NULL)
+        munmap(buf->map, buf->map_bytes);
+
+    memset(buf, 0, sizeof(buffer_t));
+}
+
+size_t buffer_huge_bytes(const buffer_t *buf) {
+    if (buf->backing >= BUFFER_HUGETLB_2M)
+        return buf->bytes;
+    if (buf->backing == BUFFER_PLAIN)
+        return 0;
+
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == NULL)
+        return 0;
+
+    // AnonHugePages of every mapping overlapping the buffer (madvise may have split the original one)
+    uintptr_t begin = (uintptr_t) buf->ptr, end = begin + buf->bytes;
+    int inside = 0;
+    size_t total = 0;
+    char line[512];
+
+    while (fgets(line, sizeof(line), smaps) != NULL) {
+        unsigned long lo, hi;
+        size_t kb;
+
+        if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2)
+            inside = lo < end && hi > begin;
+        else if (inside && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1)
+            total += kb * 1024;
+    }
+
+    fclose(smaps);
+
+    return total < buf->bytes ? total : buf->bytes;
+}
@@ -0,0 +1,50 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stddef.h>
+
+#include "threadpool.h"
+
+// Buffers for the big arrays, backed by huge pages when possible: a sweep over GBs of 4 KB pages misses the dTLB
+// every 4 KB, with 2 MB pages every 2 MB
+
+// Backings, from the worst to the best
+#define BUFFER_PLAIN 0        // 4 KB pages
+#define BUFFER_THP 1          // madvise(MADV_HUGEPAGE): transparent huge pages, if the kernel finds free 2 MB blocks
+#define BUFFER_HUGETLB_2M 2   // explicit 2 MB pages (vm.nr_hugepages)
+#define BUFFER_HUGETLB_1G 3   // explicit 1 GB pages (hugepagesz=1G at boot)
+#define BUFFER_COUNT 4
+
+typedef struct {
+    // Start of the buffer, aligned on the page size of the backing (2 MB for BUFFER_THP)
+    void *ptr;
+    size_t bytes;
+    // Backing actually obtained
+    int backing;
+    // Time spent touching every page
+    double prefault_seconds;
+
+    // What has to be unmapped
+    void *map;
+    size_t map_bytes;
+} buffer_t;
+
+// Map bytes bytes, trying the backings from best down to BUFFER_PLAIN
+// If pool is not NULL every page is touched by the workers, each one a contiguous slice of the buffer (the same
+// as its slice in normPar), so the page faults are taken in parallel and the pages land on the node of the worker
+// Pass NULL to place the pages yourself (numa_bind) before touching them
+// Returns 0, -1 if nothing could be mapped
+int buffer_alloc(buffer_t *buf, size_t bytes, int best, threadpool_t *pool);
+
+void buffer_free(buffer_t *buf);
+
+// Bytes of the buffer really backed by huge pages: all of it for hugetlb, AnonHugePages of /proc/self/smaps for THP
+// (the kernel may have given 4 KB pages anyway), 0 for plain pages
+size_t buffer_huge_bytes(const buffer_t *buf);
+
+const char *buffer_backing_name(int backing);
+
+// -1 if the name is unknown
+int buffer_backing_from_name(const char *name);
+
+#endif //BUFFER_H
@@ -0,0 +1,310 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <math.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "async.h"
+#include "harness.h"
+#include "normd.h"
+
+// Requests in flight per client
+#define DEPTH 8
+// One big request out of BIG_EVERY
+#define BIG_EVERY 16
+#define MAX_SAMPLES (1 << 18)
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+    (void) sig;
+    stop = 1;
+}
+
+typedef struct {
+    const char *path;   // NULL: a pool of its own in the process
+    unsigned int nb_thread;
+    size_t small;
+    size_t big;
+    double duration;
+    unsigned int id;
+} client_config_t;
+
+// What a client sends back to the parent through its pipe, followed by the latencies
+typedef struct {
+    unsigned long long requests;
+    unsigned int samples;
+    int ok;
+    double elapsed;
+} client_summary_t;
+
+static size_t request_size(const client_config_t *config, unsigned long k, size_t *offset) {
+    size_t n = (k % BIG_EVERY == 0) ? config->big : config->small;
+    *offset = (k * 2654435761u) % (config->big - n + 1);
+    return n;
+}
+
+// Through the daemon: DEPTH requests pipelined, the id of a request is its slot
+static void client_daemon(const client_config_t *config, client_summary_t *summary, double *latencies) {
+    normd_client_t *client = normd_connect(config->path);
+    float *U = client != NULL ? normd_map(client, config->big) : NULL;
+    if (U == NULL) {
+        summary->ok = 0;
+        return;
+    }
+    prng_fill(U, config->big, PRNG_UNIFORM, -1.0f, 1.0f, config->id + 1, 0, 1);
+
+    // The result of the daemon against a scalar sum here
+    double expected = 0;
+    for (size_t i = 0; i < config->big; i++)
+        expected += sqrt(fabs((double) U[i]));
+    float got = normd_norm(client, 0, config->big);
+    summary->ok = fabs(got - expected) <= 1E-5 * expected;
+
+    double sent[DEPTH];
+    unsigned long k = config->id;
+    unsigned int in_flight = 0;
+
+    double start = async_now(), end = start + config->duration;
+    for (unsigned int slot = 0; slot < DEPTH; slot++) {
+        size_t offset, n = request_size(config, k++, &offset);
+        sent[slot] = async_now();
+        if (normd_send(client, slot, offset, n) != 0)
+            break;
+        in_flight++;
+    }
+
+    while (in_flight > 0) {
+        normd_reply_t r;
+        if (normd_receive(client, &r) != 0 || r.status != NORMD_OK || r.id >= DEPTH) {
+            summary->ok = 0;
+            break;
+        }
+        double now = async_now();
+        in_flight--;
+
+        if (summary->samples < MAX_SAMPLES)
+            latencies[summary->samples++] = now - sent[r.id];
+        summary->requests++;
+
+        if (now < end) {
+            size_t offset, n = request_size(config, k++, &offset);
+            sent[r.id] = async_now();
+            if (normd_send(client, r.id, offset, n) != 0) {
+                summary->ok = 0;
+                break;
+            }
+            in_flight++;
+        }
+    }
+    summary->elapsed = async_now() - start;
+
+    normd_close(client);
+}
+
+// Without the daemon: every process has its own pool of nb_thread threads, the way it is done everywhere else
+static void client_own_pool(const client_config_t *config, client_summary_t *summary, double *latencies) {
+    simdnorm_ctx_t *ctx = simdnorm_create(config->nb_thread);
+    float *U = (float *) malloc(sizeof(float) * config->big);
+    prng_fill(U, config->big, PRNG_UNIFORM, -1.0f, 1.0f, config->id + 1, 0, 1);
+    summary->ok = 1;
+
+    unsigned long k = config->id;
+    double start = async_now(), end = start + config->duration;
+    double now = start;
+    while (now < end) {
+        size_t offset, n = request_size(config, k++, &offset);
+        double t = async_now();
+        volatile float r = simdnorm_l1sqrt(ctx, U + offset, n);
+        (void) r;
+        now = async_now();
+
+        if (summary->samples < MAX_SAMPLES)
+            latencies[summary->samples++] = now - t;
+        summary->requests++;
+    }
+    summary->elapsed = now - start;
+
+    free(U);
+    simdnorm_destroy(ctx);
+}
+
+static int write_all(int fd, const void *p, size_t bytes) {
+    const char *c = (const char *) p;
+    while (bytes > 0) {
+        ssize_t w = write(fd, c, bytes);
+        if (w <= 0)
+            return -1;
+        c += w;
+        bytes -= (size_t) w;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *p, size_t bytes) {
+    char *c = (char *) p;
+    while (bytes > 0) {
+        ssize_t r = read(fd, c, bytes);
+        if (r <= 0)
+            return -1;
+        c += r;
+        bytes -= (size_t) r;
+    }
+    return 0;
+}
+
+// nb_client processes at once, one line of results. Returns 1 if every result was right
+static int run_clients(client_config_t config, unsigned int nb_client) {
+    pid_t *pids = (pid_t *) malloc(sizeof(pid_t) * nb_client);
+    int *pipes = (int *) malloc(sizeof(int) * nb_client);
+
+    for (unsigned int i = 0; i < nb_client; i++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            printf("pipe failed\n");
+            exit(1);
+        }
+
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            close(fds[0]);
+            config.id = i;
+
+            client_summary_t summary = {0, 0, 0, 0};
+            double *latencies = (double *) malloc(sizeof(double) * MAX_SAMPLES);
+            if (config.path != NULL)
+                client_daemon(&config, &summary, latencies);
+            else
+                client_own_pool(&config, &summary, latencies);
+
+            write_all(fds[1], &summary, sizeof(summary));
+            write_all(fds[1], latencies, sizeof(double) * summary.samples);
+            _exit(0);
+        }
+
+        close(fds[1]);
+        pipes[i] = fds[0];
+    }
+
+    double *all = (double *) malloc(sizeof(double) * MAX_SAMPLES * nb_client);
+    unsigned int n = 0;
+    double throughput = 0;
+    int ok = 1;
+
+    for (unsigned int i = 0; i < nb_client; i++) {
+        client_summary_t summary;
+        if (read_all(pipes[i], &summary, sizeof(summary)) != 0 ||
+            read_all(pipes[i], all + n, sizeof(double) * summary.samples) != 0) {
+            ok = 0;
+        } else {
+            ok &= summary.ok;
+            n += summary.samples;
+            if (summary.elapsed > 0)
+                throughput += (double) summary.requests / summary.elapsed;
+        }
+        close(pipes[i]);
+        waitpid(pids[i], NULL, 0);
+    }
+
+    harness_stats_t stats = {0, 0, 0, 0, 0};
+    if (n > 0)
+        harness_stats(all, n, &stats);
+
+    printf("%s, %u, %0.0f, %e, %e, %s\n", config.path != NULL ? "daemon" : "own pool", nb_client, throughput,
+           stats.median, stats.p99, ok ? "OK" : "FAILED");
+
+    free(all);
+    free(pids);
+    free(pipes);
+
+    return ok;
+}
+
+static void serve(const char *path, unsigned int nb_thread) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (normd_serve(path, nb_thread, 1, &stop) != 0) {
+        printf("Could not listen on %s\n", path);
+        exit(1);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+
+    if (argc > 3 && strcmp(argv[1], "serve") == 0) {
+        unsigned int nb_thread = (unsigned int) atoi(argv[3]);
+        printf("Serving on %s with %u pinned threads, kernel %s\n", argv[2], nb_thread, kernel_name(kernel_current()));
+        fflush(stdout);
+        serve(argv[2], nb_thread);
+        return 0;
+    }
+
+    if (argc < 3 || strcmp(argv[1], "bench") != 0) {
+        printf("Usage: %s serve socket_path nb_threads\n", argv[0]);
+        printf("       %s bench nb_threads [seconds] [small_elts] [big_elts >= small_elts]\n", argv[0]);
+        exit(1);
+    }
+
+    unsigned int nb_thread = (unsigned int) atoi(argv[2]);
+    double duration = argc > 3 ? atof(argv[3]) : 1.0;
+    size_t small = argc > 4 ? (size_t) strtoull(argv[4], NULL, 10) : 4096;
+    size_t big = argc > 5 ? (size_t) strtoull(argv[5], NULL, 10) : (size_t) 1 << 20;
+
+    if (nb_thread == 0 || small == 0 || big < small) {
+        printf("Usage: %s bench nb_threads [seconds] [small_elts] [big_elts >= small_elts]\n", argv[0]);
+        exit(1);
+    }
+
+    // The daemon in a child process, on a socket of its own
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/simdnorm-%d.sock", (int) getpid());
+
+    pid_t server = fork();
+    if (server == 0) {
+        serve(path, nb_thread);
+        _exit(0);
+    }
+
+    // Wait until it listens
+    normd_client_t *probe = NULL;
+    for (int tries = 0; tries < 5000 && probe == NULL; tries++) {
+        probe = normd_connect(path);
+        if (probe == NULL)
+            usleep(1000);
+    }
+    if (probe == NULL) {
+        printf("The daemon did not start\n");
+        kill(server, SIGTERM);
+        exit(1);
+    }
+    normd_close(probe);
+
+    printf("%u threads, kernel %s, requests of %zu floats, 1 in %d of %zu floats, %d in flight per client\n",
+           nb_thread, kernel_name(kernel_current()), small, BIG_EVERY, big, DEPTH);
+    printf("mode, clients, requests/s, p50 latency s, p99 latency s, results\n");
+
+    client_config_t config = {path, nb_thread, small, big, duration, 0};
+    const unsigned int counts[4] = {1, 2, 4, 8};
+    int ok = 1;
+
+    for (int c = 0; c < 4; c++) {
+        config.path = path;
+        ok &= run_clients(config, counts[c]);
+        config.path = NULL;
+        ok &= run_clients(config, counts[c]);
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    return ok ? 0 : 1;
+}
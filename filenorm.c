@@ -0,0 +1,167 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "simdnorm.h"
+#include "stream.h"
+
+// Number of floats written at once by the write mode
+#define WRITE_BLOCK (1u << 20)
+
+// Write nb_elts random floats in path
+int write_file(const char *path, size_t N) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return -1;
+
+    float *block = (float *) malloc(sizeof(float) * WRITE_BLOCK);
+
+    for (size_t done = 0; done < N; done += WRITE_BLOCK) {
+        size_t n = N - done < WRITE_BLOCK ? N - done : WRITE_BLOCK;
+
+        for (size_t i = 0; i < n; i++)
+            block[i] = ((float) rand() / (float) (RAND_MAX));
+
+        if (fwrite(block, sizeof(float), n, f) != n) {
+            free(block);
+            fclose(f);
+            return -1;
+        }
+    }
+
+    free(block);
+
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// The three modes on an empty file written in path: they all have to give 0
+int check_empty(const char *path, unsigned int nb_thread) {
+    if (write_file(path, 0) != 0) {
+        printf("Could not write %s\n", path);
+        return -1;
+    }
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+    if (ctx == NULL) {
+        printf("Could not start %u threads\n", nb_thread);
+        return -1;
+    }
+
+    stream_stats_t stats;
+    float results[3] = {
+        stream_norm_mmap(path, ctx, STREAM_CHUNK, &stats),
+        stream_norm_pread(path, ctx, STREAM_CHUNK, 0, &stats),
+        stream_norm_pread(path, ctx, STREAM_CHUNK, 1, &stats),
+    };
+    const char *names[3] = {"mmap", "pread", "pread O_DIRECT"};
+
+    simdnorm_destroy(ctx);
+
+    int errors = 0;
+    for (int m = 0; m < 3; m++) {
+        printf("Empty file, %s: %e\n", names[m], results[m]);
+        if (results[m] != 0)
+            errors++;
+    }
+
+    printf(errors == 0 ? "Empty file: OK\n" : "Empty file: FAILED\n");
+
+    return errors == 0 ? 0 : -1;
+}
+
+void print_stats(const char *name, stream_stats_t *stats, double raw) {
+    double gbs = (double) stats->bytes / stats->seconds * 1E-9;
+
+    printf("%s, %zu, %e, %0.2f, %0.0f%%%s\n", name, stats->bytes, stats->seconds, gbs, raw > 0 ? 100 * gbs / raw : 0,
+           stats->direct_fallback ? " (O_DIRECT not supported, buffered)" : "");
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Check for arguments
+    if (argc < 3) {
+        printf("Usage: %s write file nb_elts | %s check file nb_threads | %s file nb_threads [chunk_MB] [cached]",
+               argv[0], argv[0], argv[0]);
+        exit(1);
+    }
+
+    if (strcmp(argv[1], "write") == 0) {
+        if (argc < 4) {
+            printf("Not enough arguments: write file nb_elts");
+            exit(1);
+        }
+
+        srand((unsigned int) time(NULL));
+
+        if (write_file(argv[2], (size_t) strtoull(argv[3], NULL, 10)) != 0) {
+            printf("Could not write %s", argv[2]);
+            exit(1);
+        }
+
+        return 0;
+    }
+
+    if (strcmp(argv[1], "check") == 0) {
+        if (argc < 4) {
+            printf("Not enough arguments: check file nb_threads");
+            exit(1);
+        }
+
+        return check_empty(argv[2], (unsigned int) atoi(argv[3])) == 0 ? 0 : 1;
+    }
+
+    const char *path = argv[1];
+    unsigned int nb_thread = (unsigned int) atoi(argv[2]);
+    size_t chunk = argc > 3 ? ((size_t) strtoull(argv[3], NULL, 10)) << 20 : STREAM_CHUNK;
+
+    // By default each run starts with the file out of the page cache, "cached" keeps it
+    int cached = argc > 4 && strcmp(argv[4], "cached") == 0;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    stream_stats_t stats;
+
+    // Raw bandwidth of the disk: we read the file without computing anything
+    if (!cached)
+        stream_evict(path);
+    if (stream_read_only(path, chunk, 1, &stats) != 0) {
+        printf("Could not read %s", path);
+        exit(1);
+    }
+    double raw = (double) stats.bytes / stats.seconds * 1E-9;
+
+    printf("Kernel: %s, %u thread, chunks of %zu MB\n", kernel_name(kernel_current()), nb_thread, chunk >> 20);
+    printf("mode, bytes, time, GB/s, of the raw bandwidth\n");
+    print_stats("read only", &stats, raw);
+
+    float result;
+
+    if (!cached)
+        stream_evict(path);
+    result = stream_norm_mmap(path, ctx, chunk, &stats);
+    print_stats("mmap", &stats, raw);
+    printf("%e\n", result);
+
+    if (!cached)
+        stream_evict(path);
+    result = stream_norm_pread(path, ctx, chunk, 0, &stats);
+    print_stats("pread", &stats, raw);
+    printf("%e\n", result);
+
+    if (!cached)
+        stream_evict(path);
+    result = stream_norm_pread(path, ctx, chunk, 1, &stats);
+    print_stats("pread O_DIRECT", &stats, raw);
+    printf("%e\n", result);
+
+    // When the file is in the page cache the pipeline cannot be I/O-bound: it is our compute bound
+    result = stream_norm_mmap(path, ctx, chunk, &stats);
+    print_stats("mmap, cached", &stats, raw);
+
+    simdnorm_destroy(ctx);
+
+    return 0;
+}
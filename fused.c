@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <time.h>
+
+#include "harness.h"
+#include "pipeline.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// What is measured
+#define MODE_SEPARATE 0          // one sweep per stage (plain stores), then simdnorm_reduce
+#define MODE_SEPARATE_STREAM 1   // same with non-temporal stores
+#define MODE_FUSED 2             // tile by tile, reduction only
+#define MODE_FUSED_STORE 3       // tile by tile, transformed array written back with plain stores
+#define MODE_FUSED_STREAM 4      // tile by tile, written back with non-temporal stores
+#define MODE_COUNT 5
+
+typedef struct {
+    int mode;
+    simdnorm_ctx_t *ctx;
+    // The whole chain, and one pipeline per stage for the separate sweeps
+    pipeline_t *fused;
+    pipeline_t *single[3];
+    const float *U;
+    float *out;
+    size_t N;
+    volatile float result;
+} call_t;
+
+void call(call_t *c) {
+    if (c->mode == MODE_SEPARATE || c->mode == MODE_SEPARATE_STREAM) {
+        int write = c->mode == MODE_SEPARATE ? PIPELINE_STORE : PIPELINE_STREAM;
+
+        // U -> out, then out -> out in place
+        for (int s = 0; s < 3; s++) {
+            pipeline_set_output(c->single[s], c->out, write);
+            pipeline_run(c->single[s], c->ctx, s == 0 ? c->U : c->out, c->N);
+        }
+        c->result = simdnorm_reduce(c->ctx, OP_L1SQRT, c->out, NULL, c->N, 0);
+    } else {
+        pipeline_set_output(c->fused, c->out, c->mode == MODE_FUSED ? PIPELINE_NO_WRITE :
+                                              (c->mode == MODE_FUSED_STORE ? PIPELINE_STORE : PIPELINE_STREAM));
+        c->result = pipeline_run(c->fused, c->ctx, c->U, c->N);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements, in DRAM by default (512 MB of floats)
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 27;
+
+    // Get number of threads
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+    float *out = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+    unsigned char *mask = (unsigned char *) malloc(N + 8);
+
+    simdnorm_generate(ctx, U, N, PRNG_NORMAL, 0.0f, 1.0f, (unsigned long long) time(NULL));
+    simdnorm_generate(ctx, out, N, PRNG_CONSTANT, 0.0f, 0.0f, 0);
+    // One element out of 8 masked
+    for (size_t i = 0; i < N; i++)
+        mask[i] = (unsigned char) ((i * 2654435761u >> 7) & 7);
+
+    // Scaling, clipping, mask
+    call_t c = {MODE_SEPARATE, ctx, pipeline_create(), {pipeline_create(), pipeline_create(), pipeline_create()},
+                U, out, N, 0};
+    pipeline_add(c.fused, STAGE_AFFINE, 2.0f, -0.5f, NULL);
+    pipeline_add(c.fused, STAGE_CLIP, -1.5f, 1.5f, NULL);
+    pipeline_add(c.fused, STAGE_MASK, 0, 0, mask);
+    for (int s = 0; s < 3; s++) {
+        c.single[s]->stages[0] = c.fused->stages[s];
+        c.single[s]->nb_stages = 1;
+        pipeline_set_reduction(c.single[s], PIPELINE_NO_REDUCE, 0);
+    }
+
+    printf("N = %zu (%0.1f MB), %u threads, kernel %s, tiles of %zu floats\n", N,
+           (double) N * sizeof(float) / (1 << 20), nb_thread, kernel_name(kernel_current()), c.fused->tile);
+    printf("stages: affine(2, -0.5), clip(-1.5, 1.5), mask, then l1sqrt\n");
+
+    // Same blocks and same tree as simdnorm_reduce, and out is aligned as the scratch tiles: the fused result is
+    // bit-identical to the separate sweeps, and so is the array written back
+    c.mode = MODE_SEPARATE;
+    call(&c);
+    float separate = c.result;
+    float *expected = (float *) malloc(sizeof(float) * N);
+    memcpy(expected, out, sizeof(float) * N);
+
+    int ok = 1;
+    for (int mode = MODE_FUSED; mode < MODE_COUNT; mode++) {
+        memset(out, 0, sizeof(float) * N);
+        c.mode = mode;
+        call(&c);
+        ok &= c.result == separate;
+        if (mode != MODE_FUSED)
+            ok &= memcmp(out, expected, sizeof(float) * N) == 0;
+    }
+    free(expected);
+    printf("Fused = separate sweeps (result and array written): %s\n", ok ? "OK" : "FAILED");
+
+    harness_config_t config = {1, 20, 3, 2.0, NULL, 0};
+    const char *names[MODE_COUNT] = {"separate", "separate, stream", "fused", "fused + store", "fused + stream"};
+    // Bytes moved from / to the DRAM: 3 reads and 3 writes + 1 read for the separate sweeps
+    const double passes[MODE_COUNT] = {7, 7, 1, 2, 2};
+
+    printf("mode, median s, DRAM passes, GB/s of U, speedup vs separate\n");
+    double t_separate = 0;
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        c.mode = mode;
+        harness_result_t r;
+        harness_measure((harness_fn_t) call, &c, &config, &r);
+
+        if (mode == MODE_SEPARATE)
+            t_separate = r.seconds.median;
+
+        printf("%s, %e, %0.0f, %0.2f, x%0.2f\n", names[mode], r.seconds.median, passes[mode],
+               (double) N * sizeof(float) / r.seconds.median * 1E-9, t_separate / r.seconds.median);
+    }
+
+    // Size of the tiles, fused without write back
+    printf("tile floats, median s\n");
+    c.mode = MODE_FUSED;
+    for (size_t tile = REDUCE_BLOCK; tile <= (size_t) 1 << 22; tile *= 4) {
+        pipeline_set_tile(c.fused, tile);
+        harness_result_t r;
+        harness_measure((harness_fn_t) call, &c, &config, &r);
+        printf("%zu, %e\n", tile, r.seconds.median);
+    }
+
+    pipeline_destroy(c.fused);
+    for (int s = 0; s < 3; s++)
+        pipeline_destroy(c.single[s]);
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+    free(out);
+    free(mask);
+
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "harness.h"
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#define SEED 0x5EED5EEDull
+
+// What is measured
+#define MODE_RAND 0       // the old serial rand() loop
+#define MODE_SCALAR 1     // prng_fill, scalar, calling thread
+#define MODE_AVX2 2       // prng_fill, AVX2, calling thread
+#define MODE_POOL 3       // simdnorm_generate on every thread
+#define MODE_COUNT 4
+
+typedef struct {
+    int mode;
+    int dist;
+    simdnorm_ctx_t *ctx;
+    float *U;
+    size_t N;
+} call_t;
+
+void call(call_t *c) {
+    switch (c->mode) {
+        case MODE_RAND:
+            for (size_t i = 0; i < c->N; i++)
+                c->U[i] = ((float) rand() / (float) (RAND_MAX));
+            break;
+        case MODE_SCALAR:
+        case MODE_AVX2:
+            prng_fill(c->U, c->N, c->dist, 0.0f, 1.0f, SEED, 0, c->mode == MODE_AVX2);
+            break;
+        default:
+            simdnorm_generate(c->ctx, c->U, c->N, c->dist, 0.0f, 1.0f, SEED);
+    }
+}
+
+// Same array with the scalar and the AVX2 kernels, from any offset and with 1 to nb_thread threads
+int check_reproducible(float *U, float *V, size_t N, unsigned int nb_thread) {
+    int ok = 1;
+
+    for (int dist = 0; dist < PRNG_COUNT; dist++) {
+        prng_fill(U, N, dist, -1.0f, 2.0f, SEED, 0, 0);
+
+        prng_fill(V, N, dist, -1.0f, 2.0f, SEED, 0, 1);
+        ok &= memcmp(U, V, sizeof(float) * N) == 0;
+
+        // Any element can start a fill
+        for (size_t first = 1; first < 40; first += 3) {
+            prng_fill(V, N - first, dist, -1.0f, 2.0f, SEED, first, 1);
+            ok &= memcmp(U + first, V, sizeof(float) * (N - first)) == 0;
+        }
+
+        for (unsigned int t = 1; t <= nb_thread; t++) {
+            simdnorm_ctx_t *ctx = simdnorm_create(t);
+            memset(V, 0, sizeof(float) * N);
+            simdnorm_generate(ctx, V, N, dist, -1.0f, 2.0f, SEED);
+            ok &= memcmp(U, V, sizeof(float) * N) == 0;
+            simdnorm_destroy(ctx);
+        }
+    }
+
+    return ok;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements (256 MB of floats by default)
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 26;
+
+    // Get number of threads
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    if (N < 64) {
+        printf("Usage: %s [nb_elts >= 64] [nb_threads]\n", argv[0]);
+        exit(1);
+    }
+
+    // init random seed (for rand() only)
+    srand((unsigned int) time(NULL));
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+    float *V = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+
+    printf("N = %zu, %u threads, kernel %s\n", N, nb_thread, kernel_name(kernel_current()));
+
+    size_t n_check = N < 1000003 ? N : 1000003;
+    int ok = check_reproducible(U, V, n_check, nb_thread < 4 ? 4 : nb_thread);
+    printf("Same values for scalar / AVX2, any offset, 1 to %u threads: %s\n", nb_thread < 4 ? 4 : nb_thread,
+           ok ? "OK" : "FAILED");
+
+    // Constant 1: every sqrt is 1, the norm is exactly N below 2^24
+    size_t n_one = N < 16000000 ? N : 16000000;
+    simdnorm_generate(ctx, U, n_one, PRNG_CONSTANT, 1.0f, 0.0f, SEED);
+    float one = simdnorm_l1sqrt(ctx, U, n_one);
+    printf("Norm of %zu ones: %0.1f %s\n", n_one, one, one == (float) n_one ? "OK" : "FAILED");
+    ok &= one == (float) n_one;
+
+    // Moments
+    printf("distribution, mean, variance, expected mean, expected variance, within 1 sigma\n");
+    for (int dist = PRNG_UNIFORM; dist <= PRNG_NORMAL; dist++) {
+        simdnorm_generate(ctx, U, N, dist, 0.0f, 1.0f, SEED);
+
+        double sum = 0, sum2 = 0;
+        for (size_t i = 0; i < N; i++) {
+            sum += U[i];
+            sum2 += (double) U[i] * U[i];
+        }
+        double mean = sum / (double) N, var = sum2 / (double) N - mean * mean;
+
+        size_t within = 0;
+        for (size_t i = 0; i < N; i++)
+            within += fabs(U[i] - mean) <= sqrt(var);
+
+        printf("%s, %f, %f, %f, %f, %f\n", prng_name(dist), mean, var, dist == PRNG_UNIFORM ? 0.5 : 0.0,
+               dist == PRNG_UNIFORM ? 1.0 / 12 : 1.0, (double) within / (double) N);
+    }
+
+    // Throughput
+    harness_config_t config = {1, 10, 3, 2.0, NULL, 0};
+    const char *names[MODE_COUNT] = {"rand()", "scalar", "avx2", "pool"};
+    printf("distribution, generator, median s, GB/s, speedup vs rand()\n");
+
+    double t_rand = 0;
+    for (int dist = 0; dist < PRNG_COUNT; dist++) {
+        for (int mode = 0; mode < MODE_COUNT; mode++) {
+            // rand() only knows one distribution, and it is slow: at most 16 M elements
+            if (mode == MODE_RAND && dist != PRNG_UNIFORM)
+                continue;
+
+            call_t c = {mode, dist, ctx, U, (mode == MODE_RAND && N > (1 << 24)) ? (size_t) 1 << 24 : N};
+            harness_result_t r;
+            harness_measure((harness_fn_t) call, &c, &config, &r);
+
+            double per_elt = r.seconds.median / (double) c.N;
+            if (mode == MODE_RAND)
+                t_rand = per_elt;
+
+            printf("%s, %s, %e, %0.2f, ", prng_name(dist), names[mode], r.seconds.median,
+                   (double) c.N * sizeof(float) / r.seconds.median * 1E-9);
+            if (t_rand > 0)
+                printf("x%0.1f\n", t_rand / per_elt);
+            else
+                printf("n/a\n");
+        }
+    }
+
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+    free(V);
+
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+#include <string.h>
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "half.h"
+#include "kernels.h"
+
+// =============================================================== \\
+// Conversions
+
+static inline uint32_t bits_of(float x) {
+    uint32_t b;
+    memcpy(&b, &x, sizeof(b));
+    return b;
+}
+
+static inline float float_of(uint32_t b) {
+    float x;
+    memcpy(&x, &b, sizeof(x));
+    return x;
+}
+
+float f16_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+
+    // Zero and subnormals: mant * 2^-24
+    if (exp == 0) {
+        float v = (float) mant * 0x1p-24f;
+        return float_of(bits_of(v) | sign);
+    }
+
+    // Infinities and NaN
+    if (exp == 31)
+        return float_of(sign | 0x7f800000 | (mant << 13));
+
+    // Exponent bias 15 -> 127
+    return float_of(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+uint16_t float_to_f16(float x) {
+    uint32_t b = bits_of(x);
+    uint16_t sign = (uint16_t) ((b >> 16) & 0x8000);
+    float a = fabsf(x);
+
+    if (isnan(x))
+        return sign | 0x7e00;
+
+    // Above the largest half (65504) + half an ULP: infinity
+    if (a >= 65520.0f)
+        return sign | 0x7c00;
+
+    // Subnormal halves: multiples of 2^-24, rounded to nearest even by rintf (may round up to the smallest normal)
+    if (a < 0x1p-14f)
+        return sign | (uint16_t) rintf(a * 0x1p24f);
+
+    uint32_t mant = b & 0x7fffff;
+    uint32_t h = ((((b >> 23) & 0xff) - 112) << 10) | (mant >> 13);
+    uint32_t rest = mant & 0x1fff;
+
+    // Round to nearest even, a carry goes into the exponent
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+        h++;
+
+    return sign | (uint16_t) h;
+}
+
+// bfloat16 is the upper half of a float
+float bf16_to_float(uint16_t h) {
+    return float_of((uint32_t) h << 16);
+}
+
+uint16_t float_to_bf16(float x) {
+    uint32_t b = bits_of(x);
+
+    // Quiet NaN, the rounding could turn it into an infinity
+    if (isnan(x))
+        return (uint16_t) ((b >> 16) | 0x40);
+
+    b += 0x7fff + ((b >> 16) & 1);
+
+    return (uint16_t) (b >> 16);
+}
+
+// =============================================================== \\
+// Scalar versions
+
+__attribute__((optimize("no-tree-vectorize")))
+float norm_f16(const uint16_t *U, size_t N) {
+    float d = 0.0f;
+
+    for (size_t i = 0; i < N; i++)
+        d += sqrtf(fabsf(f16_to_float(U[i])));
+
+    return d;
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+float norm_bf16(const uint16_t *U, size_t N) {
+    float d = 0.0f;
+
+    for (size_t i = 0; i < N; i++)
+        d += sqrtf(fabsf(bf16_to_float(U[i])));
+
+    return d;
+}
+
+// =============================================================== \\
+// AVX2 versions, the conversion is done in the registers
+
+#pragma GCC push_options
+#pragma GCC target("avx2,f16c")
+
+// 8 halves -> 8 floats
+static inline __m256 widen_f16(const uint16_t *U) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) U));
+}
+
+// 8 bfloat16 -> 8 floats: zero extended to 32 bits, then shifted to the upper half
+static inline __m256 widen_bf16(const uint16_t *U) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) U)), 16));
+}
+
+// Body shared by both formats, bf16 is a constant so each kernel only keeps its own conversion
+static inline __attribute__((always_inline)) float vect_norm_half_body(const uint16_t *U, size_t N, const int bf16) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+
+#define WIDEN(p) (bf16 ? widen_bf16(p) : widen_f16(p))
+
+    size_t i = 0;
+
+    for (; i + 32 <= N; i += 32) {
+        // 64 bytes per iteration: half the lines of the float kernel for the same number of elements
+        _mm_prefetch((const char *) (U + i + 2 * PREFETCH_DISTANCE), _MM_HINT_T0);
+        acc0 = _mm256_add_ps(acc0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, WIDEN(U + i))));
+        acc1 = _mm256_add_ps(acc1, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, WIDEN(U + i + 8))));
+        acc2 = _mm256_add_ps(acc2, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, WIDEN(U + i + 16))));
+        acc3 = _mm256_add_ps(acc3, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, WIDEN(U + i + 24))));
+    }
+
+    for (; i + 8 <= N; i += 8)
+        acc0 = _mm256_add_ps(acc0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, WIDEN(U + i))));
+
+    // Tail: no masked load for 16 bits elements, we copy them into a zeroed vector (sqrt(0) = 0)
+    if (i < N) {
+        uint16_t tail[8] = {0};
+        memcpy(tail, U + i, (N - i) * sizeof(uint16_t));
+        acc0 = _mm256_add_ps(acc0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, WIDEN(tail))));
+    }
+
+#undef WIDEN
+
+    acc0 = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+
+    float acc_f[8];
+    _mm256_storeu_ps(acc_f, acc0);
+
+    float result = 0;
+    for (unsigned int k = 0; k < 8; k++)
+        result += acc_f[k];
+
+    return result;
+}
+
+static float vect_norm_f16_avx2(const uint16_t *U, size_t N) {
+    return vect_norm_half_body(U, N, 0);
+}
+
+static float vect_norm_bf16_avx2(const uint16_t *U, size_t N) {
+    return vect_norm_half_body(U, N, 1);
+}
+
+#pragma GCC pop_options
+
+// =============================================================== \\
+// Selection
+
+int f16_vectorized() {
+    __builtin_cpu_init();
+    return kernel_supported(KERNEL_AVX2) && __builtin_cpu_supports("f16c");
+}
+
+int bf16_vectorized() {
+    return kernel_supported(KERNEL_AVX2);
+}
+
+float vect_norm_f16(const uint16_t *U, size_t N) {
+    return f16_vectorized() ? vect_norm_f16_avx2(U, N) : norm_f16(U, N);
+}
+
+float vect_norm_bf16(const uint16_t *U, size_t N) {
+    return bf16_vectorized() ? vect_norm_bf16_avx2(U, N) : norm_bf16(U, N);
+}
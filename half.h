@@ -0,0 +1,30 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Norm of half precision (IEEE fp16) and bfloat16 arrays, widened to float in the registers
+// Half the bytes of a float array for the same number of elements: up to twice the throughput once memory bound
+// The elements are stored as uint16_t
+
+// Conversions (round to nearest even), to build the arrays and for the scalar kernels
+float f16_to_float(uint16_t h);
+uint16_t float_to_f16(float x);
+float bf16_to_float(uint16_t h);
+uint16_t float_to_bf16(float x);
+
+// Sum of sqrt(|U[i]|), U can have any alignment and N any value
+float norm_f16(const uint16_t *U, size_t N);
+float norm_bf16(const uint16_t *U, size_t N);
+
+// AVX2 (and F16C for fp16): 8 elements widened per instruction, 4 accumulators, as vect_norm_avx2
+// They fall back to the scalar versions if the CPU does not support it
+float vect_norm_f16(const uint16_t *U, size_t N);
+float vect_norm_bf16(const uint16_t *U, size_t N);
+
+// 1 if vect_norm_f16 / vect_norm_bf16 are vectorized on this CPU
+int f16_vectorized();
+int bf16_vectorized();
+
+#endif //HALF_H
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "harness.h"
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// What is measured
+#define MODE_FLOAT 0       // float array
+#define MODE_F16 1         // fp16 array, widened in the registers
+#define MODE_BF16 2        // bf16 array, widened in the registers
+#define MODE_CONVERT 3     // fp16 array converted into a float buffer first, then the float norm
+#define MODE_COUNT 4
+
+typedef struct {
+    int mode;
+    simdnorm_ctx_t *ctx;
+    float *U;
+    uint16_t *H;
+    uint16_t *B;
+    float *tmp;
+    size_t N;
+    volatile float result;
+} call_t;
+
+void call(call_t *c) {
+    switch (c->mode) {
+        case MODE_FLOAT:
+            c->result = simdnorm_l1sqrt(c->ctx, c->U, c->N);
+            break;
+        case MODE_F16:
+            c->result = simdnorm_l1sqrt_f16(c->ctx, c->H, c->N);
+            break;
+        case MODE_BF16:
+            c->result = simdnorm_l1sqrt_bf16(c->ctx, c->B, c->N);
+            break;
+        default:
+            for (size_t i = 0; i < c->N; i++)
+                c->tmp[i] = f16_to_float(c->H[i]);
+            c->result = simdnorm_l1sqrt(c->ctx, c->tmp, c->N);
+    }
+}
+
+// Double reference of the norm of the values actually stored
+double reference(call_t *c) {
+    double s = 0;
+
+    for (size_t i = 0; i < c->N; i++) {
+        float x = c->U[i];
+        if (c->mode == MODE_F16 || c->mode == MODE_CONVERT)
+            x = f16_to_float(c->H[i]);
+        else if (c->mode == MODE_BF16)
+            x = bf16_to_float(c->B[i]);
+        s += sqrt(fabs((double) x));
+    }
+
+    return s;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements, in DRAM by default (512 MB of floats)
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 27;
+
+    // Get number of threads
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    call_t c = {MODE_FLOAT, ctx,
+                (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N),
+                (uint16_t *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(uint16_t) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE)),
+                (uint16_t *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(uint16_t) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE)),
+                (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N), N, 0};
+
+    // The same values in the 3 formats (rounded to nearest even)
+    for (size_t i = 0; i < N; i++) {
+        c.U[i] = 2.0f * ((float) rand() / (float) (RAND_MAX)) - 1.0f;
+        c.H[i] = float_to_f16(c.U[i]);
+        c.B[i] = float_to_bf16(c.U[i]);
+        c.tmp[i] = 0;
+    }
+
+    harness_config_t config = {2, 50, 5, 2.0, NULL, 0};
+    const char *names[MODE_COUNT] = {"float", "fp16", "bf16", "fp16 -> float buffer"};
+    // Bytes of the input per element (the conversion mode also writes and reads the float buffer)
+    const size_t elt_size[MODE_COUNT] = {sizeof(float), sizeof(uint16_t), sizeof(uint16_t), sizeof(uint16_t)};
+
+    printf("N = %zu, %u threads, kernel %s, fp16 %s, bf16 %s\n", N, nb_thread, kernel_name(kernel_current()),
+           f16_vectorized() ? "F16C" : "scalar", bf16_vectorized() ? "AVX2" : "scalar");
+    printf("format, median s, Gelt/s, GB/s read, speedup vs float, relative error\n");
+
+    double t_float = 0;
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        c.mode = mode;
+        harness_result_t r;
+        harness_measure((harness_fn_t) call, &c, &config, &r);
+
+        if (mode == MODE_FLOAT)
+            t_float = r.seconds.median;
+
+        double ref = reference(&c);
+
+        printf("%s, %e, %0.2f, %0.2f, x%0.2f, %e\n", names[mode], r.seconds.median, (double) N / r.seconds.median * 1E-9,
+               (double) N * elt_size[mode] / r.seconds.median * 1E-9, t_float / r.seconds.median,
+               fabs((double) c.result - ref) / ref);
+    }
+
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(c.U);
+    free(c.H);
+    free(c.B);
+    free(c.tmp);
+
+
+    return 0;
+}
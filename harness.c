@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <immintrin.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#include "harness.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+double harness_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+
+    return (double) t.tv_sec + (double) t.tv_nsec * 1E-9;
+}
+
+unsigned long long harness_cycles() {
+    unsigned int aux;
+    unsigned long long c = __rdtscp(&aux);
+
+    // rdtscp waits for the previous instructions, the lfence keeps the next ones after it
+    _mm_lfence();
+
+    return c;
+}
+
+void harness_flush(const void *p, size_t bytes) {
+    const char *begin = (const char *) ((uintptr_t) p & ~(uintptr_t) (CACHE_LINE_SIZE - 1));
+    const char *end = (const char *) p + bytes;
+
+    for (const char *line = begin; line < end; line += CACHE_LINE_SIZE)
+        _mm_clflush(line);
+
+    _mm_mfence();
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+void harness_stats(double *samples, unsigned int n, harness_stats_t *stats) {
+    if (n == 0) {
+        stats->min = stats->median = stats->p99 = stats->max = stats->mean = 0;
+        return;
+    }
+
+    qsort(samples, n, sizeof(double), compare_double);
+
+    double sum = 0;
+    for (unsigned int i = 0; i < n; i++)
+        sum += samples[i];
+
+    stats->min = samples[0];
+    stats->median = (n % 2) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    // Nearest rank
+    stats->p99 = samples[(unsigned int) ((n - 1) * 0.99 + 0.5)];
+    stats->max = samples[n - 1];
+    stats->mean = sum / n;
+}
+
+void harness_measure(harness_fn_t fn, void *args, const harness_config_t *config, harness_result_t *result) {
+    double *seconds = (double *) malloc(sizeof(double) * (config->reps > 0 ? config->reps : 1));
+    double *cycles = (double *) malloc(sizeof(double) * (config->reps > 0 ? config->reps : 1));
+
+    for (unsigned int w = 0; w < config->warmup; w++)
+        fn(args);
+
+    double spent = 0;
+    unsigned int r = 0;
+
+    for (; r < config->reps; r++) {
+        if (r >= config->min_reps && spent >= config->budget)
+            break;
+
+        if (config->flush != NULL)
+            harness_flush(config->flush, config->flush_bytes);
+
+        double t0 = harness_now();
+        unsigned long long c0 = harness_cycles();
+
+        fn(args);
+
+        unsigned long long c1 = harness_cycles();
+        double t1 = harness_now();
+
+        seconds[r] = t1 - t0;
+        cycles[r] = (double) (c1 - c0);
+        spent += t1 - t0;
+    }
+
+    result->reps = r;
+    harness_stats(seconds, r, &result->seconds);
+    harness_stats(cycles, r, &result->cycles);
+
+    free(seconds);
+    free(cycles);
+}
@@ -0,0 +1,56 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <stddef.h>
+
+// Benchmark harness: warmup, repetitions and statistics over the samples
+// Times come from CLOCK_MONOTONIC_RAW (never adjusted by NTP, unlike CLOCK_REALTIME) and cycles from rdtscp
+
+// Statistics over the samples of a measure
+typedef struct {
+    double min;
+    double median;
+    double p99;
+    double max;
+    double mean;
+} harness_stats_t;
+
+// Measure of harness_measure: seconds and TSC cycles of each repetition
+typedef struct {
+    unsigned int reps;
+    harness_stats_t seconds;
+    harness_stats_t cycles;
+} harness_result_t;
+
+// Function measured, called with args once per repetition
+typedef void (*harness_fn_t)(void *args);
+
+// Settings of a measure
+typedef struct {
+    // Calls before the measure (not timed)
+    unsigned int warmup;
+    // Timed calls, at least min_reps of them, then we stop once budget seconds have been spent
+    unsigned int reps;
+    unsigned int min_reps;
+    double budget;
+    // Cold cache: [flush, flush + flush_bytes) is evicted from every cache level before each call, NULL for warm
+    const void *flush;
+    size_t flush_bytes;
+} harness_config_t;
+
+// Seconds on CLOCK_MONOTONIC_RAW
+double harness_now();
+
+// TSC, serialized with the previous instructions (rdtscp)
+unsigned long long harness_cycles();
+
+// Evict [p, p + bytes) from every cache level (clflush)
+void harness_flush(const void *p, size_t bytes);
+
+// Statistics of n samples, the samples are sorted in place
+void harness_stats(double *samples, unsigned int n, harness_stats_t *stats);
+
+// Warmup, then the timed repetitions of fn(args)
+void harness_measure(harness_fn_t fn, void *args, const harness_config_t *config, harness_result_t *result);
+
+#endif //HARNESS_H
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <time.h>
+
+#include "buffer.h"
+#include "harness.h"
+#include "perf.h"
+#include "simdnorm.h"
+
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    float *U;
+    size_t N;
+    volatile float result;
+} call_t;
+
+void call(call_t *c) {
+    c->result = simdnorm_l1sqrt(c->ctx, c->U, c->N);
+}
+
+// Values written by the workers, on their own pages
+typedef struct {
+    float *U;
+    size_t N;
+    unsigned int nb_thread;
+} fill_t;
+
+void fill_job(fill_t *job, unsigned int worker) {
+    size_t begin = (job->N * worker) / job->nb_thread;
+    size_t end = (job->N * (worker + 1)) / job->nb_thread;
+
+    for (size_t i = begin; i < end; i++)
+        job->U[i] = (float) (i & 1023) * (1.0f / 1024.0f);
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements, 1 GB of floats by default
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 28;
+
+    // Get number of threads
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    printf("N = %zu (%0.1f MB), %u threads, kernel %s\n", N, (double) N * sizeof(float) / (1 << 20), nb_thread,
+           kernel_name(kernel_current()));
+    if (!perf_compiled())
+        printf("dTLB misses: counters not compiled in (cmake -DSIMDNORM_PERF=ON)\n");
+    printf("asked, backing, huge pages MB, prefault s, median s, GB/s, dTLB misses per call, per MB\n");
+
+    harness_config_t config = {2, 30, 5, 2.0, NULL, 0};
+    int measured[BUFFER_COUNT] = {0};
+
+    for (int best = BUFFER_COUNT - 1; best >= BUFFER_PLAIN; best--) {
+        buffer_t buf;
+        if (buffer_alloc(&buf, sizeof(float) * N, best, simdnorm_pool(ctx)) != 0) {
+            printf("%s, could not map %zu bytes\n", buffer_backing_name(best), sizeof(float) * N);
+            exit(1);
+        }
+
+        // Already measured through a fallback
+        if (measured[buf.backing]) {
+            printf("%s, %s, measured above\n", buffer_backing_name(best), buffer_backing_name(buf.backing));
+            buffer_free(&buf);
+            continue;
+        }
+        measured[buf.backing] = 1;
+
+        fill_t fill = {(float *) buf.ptr, N, nb_thread};
+        pool_run(simdnorm_pool(ctx), (pool_job_t) fill_job, &fill);
+
+        call_t c = {ctx, (float *) buf.ptr, N, 0};
+        harness_result_t r;
+
+        perf_totals_t *totals = pool_perf(simdnorm_pool(ctx));
+        perf_reset(totals);
+        harness_measure((harness_fn_t) call, &c, &config, &r);
+
+        // Compute phase of every worker, warmup included
+        unsigned long long misses = 0, calls = 0;
+        for (unsigned int w = 0; w < nb_thread; w++) {
+            const perf_phase_t *p = perf_phase(totals, w, PERF_COMPUTE);
+            if (p != NULL)
+                misses += p->values[PERF_DTLB_MISSES];
+        }
+        if (perf_phase(totals, 0, PERF_COMPUTE) != NULL)
+            calls = perf_phase(totals, 0, PERF_COMPUTE)->calls;
+
+        printf("%s, %s, %0.1f, %e, %e, %0.2f", buffer_backing_name(best), buffer_backing_name(buf.backing),
+               (double) buffer_huge_bytes(&buf) / (1 << 20), buf.prefault_seconds, r.seconds.median,
+               (double) N * sizeof(float) / r.seconds.median * 1E-9);
+        if (perf_counter_available(PERF_DTLB_MISSES) && calls > 0)
+            printf(", %0.0f, %0.2f\n", (double) misses / (double) calls,
+                   (double) misses / (double) calls / ((double) N * sizeof(float) / (1 << 20)));
+        else
+            printf(", n/a, n/a\n");
+
+        buffer_free(&buf);
+    }
+
+    simdnorm_destroy(ctx);
+
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "harness.h"
+#include "normcache.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Fractions of the array changed between two queries
+#define NB_FRACTIONS 8
+const double fractions[NB_FRACTIONS] = {1E-7, 1E-6, 1E-5, 1E-4, 1E-3, 1E-2, 1E-1, 1};
+
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    normcache_t *cache;
+    float *U;
+    size_t N;
+    // The k positions written before each query, and the sign flipped at each call so the values really change
+    size_t *positions;
+    size_t k;
+    float sign;
+    volatile float result;
+} call_t;
+
+// k point updates through the cache, then a query
+void call_cache(call_t *c) {
+    c->sign = -c->sign;
+    for (size_t j = 0; j < c->k; j++)
+        normcache_set(c->cache, c->positions[j], c->sign * (float) (j & 255));
+
+    c->result = normcache_norm(c->cache);
+}
+
+// The same k writes into the array, then a full rescan
+void call_rescan(call_t *c) {
+    c->sign = -c->sign;
+    for (size_t j = 0; j < c->k; j++)
+        c->U[c->positions[j]] = c->sign * (float) (j & 255);
+
+    c->result = simdnorm_l1sqrt(c->ctx, c->U, c->N);
+}
+
+// Double reference of the norm of U[begin, end)
+double reference(float *U, size_t begin, size_t end) {
+    double s = 0;
+
+    for (size_t i = begin; i < end; i++)
+        s += sqrt(fabs((double) U[i]));
+
+    return s;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements, 256 MB of floats by default
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 26;
+
+    // Get number of threads
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    if (N == 0) {
+        printf("Usage: %s [nb_elts] [nb_threads]\n", argv[0]);
+        exit(1);
+    }
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+    // The cache reproduces the tree reduction, the rescan uses it too
+    simdnorm_set_reduction(ctx, REDUCE_TREE);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+    size_t *positions = (size_t *) malloc(sizeof(size_t) * N);
+
+    for (size_t i = 0; i < N; i++)
+        U[i] = 2.0f * ((float) rand() / (float) (RAND_MAX)) - 1.0f;
+
+    double t0 = harness_now();
+    normcache_t *cache = normcache_create(ctx, U, N);
+    double t_create = harness_now() - t0;
+
+    printf("N = %zu, %u threads, kernel %s, %zu tiles of %d floats, creation %e s\n", N, nb_thread,
+           kernel_name(kernel_current()), cache->nb_tiles, NORMCACHE_TILE, t_create);
+    printf("dirty fraction, writes, dirty tiles, update+query s, rescan s, speedup, identical\n");
+
+    harness_config_t config = {2, 50, 5, 1.0, NULL, 0};
+    call_t c = {ctx, cache, U, N, positions, 0, 1, 0};
+
+    for (int f = 0; f < NB_FRACTIONS; f++) {
+        c.k = (size_t) (fractions[f] * (double) N);
+        if (c.k == 0)
+            c.k = 1;
+
+        for (size_t j = 0; j < c.k; j++)
+            positions[j] = (size_t) (((double) rand() / ((double) RAND_MAX + 1)) * (double) N);
+
+        // Tiles touched by the writes of a call
+        normcache_norm(cache);
+        for (size_t j = 0; j < c.k; j++)
+            normcache_touch(cache, positions[j], 1);
+        size_t dirty = cache->nb_dirty;
+
+        harness_result_t r_cache, r_rescan;
+        harness_measure((harness_fn_t) call_cache, &c, &config, &r_cache);
+        harness_measure((harness_fn_t) call_rescan, &c, &config, &r_rescan);
+
+        // Both calls see the same array: the cache must give the rescan bit for bit
+        float cached = normcache_norm(cache);
+        float scanned = simdnorm_l1sqrt(ctx, U, N);
+
+        printf("%g, %zu, %zu, %e, %e, x%0.1f, %s\n", fractions[f], c.k, dirty, r_cache.seconds.median,
+               r_rescan.seconds.median, r_rescan.seconds.median / r_cache.seconds.median,
+               cached == scanned ? "yes" : "NO");
+    }
+
+    // Range queries on unaligned bounds against a double reference
+    double worst = 0;
+    for (int q = 0; q < 16; q++) {
+        size_t a = (size_t) (((double) rand() / ((double) RAND_MAX + 1)) * (double) N);
+        size_t b = (size_t) (((double) rand() / ((double) RAND_MAX + 1)) * (double) N);
+        size_t lo = a < b ? a : b, hi = a < b ? b : a;
+
+        double ref = reference(U, lo, hi);
+        double err = ref > 0 ? fabs((double) normcache_norm_range(cache, lo, hi) - ref) / ref : 0;
+        if (err > worst)
+            worst = err;
+    }
+    printf("range queries: worst relative error %e\n", worst);
+
+    normcache_destroy(cache);
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+    free(positions);
+
+
+    return 0;
+}
@@ -0,0 +1,405 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "kernels.h"
+
+// Each kernel is compiled for its own instruction set (we do not pass any -m flag for the whole project)
+// so every variant lives in the same binary and the dispatcher only calls the ones supported by the CPU
+
+// Classical norm function
+__attribute__((optimize("no-tree-vectorize")))
+float norm(float *U, size_t N) {
+    // We split the computations in two blocks because we keep adding small numbers to a large float
+    // thus leading to add only 0 each time
+    float d1 = 0.0f;
+    float b;
+    for (size_t i = 0; i < N; i++) {
+        b = fabsf(U[i]);
+        b = sqrtf(b);
+        d1+=b;
+
+    }
+
+    return d1;
+}
+
+// =============================================================== \\
+// SSE2: 4 floats per vector, no masked loads thus the head and the tail are scalar
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+
+float vect_norm_sse2(float *U, size_t N) {
+    __m128 acc = _mm_set1_ps(0.0f);
+    __m128 sign_mask = _mm_set1_ps(-0.f);
+
+    float result = 0;
+    size_t i = 0;
+
+    // Peeling up to the first 16 bytes boundary
+    while (i < N && ((uintptr_t) (U + i) & 15) != 0) {
+        result += sqrtf(fabsf(U[i]));
+        i++;
+    }
+
+    if (((uintptr_t) (U + i) & 15) == 0) {
+        for (; i + 4 <= N; i += 4)
+            acc = _mm_add_ps(acc, _mm_sqrt_ps(_mm_andnot_ps(sign_mask, _mm_load_ps(U + i))));
+    }
+
+    // Tail
+    for (; i < N; i++)
+        result += sqrtf(fabsf(U[i]));
+
+    float *acc_fptr = (float *) &acc;
+    for (unsigned int k = 0; k < 4; k++)
+        result += acc_fptr[k];
+
+    return result;
+}
+
+#pragma GCC pop_options
+
+// =============================================================== \\
+// AVX2: 8 floats per vector, masked loads for the head and the tail
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+// Mask selecting the n first lanes of a vector (n <= 8)
+static inline __m256i first_lanes(unsigned int n) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32((int) n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+// Body of the AVX2 kernels, nb_acc independent accumulators (1, 2, 4 or 8)
+// With a single accumulator each add has to wait for the previous one (about 4 cycles): the FP ports and the sqrt
+// unit are mostly idle. With nb_acc accumulators we have nb_acc independent dependency chains.
+// Always inlined with a constant nb_acc, so the inner loops are fully unrolled and the accumulators stay in registers
+static inline __attribute__((always_inline))
+float avx2_unrolled(float *U, size_t N, const unsigned int nb_acc) {
+    // Accumulators to store 8 partial sums each
+    __m256 acc[8];
+
+#pragma GCC unroll 8
+    for (unsigned int a = 0; a < nb_acc; a++)
+        acc[a] = _mm256_set1_ps(0.0f);
+
+    // Sign mask to take abs value
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+
+    size_t i = 0;
+
+    if (((uintptr_t) U & (sizeof(float) - 1)) == 0) {
+        // Peeling: we handle the floats before the first 32 bytes boundary with a masked load
+        // The masked lanes are neither read (no fault) nor added (they are loaded as 0, sqrt(0) = 0)
+        unsigned int head = (unsigned int) (((32 - ((uintptr_t) U & 31)) & 31) / sizeof(float));
+        if (head > N)
+            head = (unsigned int) N;
+
+        if (head > 0) {
+            __m256 x = _mm256_maskload_ps(U, first_lanes(head));
+            acc[0] = _mm256_add_ps(acc[0], _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, x)));
+            i = head;
+        }
+    }
+    // Otherwise the floats themselves are not aligned, we cannot reach a 32 bytes boundary
+
+    // Now U+i is aligned on 32 bytes (the loads below are unaligned ones only for the case above)
+    // We use vector operation to compute the square root and the absolute value
+    // Then we add the vector to the accumulators using vector add
+    for (; i + 8 * nb_acc <= N; i += 8 * nb_acc) {
+        // Out of the array the prefetch is simply dropped, no need to check the bound
+        _mm_prefetch((const char *) (U + i + PREFETCH_DISTANCE), _MM_HINT_T0);
+
+#pragma GCC unroll 8
+        for (unsigned int a = 0; a < nb_acc; a++)
+            acc[a] = _mm256_add_ps(acc[a], _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i + 8 * a))));
+    }
+
+    // Less than nb_acc vectors left
+    for (; i + 8 <= N; i += 8)
+        acc[0] = _mm256_add_ps(acc[0], _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i))));
+
+    // Tail: less than 8 floats left, masked load again
+    if (i < N) {
+        __m256 x = _mm256_maskload_ps(U + i, first_lanes((unsigned int) (N - i)));
+        acc[0] = _mm256_add_ps(acc[0], _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, x)));
+    }
+
+    // We add the accumulators together
+#pragma GCC unroll 8
+    for (unsigned int a = 1; a < nb_acc; a++)
+        acc[0] = _mm256_add_ps(acc[0], acc[a]);
+
+    // We only have to sum the 8 float in the acc vector
+    // Used to sum horitally over the vector
+    float *acc_fptr = (float *) &acc[0];
+    float result = 0;
+    for (unsigned int k = 0; k < 8; k++)
+        result += acc_fptr[k];
+
+    return result;
+}
+
+float vect_norm_avx2_x1(float *U, size_t N) {
+    return avx2_unrolled(U, N, 1);
+}
+
+float vect_norm_avx2_x2(float *U, size_t N) {
+    return avx2_unrolled(U, N, 2);
+}
+
+float vect_norm_avx2_x4(float *U, size_t N) {
+    return avx2_unrolled(U, N, 4);
+}
+
+float vect_norm_avx2_x8(float *U, size_t N) {
+    return avx2_unrolled(U, N, 8);
+}
+
+float vect_norm_avx2(float *U, size_t N) {
+    return avx2_unrolled(U, N, AVX2_UNROLL);
+}
+
+// Horizontal sums of 8 accumulators at once: lane r of the result is the sum of the lanes of acc[r]
+// 3 hadd and 2 permutes for 8 rows, instead of 8 scalar loops over acc_fptr
+static inline __m256 hsum8(const __m256 acc[8]) {
+    // Sums of the adjacent lanes of acc[0] and acc[1], acc[2] and acc[3]...
+    __m256 t0 = _mm256_hadd_ps(acc[0], acc[1]);
+    __m256 t1 = _mm256_hadd_ps(acc[2], acc[3]);
+    __m256 t2 = _mm256_hadd_ps(acc[4], acc[5]);
+    __m256 t3 = _mm256_hadd_ps(acc[6], acc[7]);
+
+    // ...then lane r of t0: sum of the low half of acc[r] for r < 4, lane 4 + r: sum of its high half
+    t0 = _mm256_hadd_ps(t0, t1);
+    t2 = _mm256_hadd_ps(t2, t3);
+
+    // Low halves + high halves
+    return _mm256_add_ps(_mm256_permute2f128_ps(t0, t2, 0x20), _mm256_permute2f128_ps(t0, t2, 0x31));
+}
+
+// Sum of sqrt(|U[i]|) of one row left in a vector, without the horizontal sum
+static inline __m256 row_acc(const float *U, size_t N) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+
+    size_t i = 0;
+    for (; i + 16 <= N; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i))));
+        acc1 = _mm256_add_ps(acc1, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i + 8))));
+    }
+
+    for (; i + 8 <= N; i += 8)
+        acc0 = _mm256_add_ps(acc0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(U + i))));
+
+    if (i < N) {
+        __m256 x = _mm256_maskload_ps(U + i, first_lanes((unsigned int) (N - i)));
+        acc0 = _mm256_add_ps(acc0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, x)));
+    }
+
+    return _mm256_add_ps(acc0, acc1);
+}
+
+void vect_norm_rows_avx2(const float *M, size_t rows, size_t cols, size_t stride, float *out) {
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+    __m256i tail = first_lanes((unsigned int) (cols & 7));
+
+    size_t r = 0;
+
+    // 8 rows in lockstep: 8 independent dependency chains, and the same column of each row at the same time
+    for (; r + 8 <= rows; r += 8) {
+        const float *row = M + r * stride;
+        __m256 acc[8];
+
+#pragma GCC unroll 8
+        for (unsigned int k = 0; k < 8; k++)
+            acc[k] = _mm256_setzero_ps();
+
+        size_t j = 0;
+        for (; j + 8 <= cols; j += 8) {
+#pragma GCC unroll 8
+            for (unsigned int k = 0; k < 8; k++)
+                acc[k] = _mm256_add_ps(acc[k], _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_loadu_ps(row + k * stride + j))));
+        }
+
+        if (j < cols) {
+#pragma GCC unroll 8
+            for (unsigned int k = 0; k < 8; k++)
+                acc[k] = _mm256_add_ps(acc[k], _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, _mm256_maskload_ps(row + k * stride + j, tail))));
+        }
+
+        _mm256_storeu_ps(out + r, hsum8(acc));
+    }
+
+    // Less than 8 rows left
+    for (; r < rows; r++)
+        out[r] = vect_norm_avx2((float *) (M + r * stride), cols);
+}
+
+void vect_norm_batch_avx2(const float *const *ptrs, const size_t *lens, size_t count, float *out) {
+    size_t r = 0;
+
+    // The rows do not have the same length: one after the other, but 8 horizontal sums at once
+    for (; r + 8 <= count; r += 8) {
+        __m256 acc[8];
+
+#pragma GCC unroll 8
+        for (unsigned int k = 0; k < 8; k++)
+            acc[k] = row_acc(ptrs[r + k], lens[r + k]);
+
+        _mm256_storeu_ps(out + r, hsum8(acc));
+    }
+
+    for (; r < count; r++)
+        out[r] = vect_norm_avx2((float *) ptrs[r], lens[r]);
+}
+
+#pragma GCC pop_options
+
+// =============================================================== \\
+// AVX-512F: 16 floats per vector, the head and the tail use zero-masking loads
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+
+float vect_norm_avx512(float *U, size_t N) {
+    // 4 independent accumulators, as for AVX2
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps();
+    __m512 acc3 = _mm512_setzero_ps();
+
+    size_t i = 0;
+
+    // Peeling up to the first 64 bytes boundary (a whole cache line)
+    if (((uintptr_t) U & (sizeof(float) - 1)) == 0) {
+        unsigned int head = (unsigned int) (((64 - ((uintptr_t) U & 63)) & 63) / sizeof(float));
+        if (head > N)
+            head = (unsigned int) N;
+
+        if (head > 0) {
+            __m512 x = _mm512_maskz_loadu_ps((__mmask16) ((1u << head) - 1), U);
+            acc0 = _mm512_add_ps(acc0, _mm512_sqrt_ps(_mm512_abs_ps(x)));
+            i = head;
+        }
+    }
+
+    for (; i + 64 <= N; i += 64) {
+        _mm_prefetch((const char *) (U + i + PREFETCH_DISTANCE), _MM_HINT_T0);
+        acc0 = _mm512_add_ps(acc0, _mm512_sqrt_ps(_mm512_abs_ps(_mm512_loadu_ps(U + i))));
+        acc1 = _mm512_add_ps(acc1, _mm512_sqrt_ps(_mm512_abs_ps(_mm512_loadu_ps(U + i + 16))));
+        acc2 = _mm512_add_ps(acc2, _mm512_sqrt_ps(_mm512_abs_ps(_mm512_loadu_ps(U + i + 32))));
+        acc3 = _mm512_add_ps(acc3, _mm512_sqrt_ps(_mm512_abs_ps(_mm512_loadu_ps(U + i + 48))));
+    }
+
+    for (; i + 16 <= N; i += 16)
+        acc0 = _mm512_add_ps(acc0, _mm512_sqrt_ps(_mm512_abs_ps(_mm512_loadu_ps(U + i))));
+
+    // Tail: less than 16 floats left
+    if (i < N) {
+        __m512 x = _mm512_maskz_loadu_ps((__mmask16) ((1u << (unsigned int) (N - i)) - 1), U + i);
+        acc0 = _mm512_add_ps(acc0, _mm512_sqrt_ps(_mm512_abs_ps(x)));
+    }
+
+    acc0 = _mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3));
+
+    return _mm512_reduce_add_ps(acc0);
+}
+
+#pragma GCC pop_options
+
+// =============================================================== \\
+// Dispatch
+
+static kernel_fn_t kernels[KERNEL_COUNT] = {norm, vect_norm_sse2, vect_norm_avx2, vect_norm_avx512};
+static const char *names[KERNEL_COUNT] = {"scalar", "sse2", "avx2", "avx512"};
+
+// Kernel used by vect_norm, scalar until the constructor below runs
+static int current = KERNEL_SCALAR;
+static kernel_fn_t current_kernel = norm;
+
+int kernel_supported(int kernel) {
+    __builtin_cpu_init();
+
+    switch (kernel) {
+        case KERNEL_SCALAR:
+            return 1;
+        case KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f");
+        default:
+            return 0;
+    }
+}
+
+int kernel_select(int kernel) {
+    if (kernel < 0 || kernel >= KERNEL_COUNT)
+        kernel = KERNEL_COUNT - 1;
+
+    while (!kernel_supported(kernel))
+        kernel--;
+
+    current = kernel;
+    current_kernel = kernels[kernel];
+
+    return kernel;
+}
+
+kernel_fn_t kernel_function(int kernel) {
+    if (kernel < 0 || kernel >= KERNEL_COUNT)
+        kernel = KERNEL_COUNT - 1;
+
+    while (!kernel_supported(kernel))
+        kernel--;
+
+    return kernels[kernel];
+}
+
+int kernel_current() {
+    return current;
+}
+
+const char *kernel_name(int kernel) {
+    if (kernel < 0 || kernel >= KERNEL_COUNT)
+        return "unknown";
+
+    return names[kernel];
+}
+
+int kernel_from_name(const char *name) {
+    for (int k = 0; k < KERNEL_COUNT; k++)
+        if (strcmp(name, names[k]) == 0)
+            return k;
+
+    return -1;
+}
+
+// Runs once before main: the best kernel supported by the CPU, unless forced through the environment
+__attribute__((constructor))
+static void kernel_init() {
+    int kernel = KERNEL_COUNT - 1;
+    const char *forced = getenv(KERNEL_ENV);
+
+    if (forced != NULL) {
+        kernel = kernel_from_name(forced);
+        if (kernel < 0) {
+            printf("Unknown kernel %s, using the best one available\n", forced);
+            kernel = KERNEL_COUNT - 1;
+        }
+    }
+
+    kernel_select(kernel);
+}
+
+float vect_norm(float *U, size_t N) {
+    return current_kernel(U, N);
+}
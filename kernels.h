@@ -0,0 +1,71 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+
+// Kernels available for vect_norm, the best one supported by the CPU is picked at startup
+#define KERNEL_SCALAR 0
+#define KERNEL_SSE2 1
+#define KERNEL_AVX2 2
+#define KERNEL_AVX512 3
+#define KERNEL_COUNT 4
+
+// Environment variable used to force a kernel (scalar, sse2, avx2 or avx512), mostly for benchmarking
+#define KERNEL_ENV "SIMDNORM_KERNEL"
+
+// Number of independent accumulators of vect_norm_avx2 (1, 2, 4 or 8), can be set with -DAVX2_UNROLL=n
+#ifndef AVX2_UNROLL
+#define AVX2_UNROLL 4
+#endif
+
+// Software prefetch distance of the unrolled kernels, in floats
+#ifndef PREFETCH_DISTANCE
+#define PREFETCH_DISTANCE 512
+#endif
+
+// Classical norm function: sum of sqrt(|U[i]|)
+float norm(float *U, size_t N);
+
+// Per-ISA versions of the vectorized norm, U can have any alignment and N any value
+// They can only be called if the CPU supports them (see kernel_supported)
+float vect_norm_sse2(float *U, size_t N);
+float vect_norm_avx2(float *U, size_t N);
+float vect_norm_avx512(float *U, size_t N);
+
+// AVX2 kernel with 1, 2, 4 or 8 independent accumulators, vect_norm_avx2 is the one selected by AVX2_UNROLL
+float vect_norm_avx2_x1(float *U, size_t N);
+float vect_norm_avx2_x2(float *U, size_t N);
+float vect_norm_avx2_x4(float *U, size_t N);
+float vect_norm_avx2_x8(float *U, size_t N);
+
+// Batched norms of short rows (AVX2 only): 8 rows at a time, their horizontal sums done together (transpose / hadd)
+// Rows of a row-major matrix, row r starting at M + r*stride
+void vect_norm_rows_avx2(const float *M, size_t rows, size_t cols, size_t stride, float *out);
+// Arrays of any length, out[r] = norm of (ptrs[r], lens[r])
+void vect_norm_batch_avx2(const float *const *ptrs, const size_t *lens, size_t count, float *out);
+
+// Signature shared by every kernel
+typedef float (*kernel_fn_t)(float *U, size_t N);
+
+// Function of a kernel (the best supported one below it if the CPU does not support it)
+kernel_fn_t kernel_function(int kernel);
+
+// Vectorized norm, calls the kernel selected at startup
+float vect_norm(float *U, size_t N);
+
+// 1 if the CPU (and the OS) can run the kernel
+int kernel_supported(int kernel);
+
+// Use the given kernel from now on, if it is not supported we fall back to the best supported one below it
+// Returns the kernel actually selected
+int kernel_select(int kernel);
+
+// Kernel currently used by vect_norm
+int kernel_current();
+
+const char *kernel_name(int kernel);
+
+// -1 if the name is unknown
+int kernel_from_name(const char *name);
+
+#endif //KERNELS_H
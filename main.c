@@ -1,16 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <immintrin.h>
 #include <math.h>
-#include <pthread.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "numa.h"
+#include "simdnorm.h"
+#include "tune.h"
 
 #define VECT 1
 #define SCALAR 0
 
 // On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
 #define CACHE_LINE_SIZE 64
+#endif
 
 
 struct timespec diff(struct timespec start, struct timespec end)
@@ -30,169 +37,239 @@ struct timespec diff(struct timespec start, struct timespec end)
     return temp;
 }
 
-// Classical norm function
-__attribute__((optimize("no-tree-vectorize")))
-float norm(float *U, unsigned int N) {
-    // We split the computations in two blocks because we keep adding small numbers to a large float
-    // thus leading to add only 0 each time
-    float d1 = 0.0f;
-    float b;
-    for (unsigned int i = 0; i < N; i++) {
-        b = fabsf(U[i]);
-        b = sqrtf(b);
-        d1+=b;
-
-    }
-
-    return d1;
-}
-float vect_norm(float *U, unsigned int N) {
-    // ptr on the array to perform the sum on
-    __m256* u_v = (__m256*) U;
-
-    // Accumulator to store 8 partial sums
-    __m256 acc = _mm256_set1_ps(0.0f);
+// Context of libsimdnorm shared by every call to normPar: it is only (re)started when the number of threads changes
+// It uses the join reduction: one slice per thread, the results added in the order of the threads
+static simdnorm_ctx_t *ctx = NULL;
 
-    // Used later to sum horitally over the vector
-    float *acc_fptr = (float *) &acc;
+// Autotuner of the auto mode (see tune.h): the VECT calls take the threads, reduction and kernel of the profile for
+// their N instead of the ones of ctx
+static tune_t *tune = NULL;
 
-    // Sign mask to take abs value
-    __m256 sign_mask = _mm256_set1_ps(-0.f);
+void normPar_release();
 
-    // We use vector operation to compute the square root and the absolute value
-    // Then we add the vector to the accumulator using vector add
-    // Doing so we gain a x8 in time to compute the sum
-    for (unsigned int i = 0; i < N / 8; i++)
-        acc = _mm256_add_ps(acc, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, u_v[i])));
+// Start the threads once for nb_thread threads
+void normPar_init(unsigned int nb_thread) {
+    if (ctx != NULL && simdnorm_nb_thread(ctx) == nb_thread)
+        return;
 
-    // We only have to sum the 8 float in the acc vector
-    float result = 0;
-    for (unsigned int i = 0; i < 8; i++)
-        result += acc_fptr[i];
+    if (ctx != NULL)
+        normPar_release();
 
-    return result;
+    ctx = simdnorm_create(nb_thread);
+    if (ctx == NULL) {
+        printf("Could not start %u threads\n", nb_thread);
+        exit(1);
+    }
+    simdnorm_set_reduction(ctx, REDUCE_JOIN);
 }
 
-// to be passed to each thread
-typedef struct {
-    // begining of the array to consider
-    float *begin;
-    // Where to store the result of each thread
-    float* result;
-    // size of the considered array
-    unsigned int size;
-
-} threadarg_t;
-
-// routine used to encapsulate the call to the norm function in each thread
-float norm_routine(threadarg_t *args) {
-    // We compute the norm using the given norm function
-    // We store the result at the requested adress
-    *(args->result)= vect_norm(args->begin, args->size);
-
-    // We terminate the thread
-    pthread_exit(NULL);
-}
+// Stop the workers and free our memory
+void normPar_release() {
+    if (ctx == NULL)
+        return;
 
-float normPar(float *U, unsigned int N, int mode, unsigned int nb_thread) {
-    // pointer to the norm function to use
+    simdnorm_destroy(ctx);
+    ctx = NULL;
+}
 
+float normPar(float *U, size_t N, int mode, unsigned int nb_thread) {
     // depends on the mode
 
     if (mode == VECT) {
-        // We begin by initializing the argument for each thread
+        if (tune != NULL)
+            return tune_l1sqrt(tune, U, N);
 
-        unsigned int elt_per_thread = (N / nb_thread);
+        // The workers are started once and stay parked between two calls
+        normPar_init(nb_thread);
 
-        threadarg_t *args = (threadarg_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(threadarg_t) * nb_thread);
+        return simdnorm_l1sqrt(ctx, U, N);
+    } else {
+        // If scalar: we just call the simple norm
+        float result = norm(U, N);
 
-        pthread_t *pool = (pthread_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(pthread_t) * nb_thread);
+        // Return the result
+        return result;
 
-        // To avoid false sharing we want each result on a different cache line
-        float *results = (float *) aligned_alloc(CACHE_LINE_SIZE, (CACHE_LINE_SIZE) * nb_thread);
+    }
+}
 
-        int errcode = 0;
+// Number of calls per second of normPar on n elements, we repeat the calls during about duration seconds
+double calls_per_second(float *U, size_t n, unsigned int nb_thread, double duration) {
+    struct timespec begining, end, elapsed;
+    unsigned long calls = 0;
+    double t = 0;
+
+    // First call outside of the measure: it starts the pool
+    normPar(U, n, VECT, nb_thread);
+
+    clock_gettime(CLOCK_MONOTONIC, &begining);
+    while (t < duration) {
+        // We time batches of calls to keep the clock out of the measure
+        for (unsigned int i = 0; i < 64; i++)
+            normPar(U, n, VECT, nb_thread);
+        calls += 64;
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed = diff(begining, end);
+        t = (double) (elapsed.tv_sec * 1000000000l + elapsed.tv_nsec) * 1E-9;
+    }
 
-        for (unsigned int i = 1; i < nb_thread; i++) {
-            // We construct the argument for each thread
-            args[i].begin = U+i * elt_per_thread;
-            args[i].size = elt_per_thread;
-            args[i].result = results+(CACHE_LINE_SIZE/sizeof(float))*i;
+    return (double) calls / t;
+}
 
-            errcode += (int) pthread_create(&pool[i], NULL, (void *(*)(void *)) norm_routine, &args[i]);
+// =============================================================== \\
+// NUMA mode
 
-        }
+// Array to initialize / reduce in the NUMA mode, and time spent by each thread on its slice
+typedef struct {
+    float *U;
+    size_t N;
+    double *seconds;
+    unsigned long long seed;
+} numajob_t;
 
-        if (errcode != 0) {
-            printf("Something went wront with thread creation");
-            exit(1);
-        }
+// First touch: each thread places (on its node) and initializes the slice it will reduce later
+void numa_init_job(numajob_t *job, unsigned int worker) {
+    unsigned int nb_thread = simdnorm_nb_thread(ctx);
 
-        // Computations in the main thread
-        // We direclty store it in our result variable
+    size_t begin, size;
+    reduce_slice(job->N, nb_thread, worker, &begin, &size);
 
-        float r =vect_norm(U, elt_per_thread);
-        errcode = 0;
+    numa_bind(job->U + begin, size * sizeof(float), numa_node_of_worker(worker, nb_thread));
 
-        for (unsigned int i = 1; i < nb_thread; i++) {
-            errcode += pthread_join(pool[i], NULL);
-            // When the threads end, we retrieve their result and add it into the result variable
-            r += results[(CACHE_LINE_SIZE/sizeof(float))*i];
-        }
+    prng_fill(job->U + begin, size, PRNG_UNIFORM, 0.0f, 1.0f, job->seed, begin, 1);
+}
 
+// Each thread times the reduction of its own slice
+void numa_bandwidth_job(numajob_t *job, unsigned int worker) {
+    struct timespec begining, end;
 
-        // Check if the joins succeded
-        if (errcode != 0) {
-            printf("Something went wront with thread join");
-            exit(1);
-        }
+    size_t begin, size;
+    reduce_slice(job->N, simdnorm_nb_thread(ctx), worker, &begin, &size);
 
-        // Free our memory
-        free(pool);
-        free(args);
-        free(results);
+    clock_gettime(CLOCK_MONOTONIC, &begining);
+    volatile float r = simdnorm_l1sqrt_single(ctx, job->U + begin, size);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    (void) r;
 
-        return r;
-    } else {
-        // If scalar: we just call the simple norm
-        float result = norm(U, N);
+    struct timespec t = diff(begining, end);
+    job->seconds[worker] = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+}
 
-        // Return the result
-        return result;
+// Bandwidth achieved by the threads of each node, and where their pages actually are
+void numa_report(float *U, size_t N, unsigned int nb_thread) {
+    numajob_t job = {U, N, (double *) malloc(sizeof(double) * nb_thread), 0};
+    pool_run(simdnorm_pool(ctx), (pool_job_t) numa_bandwidth_job, &job);
+
+    long page = sysconf(_SC_PAGESIZE);
+    int nb_nodes = numa_nb_nodes();
+
+    printf("node, threads, GB/s, pages on the node (sampled)\n");
+    for (int node = 0; node < nb_nodes; node++) {
+        unsigned int threads = 0;
+        size_t bytes = 0;
+        double slowest = 0;
+        unsigned long sampled = 0, local = 0;
+
+        for (unsigned int w = 0; w < nb_thread; w++) {
+            if (numa_node_of_worker(w, nb_thread) != node)
+                continue;
+
+            size_t begin, size;
+            reduce_slice(N, nb_thread, w, &begin, &size);
+
+            threads++;
+            bytes += size * sizeof(float);
+            if (job.seconds[w] > slowest)
+                slowest = job.seconds[w];
+
+            // One page out of 64
+            for (size_t i = begin; i < begin + size; i += 64 * (size_t) page / sizeof(float)) {
+                sampled++;
+                if (numa_node_of(U + i) == numa_node_id(node))
+                    local++;
+            }
+        }
 
+        printf("%d, %u, %0.2f, %lu/%lu\n", numa_node_id(node), threads,
+               slowest > 0 ? (double) bytes / slowest * 1E-9 : 0, local, sampled);
     }
-}
 
+    free(job.seconds);
+}
 
 int main(int argc, char *argv[]) {
 
     // Check for arguments
     if (argc < 3) {
-        printf("Not enough arguments. 2 are required");
+        printf("Not enough arguments. 2 are required (nb_threads can be auto), then the options: calls (calls/second benchmark), numa (NUMA mode), hugetlb (explicit huge pages)");
         exit(1);
     }
 
-    // init random seed
-    srand((unsigned int) time(NULL));
+    // Seed of the generator: U only depends on it, not on the number of threads
+    unsigned long long seed = (unsigned long long) time(NULL);
 
     // Get number of elements
-    unsigned int N = (unsigned int) atoi(argv[1]);
+    size_t N = (size_t) strtoull(argv[1], NULL, 10);
 
 
 
-    // Get number of threads
+    // Get number of threads, auto: the vectorized calls take the threads, reduction and kernel of the tuning profile
+    // for their N (probed on the first run, see tune.h), nb_thread is then only the one of the first call
     unsigned int nb_thread = (unsigned int) atoi(argv[2]);
+    if (strcmp(argv[2], "auto") == 0) {
+        tune = tune_create(NULL, 0, 0.02);
+        if (tune == NULL) {
+            printf("Could not allocate the tuner\n");
+            exit(1);
+        }
+        tune_choice_t choice = tune_decide(tune, N);
+        nb_thread = choice.nb_thread;
+        printf("Tuned for %zu floats: %u thread(s) (%s, kernel %s)\n", N, nb_thread,
+               tune_reduction_name(choice.reduction), tune_variant_name(choice.variant));
+    }
+
+    // Options
+    int calls = 0, numa = 0, hugetlb = 0;
+    for (int a = 3; a < argc; a++) {
+        if (strcmp(argv[a], "calls") == 0)
+            calls = 1;
+        else if (strcmp(argv[a], "numa") == 0)
+            numa = 1;
+        else if (strcmp(argv[a], "hugetlb") == 0)
+            hugetlb = 1;
+    }
 
     // We allocate our array
-    // We align our array: it has 2 purposes: first it optimizes the cache
-    // and it guarantees us that the data are well aligned for the vectorial instructions
-    // since my cache line is 64
-    // It also ensures that parallel words are well aligned
-    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE*2, sizeof(float) * N);
+    // It is aligned on a huge page (2 MB), so on the cache lines and for the vectorial instructions too
+    // Huge pages: one dTLB entry per 2 MB instead of per 4 KB during the sweep (transparent ones by default, the
+    // explicit ones first with hugetlb). The pages are touched by the workers, in parallel, except in NUMA mode
+    // where they have to be bound to their node first
+    normPar_init(nb_thread);
+
+    buffer_t buffer;
+    if (buffer_alloc(&buffer, sizeof(float) * N, hugetlb ? BUFFER_HUGETLB_1G : BUFFER_THP,
+                     numa ? NULL : simdnorm_pool(ctx)) != 0) {
+        printf("Could not allocate %zu bytes\n", sizeof(float) * N);
+        exit(1);
+    }
+    float *U = (float *) buffer.ptr;
 
-    // Initialization
-    for (unsigned int i = 0; i < N; i++)
-        U[i] = ((float) rand() / (float) (RAND_MAX));
+    if (numa) {
+        // The workers are pinned on the cores of their node, and the pages of each slice are first touched by the
+        // worker which reduces it: they end up on its node instead of the node of the main thread
+        if (numa_pin_pool(simdnorm_pool(ctx)) != 0)
+            printf("Could not pin the threads, NUMA mode without pinning\n");
+        printf("NUMA mode, %d node(s)\n", numa_nb_nodes());
+
+        numajob_t job = {U, N, NULL, seed};
+        pool_run(simdnorm_pool(ctx), (pool_job_t) numa_init_job, &job);
+    } else {
+        // Initialization by the workers (counter-based generator, see prng.h)
+        simdnorm_generate(ctx, U, N, PRNG_UNIFORM, 0.0f, 1.0f, seed);
+    }
+
+    printf("Pages: %s, %zu MB of huge pages\n", buffer_backing_name(buffer.backing), buffer_huge_bytes(&buffer) >> 20);
 
     // Use to store the result
     float result;
@@ -201,27 +278,23 @@ int main(int argc, char *argv[]) {
     // Test of the classical method on a single thread
 
     struct timespec begining_classic;
-    clock_gettime(CLOCK_REALTIME, &begining_classic);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &begining_classic);
 
     normPar(U, N, SCALAR, 1);
 
     struct timespec end_classic;
-    clock_gettime(CLOCK_REALTIME, &end_classic);
-
-    // Test of the vectoriel method multithreaded
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_classic);
 
-    // Initialization
-    for (unsigned int i = 0; i < N; i++)
-       U[i] = ((float) rand() / (float) (RAND_MAX));
-       // U[i] = 1.0f;
+    // Test of the vectoriel method multithreaded, on the same data
+    // (a single run each: projetbench does warmup, repetitions and statistics)
 
     struct timespec begining_vect_thread;
-    clock_gettime(CLOCK_REALTIME, &begining_vect_thread);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &begining_vect_thread);
 
     result = normPar(U, N, VECT, nb_thread);
 
     struct timespec end_vect_thread;
-    clock_gettime(CLOCK_REALTIME, &end_vect_thread);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_vect_thread);
 
     printf("%e\n", result);
 
@@ -235,12 +308,48 @@ int main(int argc, char *argv[]) {
     double d2 = (double) (vect.tv_sec * 1000000000l + vect.tv_nsec) * 1E-9;
 
 
+    if (tune != NULL)
+        printf("Kernel: %s (tuned)\n", tune_variant_name(tune_decide(tune, N).variant));
+    else
+        printf("Kernel: %s\n", kernel_name(kernel_current()));
     printf("Usual scalar norm, 1 thread: %e\n", d1);
-    printf("Vectorized norm, %d thread: %e\n", nb_thread, d2);
+    if (tune != NULL)
+        printf("Vectorized norm, tuned (%d thread, %s): %e\n", nb_thread,
+               tune_reduction_name(tune_decide(tune, N).reduction), d2);
+    else
+        printf("Vectorized norm, %d thread: %e\n", nb_thread, d2);
 
     printf("Speedup x%0.1f\n", d1 / d2);
+
+    // =============================================================== \\
+    // Repeated calls: the pool is reused, we report the number of calls per second for growing sizes
+    if (calls) {
+        if (tune != NULL) {
+            // Each size with its own settings
+            printf("N, calls/s, threads, reduction, kernel\n");
+            for (size_t n = 1024 * nb_thread; n <= N; n *= 4) {
+                tune_choice_t choice = tune_decide(tune, n);
+                printf("%zu, %e, %u, %s, %s\n", n, calls_per_second(U, n, nb_thread, 0.2), choice.nb_thread,
+                       tune_reduction_name(choice.reduction), tune_variant_name(choice.variant));
+            }
+        } else {
+            printf("N, calls/s, %d thread\n", nb_thread);
+            for (size_t n = 1024 * nb_thread; n <= N; n *= 4)
+                printf("%zu, %e\n", n, calls_per_second(U, n, nb_thread, 0.2));
+        }
+    }
+
+    // =============================================================== \\
+    // Bandwidth per node
+    if (numa)
+        numa_report(U, N, nb_thread);
+
+    normPar_release();
+    if (tune != NULL)
+        tune_destroy(tune);
+
     // free our memory
-    free(U);
+    buffer_free(&buffer);
 
 
     return 0;
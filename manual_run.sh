@@ -3,14 +3,19 @@
 mkdir -p "build"
 cd build
 
-gcc ../main.c -O1 -fno-tree-vectorize -lpthread -lm -mavx -o projet
-gcc ../mutex.c -O1 -fno-tree-vectorize -lpthread -lm -mavx -o projetmutex
-gcc ../nonvector.c -O1 -fno-tree-vectorize -lpthread -lm -o nonvector
+# libsimdnorm
+LIB_SOURCES="../accurate.c ../async.c ../buffer.c ../half.c ../harness.c ../kernels.c ../normcache.c ../normd.c ../numa.c ../ops.c ../perf.c ../pipeline.c ../prng.c ../reduce.c ../simdnorm.c ../stats.c ../stream.c ../threadpool.c ../tune.c"
+gcc -c $LIB_SOURCES -O1 -fno-tree-vectorize -fPIC
+ar rcs libsimdnorm.a accurate.o async.o buffer.o half.o harness.o kernels.o normcache.o normd.o numa.o ops.o perf.o pipeline.o prng.o reduce.o simdnorm.o stats.o stream.o threadpool.o tune.o
 
-# gcc ../unaligned.c -O1 -fno-tree-vectorize -lpthread -lm -o unaligned
+# Benchmark drivers
+gcc ../main.c -I.. -O1 -fno-tree-vectorize -o projet -L. -lsimdnorm -lpthread -lm
+gcc ../mutex.c -I.. -O1 -fno-tree-vectorize -o projetmutex -L. -lsimdnorm -lpthread -lm
+gcc ../nonvector.c -I.. -O1 -fno-tree-vectorize -o projetnonvect -L. -lsimdnorm -lpthread -lm
+gcc ../unaligned.c -I.. -O1 -fno-tree-vectorize -o projetunaligned -L. -lsimdnorm -lpthread -lm
 
 echo "Classic non vector"
-./nonvector 33554432
+./projetnonvect 33554432
 
 echo "Standard Version 2 threads"
 ./projet 33554432 2
@@ -23,3 +28,5 @@ echo "Mutex Version 2 threads"
 echo "Mutex Version 4 threads"
 ./projetmutex 33554432 4
 
+echo "Unaligned data, 2 threads"
+./projetunaligned 33554432 2
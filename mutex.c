@@ -1,26 +1,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <immintrin.h>
 #include <math.h>
-#include <pthread.h>
+#include <string.h>
 #include <time.h>
 
+#include "simdnorm.h"
+#include "tune.h"
+
 #define VECT 1
 #define SCALAR 0
+// Vectorized norm with the deterministic tree reduction (VECT uses the lock-free one)
+#define VECT_TREE 2
 
 // On my machine a cache line is 64 bytes unsigned int
+#ifndef CACHE_LINE_SIZE
 #define CACHE_LINE_SIZE 64
-
-// Classical norm function
-float norm(float *U, unsigned int N) {
-    float d1 = 0.0f;
-
-    for (unsigned int i = 0; i < N; i++)
-        d1 += sqrtf(fabsf(U[i]));
-
-    return d1;
-}
+#endif
 
 struct timespec diff(struct timespec start, struct timespec end)
 {
@@ -39,131 +35,54 @@ struct timespec diff(struct timespec start, struct timespec end)
     return temp;
 }
 
-float vect_norm(float *U, unsigned int N) {
-    // ptr on the array to perform the sum on
-    __m256 *U_vect = (__m256 *) U;
-
-    // Accumulator to store 8 partial sums
-    __m256 acc = _mm256_set1_ps(0.0f);
+// Context of libsimdnorm shared by every call to normPar: it is only (re)started when the number of threads changes
+// Its reduction engine replaces the mutex we used to take in each thread to add into a single shared float
+static simdnorm_ctx_t *ctx = NULL;
 
-    // Used later to sum horitally over the vector
-    float *acc_fptr = (float *) &acc;
+// Autotuner of the auto mode (see tune.h): the VECT calls take the threads, reduction and kernel of the profile for
+// their N instead of the ones of ctx
+static tune_t *tune = NULL;
 
-    __m256 sign_mask = _mm256_set1_ps(-0.f); // -0.f = 1 << 31
+void normPar_release();
 
-    // We use vector operation to compute the square root and the absolute value
-    // Then we add the vector to the accumulator using vector add
-    // Doing so we gain a x8 in time to compute the sum
-    for (unsigned int i = 0; i < N / 8; i++)
-        acc = _mm256_add_ps(acc, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, U_vect[i])));
+// Start the threads once for nb_threads threads
+void normPar_init(unsigned int nb_threads) {
+    if (ctx != NULL && simdnorm_nb_thread(ctx) == nb_threads)
+        return;
 
-    // We only have to sum the 8 float in the acc vector
-    float result = 0;
-    for (unsigned int i = 0; i < 8; i++)
-        result += acc_fptr[i];
+    if (ctx != NULL)
+        normPar_release();
 
-    return result;
+    ctx = simdnorm_create(nb_threads);
+    if (ctx == NULL) {
+        printf("Could not start %u threads\n", nb_threads);
+        exit(1);
+    }
 }
 
-// Structure to make a mutex variable result
-typedef struct {
-    // Mutex to lock the use of the variable
-    pthread_mutex_t mutex;
-
-    // Will accumulate the sum for each thread
-    float v;
-} result_mutex_t;
-
-// to be passed to each thread
-typedef struct {
-    // begining of the array to consider
-    float *begin;
-    // Where to store the result of each thread
-    result_mutex_t *result;
-    // size of the considered array
-    unsigned int size;
-
-} threadarg_t;
-
-// routine used to encapsulate the call to the norm function in each thread
-void norm_routine(threadarg_t *args) {
-    // We compute the norm using the given norm function
-    float r = vect_norm(args->begin, args->size);
-
-    // Computations are over, we want to add our result to the global result
-    //first we want to lock it
-    pthread_mutex_lock(&args->result->mutex);
-
-    // When locked we can add this partial sum to the global result
-    args->result->v += r;
+// Stop the workers and free our memory
+void normPar_release() {
+    if (ctx == NULL)
+        return;
 
-    // We unlock it when it is finished
-    pthread_mutex_unlock(&args->result->mutex);
-
-    // We terminate the thread
-    pthread_exit(NULL);
+    simdnorm_destroy(ctx);
+    ctx = NULL;
 }
 
+float normPar(float *U, size_t N, unsigned char mode, unsigned int nb_threads) {
 
-float normPar(float *U, unsigned int N, unsigned char mode, unsigned int nb_threads) {
-
-    if (mode == VECT) {
-        // We begin by initializing the argument for each thread
-
-        unsigned int elt_per_thread = (unsigned int) (N / nb_threads);
-
-
-        threadarg_t *args = (threadarg_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(threadarg_t) * (nb_threads-1));
-        pthread_t *pool = (pthread_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(pthread_t) * (nb_threads-1));
-
-
-        // We initialize the mutex variable we want to use to store the result
-        result_mutex_t result;
-        result.v = 0.0f;
-        result.mutex = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
-
-        int errcode = 0;
-
-        for (unsigned int i = 0; i < nb_threads-1; i++) {
-            // We construct the argument for each thread
-            args[i].begin = U+i * elt_per_thread;
-            args[i].size = elt_per_thread;
-            args[i].result = &result;
-
-            // We create the thread
-            errcode += (int) pthread_create(pool+i, NULL, (void *(*)(void *)) norm_routine, args+i);
-        }
-
-        if (errcode != 0) {
-            printf("Something went wront with thread creation");
-            exit(1);
-        }
-
-        // Computations in the main thread
-        float r = vect_norm(U, elt_per_thread);
-        // Computations are over, we want to add our result to the global result
-
-        errcode = 0;
-
-        for (unsigned int i = 0; i < nb_threads-1; i++) {
-            errcode += pthread_join(pool[i], NULL);
-        }
+    if (mode == VECT && tune != NULL)
+        return tune_l1sqrt(tune, U, N);
 
-        // If all thread are terminated we can safely add the last partial sum
-
-        result.v += r;
-
-        // Check if the joins succeded
-        if (errcode != 0) {
-            printf("Something went wront with thread join");
-            exit(1);
-        }
+    if (mode == VECT || mode == VECT_TREE) {
+        // The workers are started once and stay parked between two calls
+        normPar_init(nb_threads);
 
-        // Free our memory
-        //free(pool);
-        free(args);
+        // No lock on the hot path: each slice / block has its own partial sum
+        // and the same input gives the same bit-identical result whatever nb_threads
+        simdnorm_set_reduction(ctx, mode == VECT ? REDUCE_LOCKFREE : REDUCE_TREE);
 
-        return result.v;
+        return simdnorm_l1sqrt(ctx, U, N);
     } else {
         // If scalar: we just call the simple norm
         float result = norm(U, N);
@@ -174,12 +93,36 @@ float normPar(float *U, unsigned int N, unsigned char mode, unsigned int nb_thre
     }
 }
 
+// Number of calls per second of normPar on n elements, we repeat the calls during about duration seconds
+double calls_per_second(float *U, size_t n, unsigned int nb_thread, double duration) {
+    struct timespec begining, end, elapsed;
+    unsigned long calls = 0;
+    double t = 0;
+
+    // First call outside of the measure: it starts the pool
+    normPar(U, n, VECT, nb_thread);
+
+    clock_gettime(CLOCK_MONOTONIC, &begining);
+    while (t < duration) {
+        // We time batches of calls to keep the clock out of the measure
+        for (unsigned int i = 0; i < 64; i++)
+            normPar(U, n, VECT, nb_thread);
+        calls += 64;
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed = diff(begining, end);
+        t = (double) (elapsed.tv_sec * 1000000000l + elapsed.tv_nsec) * 1E-9;
+    }
+
+    return (double) calls / t;
+}
+
 
 int main(int argc, char *argv[]) {
 
     // Check for arguments
     if (argc < 3) {
-        printf("Not enough arguments. 2 are required");
+        printf("Not enough arguments. 2 are required (nb_threads can be auto, a third one, calls, adds the calls/second benchmark)");
         exit(1);
     }
 
@@ -187,10 +130,22 @@ int main(int argc, char *argv[]) {
     srand((unsigned int) time(NULL));
 
     // Get number of elements
-    unsigned int N = (unsigned int) atoi(argv[1]);
+    size_t N = (size_t) strtoull(argv[1], NULL, 10);
 
-    // Get number of threads
+    // Get number of threads, auto: the vectorized calls take the threads, reduction and kernel of the tuning profile
+    // for their N (probed on the first run, see tune.h), nb_thread is then only the one of the first call
     unsigned int nb_thread = (unsigned int) atoi(argv[2]);
+    if (strcmp(argv[2], "auto") == 0) {
+        tune = tune_create(NULL, 0, 0.02);
+        if (tune == NULL) {
+            printf("Could not allocate the tuner\n");
+            exit(1);
+        }
+        tune_choice_t choice = tune_decide(tune, N);
+        nb_thread = choice.nb_thread;
+        printf("Tuned for %zu floats: %u thread(s) (%s, kernel %s)\n", N, nb_thread,
+               tune_reduction_name(choice.reduction), tune_variant_name(choice.variant));
+    }
 
     // We allocate our array
     // We align our array: it has 2 purposes: first it optimizes the cache
@@ -199,7 +154,7 @@ int main(int argc, char *argv[]) {
     float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N);
 
     // Initialization
-    for (unsigned int i = 0; i < N; i++)
+    for (size_t i = 0; i < N; i++)
         U[i] = ((float)rand()/(float)(RAND_MAX));
         //U[i] = 1.0f; // To easily check the correctness of the output
 
@@ -211,28 +166,28 @@ int main(int argc, char *argv[]) {
     // Test of the classical method on a single thread
 
     struct timespec begining_classic;
-    clock_gettime(CLOCK_REALTIME, &begining_classic);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &begining_classic);
 
     normPar(U, N, SCALAR, 1);
 
     struct timespec end_classic;
-    clock_gettime(CLOCK_REALTIME, &end_classic);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_classic);
 
     // Test of the vectoriel method multithreaded
 
     // Initialization
-    for (unsigned int i = 0; i < N; i++)
+    for (size_t i = 0; i < N; i++)
         U[i] = ((float) rand() / (float) (RAND_MAX));
         //U[i] = 1.0f;
 
 
     struct timespec begining_vect_thread;
-    clock_gettime(CLOCK_REALTIME, &begining_vect_thread);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &begining_vect_thread);
 
     result = normPar(U, N, VECT, nb_thread);
 
     struct timespec end_vect_thread;
-    clock_gettime(CLOCK_REALTIME, &end_vect_thread);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_vect_thread);
 
     printf("%e\n", result);
 
@@ -246,11 +201,57 @@ int main(int argc, char *argv[]) {
     double d2 = (double) (vect.tv_sec * 1000000000l + vect.tv_nsec) * 1E-9;
 
 
+    if (tune != NULL)
+        printf("Kernel: %s (tuned)\n", tune_variant_name(tune_decide(tune, N).variant));
+    else
+        printf("Kernel: %s\n", kernel_name(kernel_current()));
     printf("Usual scalar norm, 1 thread: %e\n", d1);
-    printf("Vectorized norm, %d thread: %e\n", nb_thread, d2);
+    if (tune != NULL)
+        printf("Vectorized norm (tuned, %s reduction), %d thread: %e\n",
+               tune_reduction_name(tune_decide(tune, N).reduction), nb_thread, d2);
+    else
+        printf("Vectorized norm (lock-free reduction), %d thread: %e\n", nb_thread, d2);
 
     printf("Speedup x%0.1f\n", d1 / d2);
 
+    // The tree reduction adds the partial sums in another order, thus the result can differ in the last bits
+    // but it is also the same whatever the number of threads
+    struct timespec begining_tree;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &begining_tree);
+
+    result = normPar(U, N, VECT_TREE, nb_thread);
+
+    struct timespec end_tree;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_tree);
+
+    struct timespec tree_time = diff(begining_tree, end_tree);
+    double d3 = (double) (tree_time.tv_sec * 1000000000l + tree_time.tv_nsec) * 1E-9;
+
+    printf("%e\n", result);
+    printf("Vectorized norm (tree reduction), %d thread: %e\n", nb_thread, d3);
+
+    // =============================================================== \\
+    // Repeated calls: the pool is reused, we report the number of calls per second for growing sizes
+    if (argc > 3 && strcmp(argv[3], "calls") == 0) {
+        if (tune != NULL) {
+            // Each size with its own settings
+            printf("N, calls/s, threads, reduction, kernel\n");
+            for (size_t n = 1024 * nb_thread; n <= N; n *= 4) {
+                tune_choice_t choice = tune_decide(tune, n);
+                printf("%zu, %e, %u, %s, %s\n", n, calls_per_second(U, n, nb_thread, 0.2), choice.nb_thread,
+                       tune_reduction_name(choice.reduction), tune_variant_name(choice.variant));
+            }
+        } else {
+            printf("N, calls/s, %d thread\n", nb_thread);
+            for (size_t n = 1024 * nb_thread; n <= N; n *= 4)
+                printf("%zu, %e\n", n, calls_per_second(U, n, nb_thread, 0.2));
+        }
+    }
+
+    normPar_release();
+    if (tune != NULL)
+        tune_destroy(tune);
+
     // free our memory
     free(U);
 
@@ -8,6 +8,8 @@
 #include <math.h>
 #include <time.h>
 
+#include "simdnorm.h"
+
 // On my machine a cache line is 64 bytes long
 #define CACHE_LINE_SIZE 64
 
@@ -28,19 +30,8 @@ struct timespec diff(struct timespec start, struct timespec end)
     return temp;
 }
 
-float norm(float *U, unsigned int N) {
-    // We split the computations in two blocks because we keep adding small numbers to a large float
-    // thus leading to add only 0 each time
-    float d1 = 0.0f;
-    for (unsigned int i = 0; i < N; i++) {
-        d1 += sqrtf(fabsf(U[i]));
-    }
-
-    return d1;
-}
-
-float normPar(float *U, unsigned int N, unsigned int nb_threads) {
-        // Single thread: just call the wanted function on the array
+float normPar(float *U, size_t N) {
+        // Single thread: just call the classical norm of libsimdnorm on the array
         float result = norm(U, N);
 
         // Return the result
@@ -60,7 +51,7 @@ int main(int argc, char *argv[]) {
     srand((unsigned int) time(NULL));
 
     // Get number of elements
-    unsigned int N = (unsigned int) atoi(argv[1]);
+    size_t N = (size_t) strtoull(argv[1], NULL, 10);
 
     // We allocate our array
     // We align our array: it has 2 purposes: first it optimizes the cache
@@ -70,7 +61,7 @@ int main(int argc, char *argv[]) {
     float *U = (float *) malloc(sizeof(float) * N);
 
     // Initialization
-    for (unsigned int i = 0; i < N; i++)
+    for (size_t i = 0; i < N; i++)
         U[i] = ((float) rand() / (float) (RAND_MAX));
 
     // Use to store the result
@@ -79,13 +70,14 @@ int main(int argc, char *argv[]) {
     // =============================================================== \\
     // Test of the classical method on a single thread
 
+    // CLOCK_MONOTONIC_RAW: never adjusted by NTP during the measure, as in the other drivers
     struct timespec begining_classic;
-    clock_gettime(CLOCK_REALTIME, &begining_classic);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &begining_classic);
 
-    result = normPar(U, N, 1);
+    result = normPar(U, N);
 
     struct timespec end_classic;
-    clock_gettime(CLOCK_REALTIME, &end_classic);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_classic);
 
     // printf("%e\n", result);
 
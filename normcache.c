@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "normcache.h"
+
+// Norm of the tile t
+static inline float tile_norm(normcache_t *cache, size_t t) {
+    size_t begin = t * NORMCACHE_TILE;
+    size_t size = (cache->N - begin < NORMCACHE_TILE) ? cache->N - begin : NORMCACHE_TILE;
+
+    return cache->fn(cache->U + begin, size);
+}
+
+// Job descriptor of the parallel computation of a list of tiles (all of them if list is NULL)
+typedef struct {
+    normcache_t *cache;
+    const size_t *list;
+    size_t count;
+} tilejob_t;
+
+static void tile_job(tilejob_t *job, unsigned int worker) {
+    unsigned int nb_thread = job->cache->ctx->pool->nb_thread;
+    size_t first = (job->count * worker) / nb_thread;
+    size_t last = (job->count * (worker + 1)) / nb_thread;
+
+    for (size_t k = first; k < last; k++) {
+        size_t t = job->list != NULL ? job->list[k] : k;
+        job->cache->tree[job->cache->leaves + t] = tile_norm(job->cache, t);
+    }
+}
+
+normcache_t *normcache_create(simdnorm_ctx_t *ctx, float *U, size_t N) {
+    normcache_t *cache = (normcache_t *) malloc(sizeof(normcache_t));
+
+    cache->ctx = ctx;
+    cache->fn = ctx->fn;
+    cache->U = U;
+    cache->N = N;
+    cache->nb_tiles = (N + NORMCACHE_TILE - 1) / NORMCACHE_TILE;
+
+    cache->leaves = 1;
+    while (cache->leaves < cache->nb_tiles)
+        cache->leaves *= 2;
+
+    cache->tree = (float *) calloc(2 * cache->leaves, sizeof(float));
+    cache->dirty = (unsigned char *) calloc(cache->nb_tiles + 1, sizeof(unsigned char));
+    cache->dirty_list = (size_t *) malloc(sizeof(size_t) * (cache->nb_tiles + 1));
+    cache->nb_dirty = 0;
+    cache->queue = (size_t *) malloc(sizeof(size_t) * (cache->nb_tiles + 1));
+    cache->stamp = (unsigned int *) calloc(2 * cache->leaves, sizeof(unsigned int));
+    cache->generation = 0;
+
+    // Every tile, then every node from the bottom up
+    tilejob_t job = {cache, NULL, cache->nb_tiles};
+    pool_run(ctx->pool, (pool_job_t) tile_job, &job);
+
+    for (size_t k = cache->leaves - 1; k >= 1; k--)
+        cache->tree[k] = cache->tree[2 * k] + cache->tree[2 * k + 1];
+
+    return cache;
+}
+
+void normcache_destroy(normcache_t *cache) {
+    free(cache->tree);
+    free(cache->dirty);
+    free(cache->dirty_list);
+    free(cache->queue);
+    free(cache->stamp);
+    free(cache);
+}
+
+void normcache_touch(normcache_t *cache, size_t begin, size_t count) {
+    if (count == 0 || begin >= cache->N)
+        return;
+
+    size_t end = (begin + count < cache->N) ? begin + count : cache->N;
+
+    for (size_t t = begin / NORMCACHE_TILE; t <= (end - 1) / NORMCACHE_TILE; t++) {
+        if (!cache->dirty[t]) {
+            cache->dirty[t] = 1;
+            cache->dirty_list[cache->nb_dirty++] = t;
+        }
+    }
+}
+
+void normcache_set(normcache_t *cache, size_t i, float value) {
+    if (i >= cache->N)
+        return;
+
+    cache->U[i] = value;
+    normcache_touch(cache, i, 1);
+}
+
+void normcache_set_range(normcache_t *cache, size_t begin, const float *values, size_t count) {
+    if (begin >= cache->N)
+        return;
+
+    if (count > cache->N - begin)
+        count = cache->N - begin;
+
+    memcpy(cache->U + begin, values, count * sizeof(float));
+    normcache_touch(cache, begin, count);
+}
+
+// Recompute the dirty tiles, then their ancestors level by level (each node once, after both of its children)
+static void refresh(normcache_t *cache) {
+    if (cache->nb_dirty == 0)
+        return;
+
+    if (cache->nb_dirty >= NORMCACHE_PARALLEL && cache->ctx->pool->nb_thread > 1) {
+        tilejob_t job = {cache, cache->dirty_list, cache->nb_dirty};
+        pool_run(cache->ctx->pool, (pool_job_t) tile_job, &job);
+    } else {
+        for (size_t k = 0; k < cache->nb_dirty; k++)
+            cache->tree[cache->leaves + cache->dirty_list[k]] = tile_norm(cache, cache->dirty_list[k]);
+    }
+
+    // The nodes of the current level which changed
+    size_t count = cache->nb_dirty;
+    for (size_t k = 0; k < count; k++) {
+        cache->queue[k] = cache->leaves + cache->dirty_list[k];
+        cache->dirty[cache->dirty_list[k]] = 0;
+    }
+    cache->nb_dirty = 0;
+
+    while (count > 0 && cache->queue[0] > 1) {
+        cache->generation++;
+
+        // Parents of the current level, each one queued once (the queue shrinks in place)
+        size_t next = 0;
+        for (size_t k = 0; k < count; k++) {
+            size_t parent = cache->queue[k] / 2;
+            if (cache->stamp[parent] != cache->generation) {
+                cache->stamp[parent] = cache->generation;
+                cache->queue[next++] = parent;
+            }
+        }
+
+        for (size_t k = 0; k < next; k++)
+            cache->tree[cache->queue[k]] = cache->tree[2 * cache->queue[k]] + cache->tree[2 * cache->queue[k] + 1];
+
+        count = next;
+    }
+}
+
+float normcache_norm(normcache_t *cache) {
+    refresh(cache);
+
+    return cache->tree[1];
+}
+
+float normcache_norm_range(normcache_t *cache, size_t begin, size_t end) {
+    if (end > cache->N)
+        end = cache->N;
+    if (begin >= end)
+        return 0;
+
+    refresh(cache);
+
+    // Whole tiles inside [begin, end)
+    size_t first = (begin + NORMCACHE_TILE - 1) / NORMCACHE_TILE;
+    size_t last = end / NORMCACHE_TILE;
+
+    // Less than a whole tile: computed directly
+    if (first >= last)
+        return cache->fn(cache->U + begin, end - begin);
+
+    float result = 0;
+
+    // Partial tiles on the edges
+    if (begin < first * NORMCACHE_TILE)
+        result += cache->fn(cache->U + begin, first * NORMCACHE_TILE - begin);
+    if (end > last * NORMCACHE_TILE)
+        result += cache->fn(cache->U + last * NORMCACHE_TILE, end - last * NORMCACHE_TILE);
+
+    // Leaves [first, last) of the tree, bottom-up
+    size_t lo = cache->leaves + first, hi = cache->leaves + last;
+    while (lo < hi) {
+        if (lo & 1)
+            result += cache->tree[lo++];
+        if (hi & 1)
+            result += cache->tree[--hi];
+        lo /= 2;
+        hi /= 2;
+    }
+
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef NORMCACHE_H
+#define NORMCACHE_H
+
+#include <stddef.h>
+
+#include "simdnorm.h"
+
+// Norm of an array which changes slightly between two queries: one partial sum per tile of NORMCACHE_TILE floats,
+// added up by a segment tree. An update only marks its tiles dirty, a query recomputes the dirty tiles and the
+// nodes above them: O(dirty tiles * (NORMCACHE_TILE + log(tiles))) instead of a scan of the whole array
+//
+// The tiles are the blocks of the tree reduction (REDUCE_BLOCK) and the segment tree has the same shape as its
+// pairwise tree, so the norm is bit-identical to simdnorm_l1sqrt with REDUCE_TREE, however many updates were made
+// (a Fenwick tree would add and subtract deltas and drift away from it)
+#define NORMCACHE_TILE REDUCE_BLOCK
+
+// Dirty tiles above which a refresh is shared out between the threads of the context
+#ifndef NORMCACHE_PARALLEL
+#define NORMCACHE_PARALLEL 64
+#endif
+
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    // Kernel of the context when the cache was created (its accuracy mode)
+    kernel_fn_t fn;
+
+    // The array is not copied, the caller keeps it alive
+    float *U;
+    size_t N;
+
+    size_t nb_tiles;
+    // Segment tree in an array: node 1 is the root, the children of k are 2k and 2k+1, the tile t is the leaf
+    // leaves + t (leaves is the power of 2 >= nb_tiles, the missing leaves stay at 0)
+    size_t leaves;
+    float *tree;
+
+    // Tiles changed since the last query, each once in the list
+    unsigned char *dirty;
+    size_t *dirty_list;
+    size_t nb_dirty;
+
+    // Nodes to recompute, per level, and the refresh during which each node was last queued
+    size_t *queue;
+    unsigned int *stamp;
+    unsigned int generation;
+} normcache_t;
+
+// Compute every tile of U on the threads of ctx and build the tree
+normcache_t *normcache_create(simdnorm_ctx_t *ctx, float *U, size_t N);
+
+void normcache_destroy(normcache_t *cache);
+
+// U[i] = value
+void normcache_set(normcache_t *cache, size_t i, float value);
+
+// U[begin + k] = values[k] for k < count
+void normcache_set_range(normcache_t *cache, size_t begin, const float *values, size_t count);
+
+// The caller wrote into U[begin, begin + count) itself
+void normcache_touch(normcache_t *cache, size_t begin, size_t count);
+
+// Norm of the whole array, only the dirty tiles are recomputed
+float normcache_norm(normcache_t *cache);
+
+// Norm of U[begin, end): the whole tiles come from the tree (O(log(tiles)) nodes), the partial ones are computed
+float normcache_norm_range(normcache_t *cache, size_t begin, size_t end);
+
+#endif //NORMCACHE_H
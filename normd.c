@@ -0,0 +1,456 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "async.h"
+#include "normd.h"
+
+// What an epoll event points to
+#define WATCH_LISTEN 0
+#define WATCH_CLIENT 1
+#define WATCH_FUTURE 2
+
+// A connection stays alive as long as it is open or some of its requests are running (they read its mapping)
+typedef struct connection {
+    int kind;
+    int fd;
+    const float *U;
+    size_t map_bytes;
+    unsigned int refs;
+
+    // Live connections of the server, and the ones dropped during the current batch of events
+    struct connection *prev;
+    struct connection *next;
+    struct connection *next_dropped;
+} connection_t;
+
+typedef struct pending {
+    int kind;
+    connection_t *conn;
+    uint32_t id;
+    async_future_t *future;
+
+    // Requests in progress
+    struct pending *prev;
+    struct pending *next;
+} pending_t;
+
+typedef struct {
+    async_t *async;
+    int epoll;
+    connection_t *connections;
+    pending_t *pendings;
+    connection_t *dropped;
+} server_t;
+
+static void conn_unref(server_t *server, connection_t *conn) {
+    if (--conn->refs > 0)
+        return;
+
+    if (conn->prev != NULL)
+        conn->prev->next = conn->next;
+    else
+        server->connections = conn->next;
+    if (conn->next != NULL)
+        conn->next->prev = conn->prev;
+
+    if (conn->U != NULL)
+        munmap((void *) conn->U, conn->map_bytes);
+    free(conn);
+}
+
+// Close the socket of a client. Its reference is only given back once the current batch of events is handled:
+// a later event of the same batch can still point to the connection
+static void drop(server_t *server, connection_t *conn) {
+    if (conn->fd < 0)
+        return;
+
+    epoll_ctl(server->epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->fd = -1;
+
+    conn->next_dropped = server->dropped;
+    server->dropped = conn;
+}
+
+static void reply(server_t *server, connection_t *conn, uint32_t id, int32_t status, float result) {
+    // The client is gone: nobody to answer
+    if (conn->fd < 0)
+        return;
+
+    // Never blocks: a client which does not read its replies anymore would stall every other one
+    normd_reply_t r = {id, status, result};
+    ssize_t sent;
+    do {
+        sent = send(conn->fd, &r, sizeof(r), MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (sent < 0 && errno == EINTR);
+
+    if (sent != (ssize_t) sizeof(r))
+        drop(server, conn);
+}
+
+// A request with its fds if any (SCM_RIGHTS), -1 when the client is gone
+static ssize_t receive_request(int fd, normd_request_t *request, int *passed) {
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = {request, sizeof(normd_request_t)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    *passed = -1;
+    ssize_t r = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (r <= 0)
+        return -1;
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c))
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS)
+            memcpy(passed, CMSG_DATA(c), sizeof(int));
+
+    return r;
+}
+
+static void pending_remove(server_t *server, pending_t *pending) {
+    if (pending->prev != NULL)
+        pending->prev->next = pending->next;
+    else
+        server->pendings = pending->next;
+    if (pending->next != NULL)
+        pending->next->prev = pending->prev;
+}
+
+// One message of a client
+static void handle(server_t *server, connection_t *conn) {
+    normd_request_t request;
+    int passed;
+
+    // Dropped earlier in this batch
+    if (conn->fd < 0)
+        return;
+
+    if (receive_request(conn->fd, &request, &passed) != (ssize_t) sizeof(normd_request_t)) {
+        if (passed >= 0)
+            close(passed);
+
+        // Gone (or garbage): the connection lives on until its requests are done
+        drop(server, conn);
+        return;
+    }
+
+    if (request.type == NORMD_MAP) {
+        struct stat st;
+        int32_t status = NORMD_OK;
+
+        // The client could shrink the memfd under our mapping (SIGBUS on the next read): it has to be sealed
+        int seals = passed >= 0 ? fcntl(passed, F_GET_SEALS) : -1;
+
+        if (conn->U != NULL)
+            status = NORMD_MAPPED;
+        else if (seals < 0 || (seals & F_SEAL_SHRINK) == 0 || fstat(passed, &st) != 0 ||
+                 (uint64_t) st.st_size < request.count || request.count == 0)
+            status = NORMD_BAD_REQUEST;
+        else {
+            void *p = mmap(NULL, request.count, PROT_READ, MAP_SHARED, passed, 0);
+            if (p == MAP_FAILED) {
+                status = NORMD_BAD_REQUEST;
+            } else {
+                conn->U = (const float *) p;
+                conn->map_bytes = request.count;
+            }
+        }
+
+        // The mapping keeps the pages, the fd is not needed anymore
+        if (passed >= 0)
+            close(passed);
+
+        reply(server, conn, request.id, status, 0);
+        return;
+    }
+
+    if (passed >= 0)
+        close(passed);
+
+    if (request.type != NORMD_NORM) {
+        reply(server, conn, request.id, NORMD_BAD_REQUEST, NAN);
+        return;
+    }
+    if (conn->U == NULL) {
+        reply(server, conn, request.id, NORMD_NOT_MAPPED, NAN);
+        return;
+    }
+
+    size_t floats = conn->map_bytes / sizeof(float);
+    if (request.offset > floats || request.count > floats - request.offset) {
+        reply(server, conn, request.id, NORMD_BAD_REQUEST, NAN);
+        return;
+    }
+
+    // The reply is sent when the eventfd of the future fires
+    pending_t *pending = (pending_t *) malloc(sizeof(pending_t));
+    if (pending == NULL) {
+        reply(server, conn, request.id, NORMD_NO_MEMORY, NAN);
+        return;
+    }
+    pending->kind = WATCH_FUTURE;
+    pending->conn = conn;
+    pending->id = request.id;
+    pending->future = async_submit(server->async, conn->U + request.offset, request.count);
+    conn->refs++;
+
+    pending->prev = NULL;
+    pending->next = server->pendings;
+    if (server->pendings != NULL)
+        server->pendings->prev = pending;
+    server->pendings = pending;
+
+    struct epoll_event ev = {EPOLLIN, {.ptr = pending}};
+    int fd = async_eventfd(pending->future);
+    if (fd < 0 || epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        // No eventfd: wait for it here
+        async_wait(pending->future, -1);
+        reply(server, conn, pending->id, NORMD_OK, async_result(pending->future));
+        async_release(pending->future);
+        pending_remove(server, pending);
+        conn_unref(server, conn);
+        free(pending);
+    }
+}
+
+static void finish(server_t *server, pending_t *pending) {
+    int fd = async_eventfd(pending->future);
+    epoll_ctl(server->epoll, EPOLL_CTL_DEL, fd, NULL);
+
+    reply(server, pending->conn, pending->id, NORMD_OK, async_result(pending->future));
+
+    async_release(pending->future);
+    pending_remove(server, pending);
+    conn_unref(server, pending->conn);
+    free(pending);
+}
+
+static void accept_client(server_t *server, int listener) {
+    int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    connection_t *conn = (connection_t *) calloc(1, sizeof(connection_t));
+    if (conn == NULL) {
+        close(fd);
+        return;
+    }
+    conn->kind = WATCH_CLIENT;
+    conn->fd = fd;
+    conn->refs = 1;
+
+    struct epoll_event ev = {EPOLLIN, {.ptr = conn}};
+    if (epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        free(conn);
+        return;
+    }
+
+    conn->next = server->connections;
+    if (server->connections != NULL)
+        server->connections->prev = conn;
+    server->connections = conn;
+}
+
+int normd_serve(const char *path, unsigned int nb_thread, int pin, volatile sig_atomic_t *stop) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    strcpy(addr.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    unlink(path);
+    if (listener < 0 || bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        if (listener >= 0)
+            close(listener);
+        return -1;
+    }
+
+    server_t server = {async_create(nb_thread, pin), epoll_create1(EPOLL_CLOEXEC), NULL, NULL, NULL};
+    if (server.async == NULL || server.epoll < 0) {
+        if (server.async != NULL)
+            async_destroy(server.async);
+        if (server.epoll >= 0)
+            close(server.epoll);
+        close(listener);
+        unlink(path);
+        return -1;
+    }
+
+    int listen_kind = WATCH_LISTEN;
+    struct epoll_event ev = {EPOLLIN, {.ptr = &listen_kind}};
+    epoll_ctl(server.epoll, EPOLL_CTL_ADD, listener, &ev);
+
+    // A short timeout to look at *stop
+    while (!*stop) {
+        struct epoll_event events[64];
+        int nb = epoll_wait(server.epoll, events, 64, 100);
+
+        for (int e = 0; e < nb; e++) {
+            int kind = *(int *) events[e].data.ptr;
+
+            if (kind == WATCH_LISTEN)
+                accept_client(&server, listener);
+            else if (kind == WATCH_CLIENT)
+                handle(&server, (connection_t *) events[e].data.ptr);
+            else
+                finish(&server, (pending_t *) events[e].data.ptr);
+        }
+
+        // No event of this batch points to the dropped connections anymore
+        while (server.dropped != NULL) {
+            connection_t *conn = server.dropped;
+            server.dropped = conn->next_dropped;
+            conn_unref(&server, conn);
+        }
+    }
+
+    // The requests in progress are finished by async_destroy, their replies are not sent anymore
+    async_destroy(server.async);
+
+    while (server.pendings != NULL) {
+        pending_t *pending = server.pendings;
+        async_release(pending->future);
+        pending_remove(&server, pending);
+        conn_unref(&server, pending->conn);
+        free(pending);
+    }
+
+    // Only the reference of the open socket is left on each connection
+    while (server.connections != NULL) {
+        connection_t *conn = server.connections;
+        if (conn->fd >= 0)
+            close(conn->fd);
+        conn_unref(&server, conn);
+    }
+
+    close(server.epoll);
+    close(listener);
+    unlink(path);
+
+    return 0;
+}
+
+// =============================================================== \\
+// Client side
+
+normd_client_t *normd_connect(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return NULL;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    normd_client_t *client = (normd_client_t *) calloc(1, sizeof(normd_client_t));
+    client->fd = fd;
+
+    return client;
+}
+
+float *normd_map(normd_client_t *client, size_t N) {
+    size_t bytes = (N > 0 ? N : 1) * sizeof(float);
+
+    int mfd = memfd_create("simdnorm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (mfd < 0)
+        return NULL;
+
+    // Sealed against shrinking: the daemon refuses a memfd it could lose pages of
+    void *p = MAP_FAILED;
+    if (ftruncate(mfd, (off_t) bytes) == 0 && fcntl(mfd, F_ADD_SEALS, F_SEAL_SHRINK) == 0)
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0);
+    if (p == MAP_FAILED) {
+        close(mfd);
+        return NULL;
+    }
+
+    // The fd goes with the message
+    normd_request_t request = {NORMD_MAP, 0, 0, bytes};
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov = {&request, sizeof(request)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &mfd, sizeof(int));
+
+    normd_reply_t r;
+    int ok = sendmsg(client->fd, &msg, MSG_NOSIGNAL) == (ssize_t) sizeof(request) &&
+             normd_receive(client, &r) == 0 && r.status == NORMD_OK;
+    close(mfd);
+
+    if (!ok) {
+        munmap(p, bytes);
+        return NULL;
+    }
+
+    client->U = (float *) p;
+    client->N = N;
+
+    return client->U;
+}
+
+int normd_send(normd_client_t *client, uint32_t id, size_t offset, size_t count) {
+    normd_request_t request = {NORMD_NORM, id, offset, count};
+
+    return send(client->fd, &request, sizeof(request), MSG_NOSIGNAL) == (ssize_t) sizeof(request) ? 0 : -1;
+}
+
+int normd_receive(normd_client_t *client, normd_reply_t *reply) {
+    ssize_t r;
+    do {
+        r = recv(client->fd, reply, sizeof(normd_reply_t), 0);
+    } while (r < 0 && errno == EINTR);
+
+    return r == (ssize_t) sizeof(normd_reply_t) ? 0 : -1;
+}
+
+float normd_norm(normd_client_t *client, size_t offset, size_t count) {
+    normd_reply_t r;
+
+    if (normd_send(client, 0, offset, count) != 0 || normd_receive(client, &r) != 0 || r.status != NORMD_OK)
+        return NAN;
+
+    return r.result;
+}
+
+void normd_close(normd_client_t *client) {
+    if (client->U != NULL)
+        munmap(client->U, (client->N > 0 ? client->N : 1) * sizeof(float));
+    close(client->fd);
+    free(client);
+}
@@ -0,0 +1,70 @@
+#ifndef NORMD_H
+#define NORMD_H
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Norm daemon: a single pinned pool shared by every process of the machine instead of one pool per process
+// (which oversubscribes the cores as soon as several of them run at once)
+//
+// The clients talk to it over a Unix domain socket (SOCK_SEQPACKET: one message per request, the boundaries are
+// kept). The arrays are not copied: a client creates a memfd, maps it, and sends the fd once (SCM_RIGHTS), the
+// daemon maps the same pages. The memfd must be sealed with F_SEAL_SHRINK, else a client could truncate it and
+// kill the daemon (SIGBUS) for everyone. Then each request is only (offset, count) in that memory. Requests are
+// served by an async_t (async.h): the small ones of every client are batched together
+
+// Messages
+#define NORMD_MAP 1    // the memfd is attached (SCM_RIGHTS), count is its size in bytes
+#define NORMD_NORM 2   // l1sqrt of count floats from offset (in floats) in the mapped memory
+
+// Status of a reply
+#define NORMD_OK 0
+#define NORMD_BAD_REQUEST (-1)   // unknown type, range outside of the mapping, missing fd or not sealed
+#define NORMD_NOT_MAPPED (-2)    // NORMD_NORM before NORMD_MAP
+#define NORMD_MAPPED (-3)        // a second NORMD_MAP on the same connection
+#define NORMD_NO_MEMORY (-4)     // the daemon could not keep track of the request
+
+typedef struct {
+    uint32_t type;
+    // Echoed in the reply, requests can be pipelined and the replies come in the order of completion
+    uint32_t id;
+    uint64_t offset;
+    uint64_t count;
+} normd_request_t;
+
+typedef struct {
+    uint32_t id;
+    int32_t status;
+    float result;
+} normd_reply_t;
+
+// Serve on the socket path with a pool of nb_thread threads (pinned if pin is set) until *stop is set
+// (by a signal handler), then finish the requests in progress and free everything. A client which does not read
+// its replies is dropped rather than waited for. Returns 0, -1 if the socket or the pool could not be started
+int normd_serve(const char *path, unsigned int nb_thread, int pin, volatile sig_atomic_t *stop);
+
+// Client side, one connection and one shared array each
+
+typedef struct {
+    int fd;
+    float *U;
+    size_t N;
+} normd_client_t;
+
+// NULL if the daemon does not answer
+normd_client_t *normd_connect(const char *path);
+
+// Shared array of N floats (memfd), given to the daemon. NULL on failure
+float *normd_map(normd_client_t *client, size_t N);
+
+// Pipelined requests: send some, then receive the replies (in the order of completion). Return 0, -1 on error
+int normd_send(normd_client_t *client, uint32_t id, size_t offset, size_t count);
+int normd_receive(normd_client_t *client, normd_reply_t *reply);
+
+// One request, waiting for its reply. NAN on error
+float normd_norm(normd_client_t *client, size_t offset, size_t count);
+
+void normd_close(normd_client_t *client);
+
+#endif //NORMD_H
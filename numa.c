@@ -0,0 +1,203 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "numa.h"
+
+// From linux/mempolicy.h, we do not want to depend on the headers of libnuma
+#define NUMA_MPOL_PREFERRED 1
+#define NUMA_MPOL_F_NODE (1 << 0)
+#define NUMA_MPOL_F_ADDR (1 << 1)
+
+// Max number of nodes we handle (size of the node masks)
+#define NUMA_MAX_NODES 64
+
+// Parse a sysfs list such as "0-3,8-11" into a cpu set (or the nodes into a mask), returns the number of entries
+static int parse_list(const char *path, cpu_set_t *set) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return 0;
+
+    char line[4096];
+    int count = 0;
+
+    CPU_ZERO(set);
+
+    if (fgets(line, sizeof(line), f) != NULL) {
+        char *save = NULL;
+        for (char *tok = strtok_r(line, ",\n", &save); tok != NULL; tok = strtok_r(NULL, ",\n", &save)) {
+            int a, b;
+            int n = sscanf(tok, "%d-%d", &a, &b);
+            if (n < 1)
+                continue;
+            if (n == 1)
+                b = a;
+            for (int i = a; i <= b && i < CPU_SETSIZE; i++) {
+                CPU_SET(i, set);
+                count++;
+            }
+        }
+    }
+
+    fclose(f);
+
+    return count;
+}
+
+// Node/CPU map, read from sysfs once for the whole process (pin_job asks for it from every worker)
+static struct {
+    int nb_nodes;
+    int ids[NUMA_MAX_NODES];        // Id of the k-th node with memory
+    cpu_set_t cpus[NUMA_MAX_NODES]; // CPUs of the k-th node
+    int nb_cpus[NUMA_MAX_NODES];    // 0 if the node has no cpulist
+} numa_map;
+
+static pthread_once_t numa_map_once = PTHREAD_ONCE_INIT;
+
+static void numa_map_load() {
+    cpu_set_t nodes;
+
+    if (parse_list("/sys/devices/system/node/has_memory", &nodes) <= 0 &&
+        parse_list("/sys/devices/system/node/online", &nodes) <= 0) {
+        // No node information: a single node 0
+        CPU_ZERO(&nodes);
+        CPU_SET(0, &nodes);
+    }
+
+    numa_map.nb_nodes = 0;
+    for (int i = 0; i < NUMA_MAX_NODES; i++) {
+        if (!CPU_ISSET(i, &nodes))
+            continue;
+
+        int k = numa_map.nb_nodes++;
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", i);
+
+        numa_map.ids[k] = i;
+        numa_map.nb_cpus[k] = parse_list(path, &numa_map.cpus[k]);
+    }
+
+    // Only nodes past NUMA_MAX_NODES: handled as a single node without CPU list
+    if (numa_map.nb_nodes == 0) {
+        numa_map.nb_nodes = 1;
+        numa_map.ids[0] = 0;
+        numa_map.nb_cpus[0] = 0;
+    }
+}
+
+int numa_nb_nodes() {
+    pthread_once(&numa_map_once, numa_map_load);
+
+    return numa_map.nb_nodes;
+}
+
+int numa_node_of_worker(unsigned int worker, unsigned int nb_thread) {
+    unsigned int nb_nodes = (unsigned int) numa_nb_nodes();
+
+    return (int) (((unsigned long) worker * nb_nodes) / nb_thread);
+}
+
+// Id of the k-th node with memory (nodes ids can have holes)
+int numa_node_id(int k) {
+    if (k < 0 || k >= numa_nb_nodes())
+        return 0;
+
+    return numa_map.ids[k];
+}
+
+// Job pinning each worker on the CPU of its node matching its rank inside the node
+static void pin_job(threadpool_t *pool, unsigned int worker) {
+    int node = numa_node_of_worker(worker, pool->nb_thread);
+
+    // Rank of the worker inside its node
+    unsigned int rank = 0;
+    for (unsigned int w = 0; w < worker; w++)
+        if (numa_node_of_worker(w, pool->nb_thread) == node)
+            rank++;
+
+    cpu_set_t cpus = numa_map.cpus[node];
+    int nb_cpus = numa_map.nb_cpus[node];
+
+    // No node information: every CPU the process can run on
+    if (nb_cpus <= 0) {
+        sched_getaffinity(0, sizeof(cpu_set_t), &cpus);
+        nb_cpus = CPU_COUNT(&cpus);
+    }
+
+    if (nb_cpus <= 0)
+        return;
+
+    // The (rank % nb_cpus)-th CPU of the set
+    unsigned int target = rank % (unsigned int) nb_cpus;
+    cpu_set_t one;
+    CPU_ZERO(&one);
+
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &cpus) && target-- == 0) {
+            CPU_SET(i, &one);
+            break;
+        }
+    }
+
+    // Errors are checked by numa_pin_pool through the affinity we end up with
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &one);
+}
+
+// Each worker checks it ended up on a single CPU
+static void check_job(int *errors, unsigned int worker) {
+    (void) worker;
+    cpu_set_t cpus;
+
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus) != 0 || CPU_COUNT(&cpus) != 1)
+        __atomic_fetch_add(errors, 1, __ATOMIC_RELAXED);
+}
+
+int numa_pin_pool(threadpool_t *pool) {
+    int errors = 0;
+
+    pool_run(pool, (pool_job_t) pin_job, pool);
+    pool_run(pool, (pool_job_t) check_job, &errors);
+
+    return errors == 0 ? 0 : -1;
+}
+
+void numa_bind(void *begin, size_t size, int node) {
+    // Nothing to place on a single node machine
+    if (numa_nb_nodes() <= 1)
+        return;
+
+    // Only the pages fully inside the range, the ones on the edges are shared with the neighbour slices
+    uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t first = ((uintptr_t) begin + page - 1) & ~(page - 1);
+    uintptr_t last = ((uintptr_t) begin + size) & ~(page - 1);
+
+    if (last <= first)
+        return;
+
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+    int id = numa_node_id(node);
+    if (id >= NUMA_MAX_NODES)
+        return;
+    mask[id / (8 * sizeof(unsigned long))] |= 1ul << (id % (8 * sizeof(unsigned long)));
+
+    // Preferred rather than bind: if the node is full the pages go elsewhere instead of failing
+    // An error only means the pages are placed by the default policy, as without NUMA mode
+    syscall(SYS_mbind, (void *) first, (unsigned long) (last - first), NUMA_MPOL_PREFERRED, mask,
+            (unsigned long) NUMA_MAX_NODES + 1, 0);
+}
+
+int numa_node_of(void *addr) {
+    int node = -1;
+
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0, addr, NUMA_MPOL_F_NODE | NUMA_MPOL_F_ADDR) != 0)
+        return -1;
+
+    return node;
+}
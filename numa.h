@@ -0,0 +1,31 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+#include "threadpool.h"
+
+// NUMA helpers built on raw syscalls (mbind / get_mempolicy), no libnuma needed
+// On a single node machine (or if the kernel does not support it) they do nothing and report a single node 0
+
+// Number of nodes with memory, 1 if unknown
+int numa_nb_nodes();
+
+// Node given to a worker: the workers are shared out in contiguous groups, as the slices of normPar
+int numa_node_of_worker(unsigned int worker, unsigned int nb_thread);
+
+// Id of the k-th node with memory (the ids can have holes), as used by the kernel
+int numa_node_id(int k);
+
+// Pin each worker of the pool (the calling thread included, as worker 0) on a CPU of its node
+// Returns 0 on success, -1 if the affinity could not be set
+int numa_pin_pool(threadpool_t *pool);
+
+// Ask the kernel to place the pages fully inside [begin, begin + size) on node (preferred policy)
+// It has to be done before the pages are touched for the first time
+void numa_bind(void *begin, size_t size, int node);
+
+// Node of the page containing addr (it has to be touched), -1 if unknown
+int numa_node_of(void *addr);
+
+#endif //NUMA_H
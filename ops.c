@@ -0,0 +1,205 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "kernels.h"
+#include "ops.h"
+
+// Each operation is written once as a STEP macro (how an accumulator takes a new value) and the loops around it
+// (peeling, unrolling, tail, horizontal reduction) are generated by the macros below
+// so every kernel is a plain loop without any call in it, as fast as the hand-written vect_norm
+
+// =============================================================== \\
+// Scalar versions
+
+#define SCALAR_REDUCTION(name, STEP, BINARY)                                    \
+__attribute__((optimize("no-tree-vectorize")))                                  \
+static float name(const float *U, const float *V, size_t N, float p) {         \
+    float acc = 0.0f;                                                           \
+    (void) p;                                                                   \
+                                                                                \
+    for (size_t i = 0; i < N; i++) {                                            \
+        float x = U[i];                                                         \
+        float y = BINARY ? V[i] : 0.0f;                                         \
+        (void) y;                                                               \
+        acc = STEP(acc, x, y);                                                  \
+    }                                                                           \
+                                                                                \
+    return acc;                                                                 \
+}
+
+#define S_L1SQRT(acc, x, y) ((acc) + sqrtf(fabsf(x)))
+#define S_L1(acc, x, y) ((acc) + fabsf(x))
+#define S_L2SQ(acc, x, y) ((acc) + (x) * (x))
+#define S_LINF(acc, x, y) fmaxf((acc), fabsf(x))
+#define S_LP(acc, x, y) ((acc) + powf(fabsf(x), p))
+#define S_DOT(acc, x, y) ((acc) + (x) * (y))
+
+SCALAR_REDUCTION(l1sqrt_scalar, S_L1SQRT, 0)
+SCALAR_REDUCTION(l1_scalar, S_L1, 0)
+SCALAR_REDUCTION(l2sq_scalar, S_L2SQ, 0)
+SCALAR_REDUCTION(linf_scalar, S_LINF, 0)
+SCALAR_REDUCTION(lp_scalar, S_LP, 0)
+SCALAR_REDUCTION(dot_scalar, S_DOT, 1)
+
+// =============================================================== \\
+// AVX2 + FMA versions: 8 floats per vector, 4 accumulators, masked loads for the head and the tail
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+// Mask selecting the n first lanes of a vector (n <= 8)
+static inline __m256i first_lanes(unsigned int n) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32((int) n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+// x^e by squaring, e is the same for the whole array so the branches are always predicted
+static inline __m256 pow_int(__m256 x, unsigned int e) {
+    __m256 r = _mm256_set1_ps(1.0f);
+
+    while (e != 0) {
+        if (e & 1)
+            r = _mm256_mul_ps(r, x);
+        x = _mm256_mul_ps(x, x);
+        e >>= 1;
+    }
+
+    return r;
+}
+
+// STEP(acc, x, y) gives the new accumulator, MERGE(a, b) adds up two accumulators (vectors)
+// and SMERGE(a, b) two of their lanes
+// sign_mask (abs value) and e (integer exponent) can be used by STEP
+#define AVX2_REDUCTION(name, STEP, MERGE, SMERGE, BINARY)                                   \
+static float name(const float *U, const float *V, size_t N, float p) {                     \
+    __m256 acc0 = _mm256_setzero_ps();                                                      \
+    __m256 acc1 = _mm256_setzero_ps();                                                      \
+    __m256 acc2 = _mm256_setzero_ps();                                                      \
+    __m256 acc3 = _mm256_setzero_ps();                                                      \
+    __m256 zero = _mm256_setzero_ps();                                                      \
+    __m256 sign_mask = _mm256_set1_ps(-0.f);                                                \
+    /* Only read by V_LP, which lp_avx2 calls with an integer p in [1, 2^32) */             \
+    unsigned int e = (p >= 1 && p < 4294967296.0f) ? (unsigned int) p : 0;                  \
+    (void) sign_mask; (void) e; (void) zero;                                                \
+                                                                                            \
+    size_t i = 0;                                                                           \
+                                                                                            \
+    /* Peeling up to the first 32 bytes boundary of U, V keeps unaligned loads */          \
+    if (((uintptr_t) U & (sizeof(float) - 1)) == 0) {                                       \
+        unsigned int head = (unsigned int) (((32 - ((uintptr_t) U & 31)) & 31) / sizeof(float)); \
+        if (head > N)                                                                       \
+            head = (unsigned int) N;                                                        \
+                                                                                            \
+        if (head > 0) {                                                                     \
+            __m256i mask = first_lanes(head);                                               \
+            __m256 x = _mm256_maskload_ps(U, mask);                                         \
+            __m256 y = BINARY ? _mm256_maskload_ps(V, mask) : zero;                         \
+            (void) y;                                                                       \
+            acc0 = STEP(acc0, x, y);                                                        \
+            i = head;                                                                       \
+        }                                                                                   \
+    }                                                                                       \
+                                                                                            \
+    for (; i + 32 <= N; i += 32) {                                                          \
+        _mm_prefetch((const char *) (U + i + PREFETCH_DISTANCE), _MM_HINT_T0);              \
+        acc0 = STEP(acc0, _mm256_loadu_ps(U + i), BINARY ? _mm256_loadu_ps(V + i) : zero);  \
+        acc1 = STEP(acc1, _mm256_loadu_ps(U + i + 8), BINARY ? _mm256_loadu_ps(V + i + 8) : zero);   \
+        acc2 = STEP(acc2, _mm256_loadu_ps(U + i + 16), BINARY ? _mm256_loadu_ps(V + i + 16) : zero); \
+        acc3 = STEP(acc3, _mm256_loadu_ps(U + i + 24), BINARY ? _mm256_loadu_ps(V + i + 24) : zero); \
+    }                                                                                       \
+                                                                                            \
+    for (; i + 8 <= N; i += 8)                                                              \
+        acc0 = STEP(acc0, _mm256_loadu_ps(U + i), BINARY ? _mm256_loadu_ps(V + i) : zero);  \
+                                                                                            \
+    /* Tail: less than 8 floats left */                                                     \
+    if (i < N) {                                                                            \
+        __m256i mask = first_lanes((unsigned int) (N - i));                                 \
+        __m256 x = _mm256_maskload_ps(U + i, mask);                                         \
+        __m256 y = BINARY ? _mm256_maskload_ps(V + i, mask) : zero;                         \
+        (void) y;                                                                           \
+        acc0 = STEP(acc0, x, y);                                                            \
+    }                                                                                       \
+                                                                                            \
+    acc0 = MERGE(MERGE(acc0, acc1), MERGE(acc2, acc3));                                     \
+                                                                                            \
+    float *acc_fptr = (float *) &acc0;                                                      \
+    float result = acc_fptr[0];                                                             \
+    for (unsigned int k = 1; k < 8; k++)                                                    \
+        result = SMERGE(result, acc_fptr[k]);                                               \
+                                                                                            \
+    return result;                                                                          \
+}
+
+#define V_ABS(x) _mm256_andnot_ps(sign_mask, (x))
+
+#define V_L1SQRT(acc, x, y) _mm256_add_ps((acc), _mm256_sqrt_ps(V_ABS(x)))
+#define V_L1(acc, x, y) _mm256_add_ps((acc), V_ABS(x))
+#define V_L2SQ(acc, x, y) _mm256_fmadd_ps((x), (x), (acc))
+#define V_LINF(acc, x, y) _mm256_max_ps((acc), V_ABS(x))
+#define V_LP(acc, x, y) _mm256_add_ps((acc), pow_int(V_ABS(x), e))
+#define V_DOT(acc, x, y) _mm256_fmadd_ps((x), (y), (acc))
+
+#define SUM(a, b) ((a) + (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+AVX2_REDUCTION(l1sqrt_avx2, V_L1SQRT, _mm256_add_ps, SUM, 0)
+AVX2_REDUCTION(l1_avx2, V_L1, _mm256_add_ps, SUM, 0)
+AVX2_REDUCTION(l2sq_avx2, V_L2SQ, _mm256_add_ps, SUM, 0)
+AVX2_REDUCTION(linf_avx2, V_LINF, _mm256_max_ps, MAX, 0)
+AVX2_REDUCTION(lp_int_avx2, V_LP, _mm256_add_ps, SUM, 0)
+AVX2_REDUCTION(dot_avx2, V_DOT, _mm256_add_ps, SUM, 1)
+
+#pragma GCC pop_options
+
+// Only integer exponents have a vectorized |x|^p, p is range-checked before the cast (out of range: undefined)
+static float lp_avx2(const float *U, const float *V, size_t N, float p) {
+    if (p >= 1 && p < 4294967296.0f && p == (float) (unsigned int) p)
+        return lp_int_avx2(U, V, N, p);
+
+    return lp_scalar(U, V, N, p);
+}
+
+// =============================================================== \\
+// Dispatch
+
+static reduce_op_kernel_t scalar_ops[OP_COUNT] = {l1sqrt_scalar, l1_scalar, l2sq_scalar, linf_scalar, lp_scalar,
+                                                  dot_scalar};
+static reduce_op_kernel_t avx2_ops[OP_COUNT] = {l1sqrt_avx2, l1_avx2, l2sq_avx2, linf_avx2, lp_avx2, dot_avx2};
+static const char *names[OP_COUNT] = {"l1sqrt", "l1", "l2sq", "linf", "lp", "dot"};
+
+reduce_op_kernel_t op_kernel(int op, int vect) {
+    if (op < 0 || op >= OP_COUNT)
+        return NULL;
+
+    __builtin_cpu_init();
+
+    if (vect && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return avx2_ops[op];
+
+    return scalar_ops[op];
+}
+
+int op_combine(int op) {
+    return op == OP_LINF ? COMBINE_MAX : COMBINE_SUM;
+}
+
+int op_binary(int op) {
+    return op == OP_DOT;
+}
+
+const char *op_name(int op) {
+    if (op < 0 || op >= OP_COUNT)
+        return "unknown";
+
+    return names[op];
+}
+
+int op_from_name(const char *name) {
+    for (int op = 0; op < OP_COUNT; op++)
+        if (strcmp(name, names[op]) == 0)
+            return op;
+
+    return -1;
+}
@@ -0,0 +1,36 @@
+#ifndef OPS_H
+#define OPS_H
+
+#include <stddef.h>
+
+#include "reduce.h"
+
+// Generic reductions: an element transform and a combiner, specialized at compile time (see ops.c)
+// They all run on the same threading / slicing layer (reduce.c) as the l1sqrt norm
+#define OP_L1SQRT 0   // sum of sqrt(|x|), same as vect_norm
+#define OP_L1 1       // sum of |x|
+#define OP_L2SQ 2     // sum of x*x (FMA), squared L2 norm
+#define OP_LINF 3     // max of |x|
+#define OP_LP 4       // sum of |x|^p, p > 0
+#define OP_DOT 5      // sum of x*y, needs a second array
+#define OP_COUNT 6
+
+// Kernel of an operation for the reduction engine: the AVX2 + FMA one if vect is set and the CPU supports it,
+// the scalar one otherwise. U and V can have any alignment and N any value
+// The masked lanes of the head and the tail are loaded as 0, which is neutral for every operation above
+// (hence p > 0 for OP_LP, and the max starts at 0 since it is a max of absolute values)
+// OP_LP is vectorized for integer values of p only, the other ones use powf
+reduce_op_kernel_t op_kernel(int op, int vect);
+
+// COMBINE_SUM or COMBINE_MAX
+int op_combine(int op);
+
+// 1 if the operation reads a second array
+int op_binary(int op);
+
+const char *op_name(int op);
+
+// -1 if the name is unknown
+int op_from_name(const char *name);
+
+#endif //OPS_H
@@ -0,0 +1,270 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "perf.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+static const char *phase_names[PERF_PHASES] = {"spawn", "compute", "reduce", "join"};
+static const char *counter_names[PERF_COUNTERS] = {"cycles", "instructions", "L1d misses", "LLC misses",
+                                                   "stalled cycles", "dTLB misses"};
+
+// One entry per worker, on its own cache lines since each worker only writes its own
+typedef struct {
+    perf_phase_t phases[PERF_PHASES];
+} __attribute__((aligned(CACHE_LINE_SIZE))) perf_worker_t;
+
+struct perf_totals {
+    unsigned int nb_worker;
+    perf_worker_t *workers;
+};
+
+// Counters which could be opened (by any thread, hence the atomics)
+static int available[PERF_COUNTERS];
+
+const char *perf_phase_name(int phase) {
+    return (phase >= 0 && phase < PERF_PHASES) ? phase_names[phase] : "unknown";
+}
+
+const char *perf_counter_name(int counter) {
+    return (counter >= 0 && counter < PERF_COUNTERS) ? counter_names[counter] : "unknown";
+}
+
+void perf_reset(perf_totals_t *totals) {
+    if (totals != NULL)
+        memset(totals->workers, 0, sizeof(perf_worker_t) * totals->nb_worker);
+}
+
+const perf_phase_t *perf_phase(const perf_totals_t *totals, unsigned int worker, int phase) {
+    if (totals == NULL || worker >= totals->nb_worker || phase < 0 || phase >= PERF_PHASES)
+        return NULL;
+
+    return &totals->workers[worker].phases[phase];
+}
+
+int perf_counter_available(int counter) {
+    return (counter >= 0 && counter < PERF_COUNTERS) ? __atomic_load_n(&available[counter], __ATOMIC_RELAXED) : 0;
+}
+
+#ifdef SIMDNORM_PERF
+
+int perf_compiled() {
+    return 1;
+}
+
+perf_totals_t *perf_totals_create(unsigned int nb_worker) {
+    perf_totals_t *totals = (perf_totals_t *) malloc(sizeof(perf_totals_t));
+    if (totals == NULL)
+        return NULL;
+
+    totals->nb_worker = nb_worker;
+    totals->workers = (perf_worker_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(perf_worker_t) * nb_worker);
+    if (totals->workers == NULL) {
+        free(totals);
+        return NULL;
+    }
+
+    perf_reset(totals);
+
+    return totals;
+}
+
+void perf_totals_destroy(perf_totals_t *totals) {
+    if (totals == NULL)
+        return;
+
+    free(totals->workers);
+    free(totals);
+}
+
+// State of each thread: the pool it is running for, its counters (one group, the first opened counter leads it)
+// and the phase in progress
+static _Thread_local perf_totals_t *table = NULL;
+static _Thread_local unsigned int worker_id = 0;
+static _Thread_local int opened = 0;
+static _Thread_local int fds[PERF_COUNTERS] = {-1, -1, -1, -1, -1, -1};
+// Position of each counter in the values read from the group, -1 if it is not in the group
+static _Thread_local int slot[PERF_COUNTERS];
+static _Thread_local int nb_slots = 0;
+static _Thread_local int leader = -1;
+static _Thread_local unsigned long long start_values[PERF_COUNTERS];
+static _Thread_local double start_time[PERF_PHASES];
+
+double perf_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (double) t.tv_sec + (double) t.tv_nsec * 1E-9;
+}
+
+static int open_counter(unsigned int type, unsigned long long config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // User space only: allowed with perf_event_paranoid <= 2
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.disabled = group < 0;
+
+    // This thread, any CPU
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+// Counters of the calling thread, opened the first time it enters a phase
+static void open_counters() {
+    const unsigned int types[PERF_COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                               PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+    const unsigned long long configs[PERF_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+
+    opened = 1;
+
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        slot[c] = -1;
+        fds[c] = open_counter(types[c], configs[c], leader);
+
+        // Not supported (or not allowed): the phase is timed without this counter
+        if (fds[c] < 0)
+            continue;
+
+        if (leader < 0)
+            leader = fds[c];
+
+        slot[c] = nb_slots++;
+        __atomic_store_n(&available[c], 1, __ATOMIC_RELAXED);
+    }
+
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+// Current values of the counters of the thread
+static void read_counters(unsigned long long values[PERF_COUNTERS]) {
+    // nr, then one value per counter of the group
+    unsigned long long buffer[1 + PERF_COUNTERS];
+
+    memset(values, 0, sizeof(unsigned long long) * PERF_COUNTERS);
+
+    if (leader < 0 || read(leader, buffer, sizeof(buffer)) < (ssize_t) sizeof(unsigned long long))
+        return;
+
+    for (int c = 0; c < PERF_COUNTERS; c++)
+        if (slot[c] >= 0 && (unsigned long long) slot[c] < buffer[0])
+            values[c] = buffer[1 + slot[c]];
+}
+
+void perf_set_worker(perf_totals_t *totals, unsigned int worker) {
+    table = totals;
+    worker_id = worker;
+}
+
+void perf_begin(int phase) {
+    if (!opened)
+        open_counters();
+
+    // Phases do not nest, a single set of start values is enough
+    read_counters(start_values);
+    start_time[phase] = perf_now();
+}
+
+void perf_end(int phase) {
+    double end_time = perf_now();
+    unsigned long long values[PERF_COUNTERS];
+    read_counters(values);
+
+    if (table == NULL || worker_id >= table->nb_worker)
+        return;
+
+    perf_phase_t *p = &table->workers[worker_id].phases[phase];
+    p->calls++;
+    p->seconds += end_time - start_time[phase];
+    for (int c = 0; c < PERF_COUNTERS; c++)
+        p->values[c] += values[c] - start_values[c];
+}
+
+void perf_add_time(int phase, double seconds) {
+    if (table == NULL || worker_id >= table->nb_worker)
+        return;
+
+    table->workers[worker_id].phases[phase].calls++;
+    table->workers[worker_id].phases[phase].seconds += seconds;
+}
+
+void perf_thread_exit() {
+    for (int c = 0; c < PERF_COUNTERS; c++)
+        if (fds[c] >= 0)
+            close(fds[c]);
+
+    leader = -1;
+    opened = 0;
+    nb_slots = 0;
+}
+
+void perf_report(FILE *out, const perf_totals_t *totals) {
+    if (totals == NULL) {
+        fprintf(out, "Counters not allocated for this pool\n");
+        return;
+    }
+
+    fprintf(out, "worker, phase, calls, seconds");
+    for (int c = 0; c < PERF_COUNTERS; c++)
+        fprintf(out, ", %s", counter_names[c]);
+    fprintf(out, ", IPC\n");
+
+    for (unsigned int w = 0; w < totals->nb_worker; w++) {
+        for (int phase = 0; phase < PERF_PHASES; phase++) {
+            const perf_phase_t *p = &totals->workers[w].phases[phase];
+            if (p->calls == 0)
+                continue;
+
+            fprintf(out, "%u, %s, %llu, %e", w, phase_names[phase], p->calls, p->seconds);
+            for (int c = 0; c < PERF_COUNTERS; c++) {
+                if (perf_counter_available(c))
+                    fprintf(out, ", %llu", p->values[c]);
+                else
+                    fprintf(out, ", n/a");
+            }
+
+            if (perf_counter_available(PERF_CYCLES) && perf_counter_available(PERF_INSTRUCTIONS) &&
+                p->values[PERF_CYCLES] > 0)
+                fprintf(out, ", %0.2f\n", (double) p->values[PERF_INSTRUCTIONS] / (double) p->values[PERF_CYCLES]);
+            else
+                fprintf(out, ", n/a\n");
+        }
+    }
+}
+
+#else
+
+int perf_compiled() {
+    return 0;
+}
+
+void perf_report(FILE *out, const perf_totals_t *totals) {
+    (void) totals;
+    fprintf(out, "Counters not compiled in (cmake -DSIMDNORM_PERF=ON)\n");
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdio.h>
+
+// Optional instrumentation: hardware counters (perf_event_open) per worker and per phase of a parallel call
+// Only compiled in with -DSIMDNORM_PERF (cmake -DSIMDNORM_PERF=ON), otherwise the PERF_* macros expand to nothing
+// and the pool and the reduction engine are exactly the same as without it
+
+// Phases of a call
+#define PERF_SPAWN 0     // from the publication of the job to its start in the worker (time only: two threads)
+#define PERF_COMPUTE 1   // the job itself: the kernel on the slices
+#define PERF_REDUCE 2    // adding up the partial results (calling thread)
+#define PERF_JOIN 3      // waiting at the completion barrier (calling thread)
+#define PERF_PHASES 4
+
+// Counters
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_L1D_MISSES 2
+#define PERF_LLC_MISSES 3
+#define PERF_STALLED 4   // backend stalls, not available on every CPU
+#define PERF_DTLB_MISSES 5
+#define PERF_COUNTERS 6
+
+// Totals of a phase for a worker
+typedef struct {
+    unsigned long long calls;
+    double seconds;
+    unsigned long long values[PERF_COUNTERS];
+} perf_phase_t;
+
+// Totals of the workers of one pool: each pool keeps its own, the calling thread of a pool being its worker 0
+typedef struct perf_totals perf_totals_t;
+
+#ifdef SIMDNORM_PERF
+
+// Table of nb_worker workers, NULL if it cannot be allocated (the pool then runs without counting)
+perf_totals_t *perf_totals_create(unsigned int nb_worker);
+void perf_totals_destroy(perf_totals_t *totals);
+
+// Table and index of the calling thread in the pool it is running for
+void perf_set_worker(perf_totals_t *totals, unsigned int worker);
+void perf_begin(int phase);
+void perf_end(int phase);
+// Time of a phase measured outside of the thread (spawn)
+void perf_add_time(int phase, double seconds);
+// Close the counters of the calling thread
+void perf_thread_exit();
+// CLOCK_MONOTONIC in seconds
+double perf_now();
+
+#define PERF_WORKER(totals, worker) perf_set_worker(totals, worker)
+#define PERF_BEGIN(phase) perf_begin(phase)
+#define PERF_END(phase) perf_end(phase)
+#define PERF_THREAD_EXIT() perf_thread_exit()
+
+#else
+
+#define PERF_WORKER(totals, worker) ((void) 0)
+#define PERF_BEGIN(phase) ((void) 0)
+#define PERF_END(phase) ((void) 0)
+#define PERF_THREAD_EXIT() ((void) 0)
+
+#endif
+
+// 1 if compiled with SIMDNORM_PERF
+int perf_compiled();
+
+// 1 if the counter could be opened (0 for every counter before the first phase, or without SIMDNORM_PERF)
+int perf_counter_available(int counter);
+
+// The totals below are the ones of a pool (pool_perf), NULL without SIMDNORM_PERF
+
+// Forget every total of the pool
+void perf_reset(perf_totals_t *totals);
+
+// Totals of a worker for a phase, NULL if the worker is not in the pool
+const perf_phase_t *perf_phase(const perf_totals_t *totals, unsigned int worker, int phase);
+
+// Table of the totals of every worker of the pool, per phase
+void perf_report(FILE *out, const perf_totals_t *totals);
+
+const char *perf_phase_name(int phase);
+const char *perf_counter_name(int counter);
+
+#endif //PERF_H
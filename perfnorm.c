@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <time.h>
+
+#include "harness.h"
+#include "perf.h"
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Floating point operations per element of the norm: one sqrt and one add (the abs value is a logical and)
+#define FLOPS_PER_ELT 2
+
+// Floats of each thread for the compute peak (16 KB, in L1)
+#define PEAK_FLOPS_FLOATS 4096
+#define PEAK_FLOPS_CALLS 20000
+
+// Job of the compute peak: each worker reduces its own L1 resident buffer again and again
+typedef struct {
+    float *buffers;
+    double *seconds;
+} peakjob_t;
+
+void peak_flops_job(peakjob_t *job, unsigned int worker) {
+    float *U = job->buffers + (size_t) worker * PEAK_FLOPS_FLOATS;
+    volatile float r;
+
+    double t0 = harness_now();
+    for (unsigned int c = 0; c < PEAK_FLOPS_CALLS; c++)
+        r = vect_norm(U, PEAK_FLOPS_FLOATS);
+    job->seconds[worker] = harness_now() - t0;
+
+    (void) r;
+}
+
+// Peak GFLOP/s of the kernel (sqrt + add) with the data in L1, on every thread of the context
+double peak_gflops(simdnorm_ctx_t *ctx) {
+    unsigned int nb_thread = simdnorm_nb_thread(ctx);
+    peakjob_t job = {(float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * PEAK_FLOPS_FLOATS * nb_thread),
+                     (double *) malloc(sizeof(double) * nb_thread)};
+
+    for (size_t i = 0; i < (size_t) PEAK_FLOPS_FLOATS * nb_thread; i++)
+        job.buffers[i] = (float) i;
+
+    pool_run(simdnorm_pool(ctx), (pool_job_t) peak_flops_job, &job);
+
+    // The slowest thread gives the time of the whole machine
+    double slowest = 0;
+    for (unsigned int w = 0; w < nb_thread; w++)
+        if (job.seconds[w] > slowest)
+            slowest = job.seconds[w];
+
+    free(job.buffers);
+    free(job.seconds);
+
+    return (double) FLOPS_PER_ELT * PEAK_FLOPS_FLOATS * PEAK_FLOPS_CALLS * nb_thread / slowest * 1E-9;
+}
+
+// Peak read bandwidth in GB/s: a sum of absolute values (one add per float, no sqrt) over the array itself,
+// so that the roof is the bandwidth of the level of the memory hierarchy the array lives in (L2, LLC or DRAM)
+double peak_bandwidth(simdnorm_ctx_t *ctx, float *U, size_t N) {
+    double best = 1E9;
+
+    for (unsigned int r = 0; r < 5; r++) {
+        double t0 = harness_now();
+        volatile float s = simdnorm_l1(ctx, U, N);
+        double t = harness_now() - t0;
+        (void) s;
+
+        if (t < best)
+            best = t;
+    }
+
+    return (double) N * sizeof(float) / best * 1E-9;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        printf("Usage: %s nb_elts nb_threads [calls]\n", argv[0]);
+        exit(1);
+    }
+
+    // Get number of elements
+    size_t N = (size_t) strtoull(argv[1], NULL, 10);
+
+    // Get number of threads
+    unsigned int nb_thread = (unsigned int) atoi(argv[2]);
+
+    // Number of calls measured
+    unsigned int calls = argc > 3 ? (unsigned int) atoi(argv[3]) : 20;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N);
+    for (size_t i = 0; i < N; i++)
+        U[i] = ((float) rand() / (float) (RAND_MAX));
+
+    double bw = peak_bandwidth(ctx, U, N);
+    double flops = peak_gflops(ctx);
+
+    // Warmup, then only the calls we time are counted
+    volatile float r = simdnorm_l1sqrt(ctx, U, N);
+    perf_reset(pool_perf(simdnorm_pool(ctx)));
+
+    double t0 = harness_now();
+    for (unsigned int c = 0; c < calls; c++)
+        r = simdnorm_l1sqrt(ctx, U, N);
+    double t = (harness_now() - t0) / calls;
+    (void) r;
+
+    double gbs = (double) N * sizeof(float) / t * 1E-9;
+    double gflops = (double) N * FLOPS_PER_ELT / t * 1E-9;
+    // Arithmetic intensity of the norm, in flops per byte read
+    double intensity = (double) FLOPS_PER_ELT / sizeof(float);
+    double bound = intensity * bw < flops ? intensity * bw : flops;
+
+    printf("Kernel: %s, N = %zu, %u threads, %u calls\n", kernel_name(kernel_current()), N, nb_thread, calls);
+    printf("\nRoofline\n");
+    printf("Measured peaks: %0.2f GB/s (read, same array), %0.2f GFLOP/s (sqrt + add, L1)\n", bw, flops);
+    printf("Arithmetic intensity: %0.2f flop/byte, ridge point %0.2f flop/byte\n", intensity, flops / bw);
+    printf("Achieved: %0.2f GB/s, %0.2f GFLOP/s, %e s per call\n", gbs, gflops, t);
+    printf("Bound: %0.2f GFLOP/s (%s), achieved %0.0f%% of it\n", bound,
+           intensity * bw < flops ? "memory bound" : "compute bound", gflops / bound * 100);
+
+    printf("\nCounters per worker and per phase (totals over the calls)\n");
+    perf_report(stdout, pool_perf(simdnorm_pool(ctx)));
+
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <immintrin.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "pipeline.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+static const char *stage_names[STAGE_COUNT] = {"affine", "clip", "mask"};
+
+const char *stage_name(int kind) {
+    return (kind >= 0 && kind < STAGE_COUNT) ? stage_names[kind] : "unknown";
+}
+
+pipeline_t *pipeline_create() {
+    pipeline_t *pipeline = (pipeline_t *) calloc(1, sizeof(pipeline_t));
+
+    pipeline->op = OP_L1SQRT;
+    pipeline->write = PIPELINE_NO_WRITE;
+
+    // Half of the L2: the scratch tile and the tile of U being read fit in it together
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    pipeline_set_tile(pipeline, (size_t) (l2 > 0 ? l2 : 1024 * 1024) / 2 / sizeof(float));
+
+    return pipeline;
+}
+
+static void free_scratch(pipeline_t *pipeline) {
+    for (unsigned int w = 0; w < pipeline->nb_scratch; w++)
+        free(pipeline->scratch[w]);
+    free(pipeline->scratch);
+
+    pipeline->scratch = NULL;
+    pipeline->nb_scratch = 0;
+}
+
+void pipeline_destroy(pipeline_t *pipeline) {
+    free_scratch(pipeline);
+    free(pipeline->partials);
+    free(pipeline);
+}
+
+int pipeline_add(pipeline_t *pipeline, int kind, float a, float b, const unsigned char *mask) {
+    if (pipeline->nb_stages >= PIPELINE_MAX_STAGES || kind < 0 || kind >= STAGE_COUNT)
+        return -1;
+
+    stage_t stage = {kind, a, b, mask};
+    pipeline->stages[pipeline->nb_stages] = stage;
+
+    return (int) pipeline->nb_stages++;
+}
+
+int pipeline_set_reduction(pipeline_t *pipeline, int op, float p) {
+    if (op != PIPELINE_NO_REDUCE && (op < 0 || op >= OP_COUNT || op_binary(op)))
+        return -1;
+
+    pipeline->op = op;
+    pipeline->p = p;
+
+    return op;
+}
+
+void pipeline_set_output(pipeline_t *pipeline, float *out, int write) {
+    pipeline->out = out;
+    pipeline->write = out != NULL ? write : PIPELINE_NO_WRITE;
+}
+
+void pipeline_set_tile(pipeline_t *pipeline, size_t tile) {
+    tile = (tile + REDUCE_BLOCK - 1) / REDUCE_BLOCK * REDUCE_BLOCK;
+    if (tile == 0)
+        tile = REDUCE_BLOCK;
+
+    // The scratch tiles are allocated again at the next run
+    if (tile != pipeline->tile)
+        free_scratch(pipeline);
+
+    pipeline->tile = tile;
+}
+
+// =============================================================== \\
+// Stages on n floats, from src (U or the scratch tile) to dst (the scratch tile), first is the index of src[0] in U
+
+static void stage_scalar(const stage_t *stage, const float *src, float *dst, size_t n, size_t first) {
+    switch (stage->kind) {
+        case STAGE_AFFINE:
+            for (size_t i = 0; i < n; i++)
+                dst[i] = stage->a * src[i] + stage->b;
+            break;
+        case STAGE_CLIP:
+            // Written as max_ps then min_ps (second operand on NaN)
+            for (size_t i = 0; i < n; i++) {
+                float y = src[i] > stage->a ? src[i] : stage->a;
+                dst[i] = y < stage->b ? y : stage->b;
+            }
+            break;
+        default:
+            for (size_t i = 0; i < n; i++)
+                dst[i] = stage->mask[first + i] != 0 ? src[i] : 0.0f;
+    }
+}
+
+static void write_scalar(const float *src, float *dst, size_t n) {
+    memcpy(dst, src, n * sizeof(float));
+}
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+// Same operations as stage_scalar (no FMA: a * x + b is rounded twice in both)
+// max_ps / min_ps return their second operand when one is NaN, as the comparisons of the scalar version
+static void stage_avx2(const stage_t *stage, const float *src, float *dst, size_t n, size_t first) {
+    __m256 a = _mm256_set1_ps(stage->a), b = _mm256_set1_ps(stage->b);
+    size_t i = 0;
+
+    switch (stage->kind) {
+        case STAGE_AFFINE:
+            for (; i + 8 <= n; i += 8)
+                _mm256_store_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(src + i)), b));
+            break;
+        case STAGE_CLIP:
+            for (; i + 8 <= n; i += 8)
+                _mm256_store_ps(dst + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), a), b));
+            break;
+        default:
+            for (; i + 8 <= n; i += 8) {
+                __m128i bytes = _mm_loadl_epi64((const __m128i *) (stage->mask + first + i));
+                __m256i zero = _mm256_cmpeq_epi32(_mm256_cvtepu8_epi32(bytes), _mm256_setzero_si256());
+                _mm256_store_ps(dst + i, _mm256_andnot_ps(_mm256_castsi256_ps(zero), _mm256_loadu_ps(src + i)));
+            }
+    }
+
+    stage_scalar(stage, src + i, dst + i, n - i, first + i);
+}
+
+// Non-temporal stores need 32 bytes aligned destinations: plain stores up to the boundary and for the tail
+static void write_avx2(const float *src, float *dst, size_t n, int stream) {
+    if (!stream) {
+        write_scalar(src, dst, n);
+        return;
+    }
+
+    size_t i = 0;
+    while (i < n && ((uintptr_t) (dst + i) & 31) != 0) {
+        dst[i] = src[i];
+        i++;
+    }
+
+    for (; i + 8 <= n; i += 8)
+        _mm256_stream_ps(dst + i, _mm256_loadu_ps(src + i));
+
+    for (; i < n; i++)
+        dst[i] = src[i];
+}
+
+#pragma GCC pop_options
+
+// =============================================================== \\
+// Threads
+
+typedef struct {
+    pipeline_t *pipeline;
+    unsigned int nb_thread;
+    const float *U;
+    size_t N;
+    int vect;
+    reduce_op_kernel_t kernel;
+} run_t;
+
+// Each worker takes a contiguous range of blocks, as the tree reduction, and goes through it tile by tile
+static void run_job(run_t *run, unsigned int worker) {
+    pipeline_t *pipeline = run->pipeline;
+    size_t nb_blocks = (run->N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    size_t tile_blocks = pipeline->tile / REDUCE_BLOCK;
+    float *scratch = pipeline->scratch[worker];
+    int stream = pipeline->write == PIPELINE_STREAM;
+
+    size_t first = (nb_blocks * worker) / run->nb_thread;
+    size_t last = (nb_blocks * (worker + 1)) / run->nb_thread;
+
+    for (size_t b = first; b < last; b += tile_blocks) {
+        size_t begin = b * REDUCE_BLOCK;
+        size_t end = (b + tile_blocks < last) ? (b + tile_blocks) * REDUCE_BLOCK : last * REDUCE_BLOCK;
+        if (end > run->N)
+            end = run->N;
+        size_t n = end - begin;
+
+        // The first stage reads U, the other ones the scratch tile (in place)
+        const float *src = run->U + begin;
+        for (unsigned int s = 0; s < pipeline->nb_stages; s++) {
+            if (run->vect)
+                stage_avx2(&pipeline->stages[s], src, scratch, n, begin);
+            else
+                stage_scalar(&pipeline->stages[s], src, scratch, n, begin);
+            src = scratch;
+        }
+
+        if (pipeline->write != PIPELINE_NO_WRITE) {
+            if (run->vect)
+                write_avx2(src, pipeline->out + begin, n, stream);
+            else
+                write_scalar(src, pipeline->out + begin, n);
+        }
+
+        // The tile is still in the cache
+        if (run->kernel != NULL) {
+            for (size_t k = b; k * REDUCE_BLOCK < end; k++) {
+                size_t size = (end - k * REDUCE_BLOCK < REDUCE_BLOCK) ? end - k * REDUCE_BLOCK : REDUCE_BLOCK;
+                pipeline->partials[k] = run->kernel(src + (k - b) * REDUCE_BLOCK, NULL, size, pipeline->p);
+            }
+        }
+    }
+
+    // The streamed lines are visible to the other threads once the pool barrier is passed
+    if (stream)
+        _mm_sfence();
+}
+
+float pipeline_run(pipeline_t *pipeline, simdnorm_ctx_t *ctx, const float *U, size_t N) {
+    unsigned int nb_thread = ctx->pool->nb_thread;
+    size_t nb_blocks = (N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    int vect = ctx->kernel >= KERNEL_AVX2;
+
+    if (pipeline->nb_scratch != nb_thread) {
+        free_scratch(pipeline);
+        pipeline->scratch = (float **) malloc(sizeof(float *) * nb_thread);
+        for (unsigned int w = 0; w < nb_thread; w++)
+            pipeline->scratch[w] = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * pipeline->tile);
+        pipeline->nb_scratch = nb_thread;
+    }
+
+    if (nb_blocks > pipeline->capacity) {
+        free(pipeline->partials);
+        pipeline->partials = (float *) malloc(sizeof(float) * nb_blocks);
+        pipeline->capacity = nb_blocks;
+    }
+
+    reduce_op_kernel_t kernel = pipeline->op != PIPELINE_NO_REDUCE ? op_kernel(pipeline->op, vect) : NULL;
+    run_t run = {pipeline, nb_thread, U, N, vect, kernel};
+    pool_run(ctx->pool, (pool_job_t) run_job, &run);
+
+    if (kernel == NULL)
+        return 0;
+
+    return reduce_tree(pipeline->partials, nb_blocks, op_combine(pipeline->op));
+}
@@ -0,0 +1,87 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+
+#include "simdnorm.h"
+
+// Transform-then-reduce without going back to the DRAM between the stages: the array is cut into tiles of about
+// half of the L2, each worker takes its tiles one after the other, runs every stage on the tile (the first one
+// reads U, the next ones work in a scratch tile which stays in the cache), optionally writes the transformed tile
+// back, then reduces it straight away
+//
+// The reduction is one partial per block of REDUCE_BLOCK floats with the kernels of ops.h, added up with the tree
+// of REDUCE_TREE: the same result as the stages run as separate sweeps followed by simdnorm_reduce, bit for bit
+// if the array given to simdnorm_reduce is 32-byte aligned. The kernels peel up to the first 32 bytes boundary
+// and the blocks are reduced from the scratch tiles, which are aligned: another alignment changes the order of the
+// additions (in the last bits only). Without stages the blocks are read from U itself, as simdnorm_reduce(U) does
+
+// Stages
+#define STAGE_AFFINE 0   // a * x + b (scaling: b = 0)
+#define STAGE_CLIP 1     // min(max(x, a), b)
+#define STAGE_MASK 2     // x if mask[i] != 0, 0 otherwise (mask indexed like U)
+#define STAGE_COUNT 3
+
+#define PIPELINE_MAX_STAGES 8
+
+// Write back of the transformed array
+#define PIPELINE_NO_WRITE 0   // only the reduction
+#define PIPELINE_STORE 1      // plain stores: the tile is written through the cache
+#define PIPELINE_STREAM 2     // non-temporal stores (_mm256_stream_ps): no read for ownership, no cache pollution
+
+// No reduction (OP_* of ops.h otherwise)
+#define PIPELINE_NO_REDUCE (-1)
+
+typedef struct {
+    int kind;
+    float a;
+    float b;
+    const unsigned char *mask;
+} stage_t;
+
+typedef struct {
+    stage_t stages[PIPELINE_MAX_STAGES];
+    unsigned int nb_stages;
+
+    // Reduction: OP_* (unary ones only) and its p for OP_LP
+    int op;
+    float p;
+
+    // Write back into out (can be U itself)
+    int write;
+    float *out;
+
+    // Floats per tile, a multiple of REDUCE_BLOCK
+    size_t tile;
+
+    // One scratch tile per worker, and the partial results of the blocks
+    float **scratch;
+    unsigned int nb_scratch;
+    float *partials;
+    size_t capacity;
+} pipeline_t;
+
+// Empty pipeline: no stage, OP_L1SQRT, no write back, tiles of half of the L2
+pipeline_t *pipeline_create();
+
+void pipeline_destroy(pipeline_t *pipeline);
+
+// Append a stage, returns its index, -1 if there are already PIPELINE_MAX_STAGES or the kind is unknown
+int pipeline_add(pipeline_t *pipeline, int kind, float a, float b, const unsigned char *mask);
+
+// Reduction of the transformed array (PIPELINE_NO_REDUCE for none), returns -1 for OP_DOT (2 arrays)
+int pipeline_set_reduction(pipeline_t *pipeline, int op, float p);
+
+// Write the transformed array into out with PIPELINE_STORE or PIPELINE_STREAM, PIPELINE_NO_WRITE to stop
+void pipeline_set_output(pipeline_t *pipeline, float *out, int write);
+
+// Floats per tile, rounded up to a multiple of REDUCE_BLOCK
+void pipeline_set_tile(pipeline_t *pipeline, size_t tile);
+
+// Run the stages and the reduction over U[0, N) on the threads of ctx, AVX2 if the kernel of ctx is at least AVX2
+// Returns the raw reduction (as simdnorm_reduce: no final root), 0 without reduction
+float pipeline_run(pipeline_t *pipeline, simdnorm_ctx_t *ctx, const float *U, size_t N);
+
+const char *stage_name(int kind);
+
+#endif //PIPELINE_H
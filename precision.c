@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Number of calls timed for each mode, we keep the fastest one
+#define REPEAT 3
+
+
+struct timespec diff(struct timespec start, struct timespec end)
+{
+    struct timespec temp;
+
+    if (end.tv_nsec-start.tv_nsec<0)
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec-1;
+        temp.tv_nsec = 1000000000+end.tv_nsec-start.tv_nsec;
+    }
+    else
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec;
+        temp.tv_nsec = end.tv_nsec-start.tv_nsec;
+    }
+    return temp;
+}
+
+// Reference computed with a double accumulator and Kahan compensation on top of it
+double reference_norm(float *U, size_t N) {
+    double s = 0, c = 0;
+
+    for (size_t i = 0; i < N; i++) {
+        double x = sqrt(fabs((double) U[i]));
+        double t = s + x;
+        c += (fabs(s) >= x) ? (s - t) + x : (x - t) + s;
+        s = t;
+    }
+
+    return s + c;
+}
+
+// Path used by time_mode
+#define PATH_SCALAR 0
+#define PATH_VECT 1
+#define PATH_THREADED 2
+
+// Fastest of REPEAT calls, in seconds, the result is stored in result
+// The threaded path splits U over the threads of the context (tree reduction)
+double time_mode(float *U, size_t N, int path, int accuracy, simdnorm_ctx_t *ctx, float *result) {
+    simdnorm_set_accuracy(ctx, accuracy);
+
+    double best = 1E9;
+
+    for (unsigned int r = 0; r < REPEAT; r++) {
+        struct timespec begining, end;
+        clock_gettime(CLOCK_MONOTONIC, &begining);
+
+        if (path == PATH_THREADED)
+            *result = simdnorm_l1sqrt(ctx, U, N);
+        else if (path == PATH_VECT)
+            *result = vect_norm_accurate(U, N, accuracy);
+        else
+            *result = norm_accurate(U, N, accuracy);
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        struct timespec t = diff(begining, end);
+        double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+        if (d < best)
+            best = d;
+    }
+
+    return best;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements, large enough by default for the float accumulators to stall
+    // It can go above 2^32 (16 GB of floats)
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 27;
+
+    // Get number of threads of the threaded path
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N);
+
+    // Initialization
+    for (size_t i = 0; i < N; i++)
+        U[i] = ((float) rand() / (float) (RAND_MAX));
+        //U[i] = 1.0f; // The exact result is then N
+
+    double ref = reference_norm(U, N);
+    printf("Reference: %e\n", ref);
+
+    float result;
+    double fast = time_mode(U, N, PATH_VECT, ACCURACY_FAST, ctx, &result);
+
+    const char *paths[3] = {"scalar", "vectorized", "threaded"};
+
+    printf("N = %zu, %u thread for the threaded path\n", N, nb_thread);
+    printf("path, mode, time, GB/s, relative error, cost vs fast vectorized\n");
+    for (int path = PATH_SCALAR; path <= PATH_THREADED; path++) {
+        for (int a = 0; a < ACCURACY_COUNT; a++) {
+            double t = time_mode(U, N, path, a, ctx, &result);
+
+            printf("%s, %s, %e, %0.2f, %e, x%0.2f\n", paths[path], accuracy_name(a), t,
+                   (double) N * sizeof(float) / t * 1E-9, fabs((double) result - ref) / ref, t / fast);
+        }
+    }
+
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+
+
+    return 0;
+}
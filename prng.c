@@ -0,0 +1,394 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "prng.h"
+
+static const char *names[PRNG_COUNT] = {"uniform", "normal", "constant"};
+
+const char *prng_name(int dist) {
+    return (dist >= 0 && dist < PRNG_COUNT) ? names[dist] : "unknown";
+}
+
+int prng_from_name(const char *name) {
+    for (int d = 0; d < PRNG_COUNT; d++)
+        if (strcmp(name, names[d]) == 0)
+            return d;
+
+    return -1;
+}
+
+// Philox4x32-10 constants (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// Box-Muller constants: log (cephes logf) and sin / cos on [-pi/4, pi/4] (cephes sinf / cosf)
+#define SQRTHF 0.707106781186547524f
+#define LOG_C0 7.0376836292E-2f
+#define LOG_C1 -1.1514610310E-1f
+#define LOG_C2 1.1676998740E-1f
+#define LOG_C3 -1.2420140846E-1f
+#define LOG_C4 1.4249322787E-1f
+#define LOG_C5 -1.6668057665E-1f
+#define LOG_C6 2.0000714765E-1f
+#define LOG_C7 -2.4999993993E-1f
+#define LOG_C8 3.3333331174E-1f
+#define LOG_Q1 -2.12194440E-4f
+#define LOG_Q2 0.693359375f
+#define SIN_C0 -1.9515295891E-4f
+#define SIN_C1 8.3321608736E-3f
+#define SIN_C2 -1.6666654611E-1f
+#define COS_C0 2.443315711809948E-5f
+#define COS_C1 -1.388731625493765E-3f
+#define COS_C2 4.166664568298827E-2f
+#define PI_2 1.5707963267948966f
+
+// =============================================================== \\
+// Scalar version
+
+static void philox(uint64_t block, uint64_t seed, uint32_t out[4]) {
+    uint32_t c0 = (uint32_t) block, c1 = (uint32_t) (block >> 32), c2 = 0, c3 = 0;
+    uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+
+        uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t) p1;
+        c3 = (uint32_t) p0;
+        c0 = n0;
+        c2 = n2;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// [0, 1) and (0, 1] with the 24 upper bits
+static inline float to_unit(uint32_t x) {
+    return (float) (x >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline float to_unit_open(uint32_t x) {
+    return (float) ((x >> 8) + 1) * (1.0f / 16777216.0f);
+}
+
+// log(x) for x in (0, 1]
+static float log_poly(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(float));
+
+    int e = (int) (bits >> 23) - 126;
+    bits = (bits & 0x7fffff) | 0x3f000000;
+    float m;
+    memcpy(&m, &bits, sizeof(float));
+
+    // m in [sqrt(1/2), sqrt(2)) - 1
+    if (m < SQRTHF) {
+        e -= 1;
+        m = m + m - 1.0f;
+    } else {
+        m = m - 1.0f;
+    }
+
+    float fe = (float) e;
+    float z = m * m;
+    float y = LOG_C0;
+    y = y * m + LOG_C1;
+    y = y * m + LOG_C2;
+    y = y * m + LOG_C3;
+    y = y * m + LOG_C4;
+    y = y * m + LOG_C5;
+    y = y * m + LOG_C6;
+    y = y * m + LOG_C7;
+    y = y * m + LOG_C8;
+    y = y * m * z;
+    y = y + LOG_Q1 * fe;
+    y = y - 0.5f * z;
+
+    return m + y + LOG_Q2 * fe;
+}
+
+// cos and sin of 2 pi u for u in [0, 1): quarter turn j, then r in [-pi/4, pi/4]
+static void sincos_turn(float u, float *c, float *s) {
+    float t = 4.0f * u;
+    float j = floorf(t + 0.5f);
+    float r = (t - j) * PI_2;
+    float r2 = r * r;
+
+    float sr = SIN_C0;
+    sr = sr * r2 + SIN_C1;
+    sr = sr * r2 + SIN_C2;
+    sr = sr * r2 * r + r;
+
+    float cr = COS_C0;
+    cr = cr * r2 + COS_C1;
+    cr = cr * r2 + COS_C2;
+    cr = cr * r2 * r2 - 0.5f * r2 + 1.0f;
+
+    switch ((int) j & 3) {
+        case 0:
+            *c = cr;
+            *s = sr;
+            break;
+        case 1:
+            *c = -sr;
+            *s = cr;
+            break;
+        case 2:
+            *c = -cr;
+            *s = -sr;
+            break;
+        default:
+            *c = sr;
+            *s = -cr;
+    }
+}
+
+// The 4 elements of a block
+static void block_values(uint64_t block, uint64_t seed, int dist, float a, float b, float out[4]) {
+    uint32_t x[4];
+
+    if (dist == PRNG_CONSTANT) {
+        out[0] = out[1] = out[2] = out[3] = a;
+        return;
+    }
+
+    philox(block, seed, x);
+
+    if (dist == PRNG_UNIFORM) {
+        float w = b - a;
+        for (int k = 0; k < 4; k++)
+            out[k] = a + w * to_unit(x[k]);
+        return;
+    }
+
+    // Normal: (x0, x1) and (x2, x3) give 2 values each
+    for (int k = 0; k < 4; k += 2) {
+        float r = sqrtf(-2.0f * log_poly(to_unit_open(x[k])));
+        float c, s;
+        sincos_turn(to_unit(x[k + 1]), &c, &s);
+        out[k] = a + b * (r * c);
+        out[k + 1] = a + b * (r * s);
+    }
+}
+
+// Elements [first, first + N) one block at a time
+static void fill_scalar(float *U, size_t N, int dist, float a, float b, uint64_t seed, size_t first) {
+    size_t i = 0;
+
+    while (i < N) {
+        size_t e = first + i;
+        float values[4];
+        block_values(e / 4, seed, dist, a, b, values);
+
+        for (size_t k = e % 4; k < 4 && i < N; k++, i++)
+            U[i] = values[k];
+    }
+}
+
+// =============================================================== \\
+// AVX2 version: 8 blocks (32 elements) per iteration, one vector per word of the blocks, transposed at the end
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+// Low and high 32 bits of the 8 products m * x
+static inline void mulhilo(__m256i x, __m256i m, __m256i *hi, __m256i *lo) {
+    __m256i even = _mm256_mul_epu32(x, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+
+    *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+static inline __m256 to_unit_avx2(__m256i x) {
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+}
+
+static inline __m256 to_unit_open_avx2(__m256i x) {
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_srli_epi32(x, 8), _mm256_set1_epi32(1))),
+                         _mm256_set1_ps(1.0f / 16777216.0f));
+}
+
+// Same operations as log_poly
+static inline __m256 log_avx2(__m256 x) {
+    __m256i bits = _mm256_castps_si256(x);
+    __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7fffff)),
+                                                   _mm256_set1_epi32(0x3f000000)));
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(SQRTHF), _CMP_LT_OQ);
+    // A true comparison is -1: e - 1 where m < sqrt(1/2)
+    e = _mm256_add_epi32(e, _mm256_castps_si256(small));
+    m = _mm256_blendv_ps(_mm256_sub_ps(m, one), _mm256_sub_ps(_mm256_add_ps(m, m), one), small);
+
+    __m256 fe = _mm256_cvtepi32_ps(e);
+    __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(LOG_C0);
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C1));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C2));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C3));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C4));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C5));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C6));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C7));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(LOG_C8));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+    y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_set1_ps(LOG_Q1), fe));
+    y = _mm256_sub_ps(y, _mm256_mul_ps(_mm256_set1_ps(0.5f), z));
+
+    return _mm256_add_ps(_mm256_add_ps(m, y), _mm256_mul_ps(_mm256_set1_ps(LOG_Q2), fe));
+}
+
+// Same operations as sincos_turn
+static inline void sincos_avx2(__m256 u, __m256 *c, __m256 *s) {
+    __m256 t = _mm256_mul_ps(_mm256_set1_ps(4.0f), u);
+    __m256 j = _mm256_floor_ps(_mm256_add_ps(t, _mm256_set1_ps(0.5f)));
+    __m256 r = _mm256_mul_ps(_mm256_sub_ps(t, j), _mm256_set1_ps(PI_2));
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 sr = _mm256_set1_ps(SIN_C0);
+    sr = _mm256_add_ps(_mm256_mul_ps(sr, r2), _mm256_set1_ps(SIN_C1));
+    sr = _mm256_add_ps(_mm256_mul_ps(sr, r2), _mm256_set1_ps(SIN_C2));
+    sr = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sr, r2), r), r);
+
+    __m256 cr = _mm256_set1_ps(COS_C0);
+    cr = _mm256_add_ps(_mm256_mul_ps(cr, r2), _mm256_set1_ps(COS_C1));
+    cr = _mm256_add_ps(_mm256_mul_ps(cr, r2), _mm256_set1_ps(COS_C2));
+    cr = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(cr, r2), r2),
+                                     _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)), _mm256_set1_ps(1.0f));
+
+    // Quadrant: bit 0 swaps sin and cos, then cos is negated in quadrants 1 and 2, sin in 2 and 3
+    __m256i q = _mm256_and_si256(_mm256_cvtps_epi32(j), _mm256_set1_epi32(3));
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, _mm256_set1_epi32(1)),
+                                                         _mm256_set1_epi32(1)));
+    __m256 sign = _mm256_set1_ps(-0.f);
+    __m256 neg_c = _mm256_and_ps(sign, _mm256_castsi256_ps(_mm256_or_si256(
+            _mm256_cmpeq_epi32(q, _mm256_set1_epi32(1)), _mm256_cmpeq_epi32(q, _mm256_set1_epi32(2)))));
+    __m256 neg_s = _mm256_and_ps(sign, _mm256_castsi256_ps(_mm256_cmpgt_epi32(q, _mm256_set1_epi32(1))));
+
+    *c = _mm256_xor_ps(_mm256_blendv_ps(cr, sr, swap), neg_c);
+    *s = _mm256_xor_ps(_mm256_blendv_ps(sr, cr, swap), neg_s);
+}
+
+// 8 consecutive blocks from block, transposed into 32 consecutive elements
+static inline void blocks_avx2(uint64_t block, uint64_t seed, int dist, __m256 a, __m256 b, float *out) {
+    __m256i c0, c1;
+
+    // The low word of the counter only wraps once every 2^32 blocks
+    if ((uint32_t) block <= 0xFFFFFFF8u) {
+        c0 = _mm256_add_epi32(_mm256_set1_epi32((int) (uint32_t) block), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        c1 = _mm256_set1_epi32((int) (uint32_t) (block >> 32));
+    } else {
+        uint32_t lo[8], hi[8];
+        for (int k = 0; k < 8; k++) {
+            lo[k] = (uint32_t) (block + k);
+            hi[k] = (uint32_t) ((block + k) >> 32);
+        }
+        c0 = _mm256_loadu_si256((const __m256i *) lo);
+        c1 = _mm256_loadu_si256((const __m256i *) hi);
+    }
+
+    __m256i c2 = _mm256_setzero_si256(), c3 = _mm256_setzero_si256();
+    uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+    __m256i m0 = _mm256_set1_epi32((int) PHILOX_M0), m1 = _mm256_set1_epi32((int) PHILOX_M1);
+
+    for (int round = 0; round < 10; round++) {
+        __m256i hi0, lo0, hi1, lo1;
+        mulhilo(c0, m0, &hi0, &lo0);
+        mulhilo(c2, m1, &hi1, &lo1);
+
+        c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int) k0));
+        c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int) k1));
+        c1 = lo1;
+        c3 = lo0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    __m256 v0, v1, v2, v3;
+    if (dist == PRNG_UNIFORM) {
+        __m256 w = _mm256_sub_ps(b, a);
+        v0 = _mm256_add_ps(a, _mm256_mul_ps(w, to_unit_avx2(c0)));
+        v1 = _mm256_add_ps(a, _mm256_mul_ps(w, to_unit_avx2(c1)));
+        v2 = _mm256_add_ps(a, _mm256_mul_ps(w, to_unit_avx2(c2)));
+        v3 = _mm256_add_ps(a, _mm256_mul_ps(w, to_unit_avx2(c3)));
+    } else {
+        __m256 minus2 = _mm256_set1_ps(-2.0f);
+        __m256 r01 = _mm256_sqrt_ps(_mm256_mul_ps(minus2, log_avx2(to_unit_open_avx2(c0))));
+        __m256 r23 = _mm256_sqrt_ps(_mm256_mul_ps(minus2, log_avx2(to_unit_open_avx2(c2))));
+        __m256 cos01, sin01, cos23, sin23;
+        sincos_avx2(to_unit_avx2(c1), &cos01, &sin01);
+        sincos_avx2(to_unit_avx2(c3), &cos23, &sin23);
+
+        v0 = _mm256_add_ps(a, _mm256_mul_ps(b, _mm256_mul_ps(r01, cos01)));
+        v1 = _mm256_add_ps(a, _mm256_mul_ps(b, _mm256_mul_ps(r01, sin01)));
+        v2 = _mm256_add_ps(a, _mm256_mul_ps(b, _mm256_mul_ps(r23, cos23)));
+        v3 = _mm256_add_ps(a, _mm256_mul_ps(b, _mm256_mul_ps(r23, sin23)));
+    }
+
+    // Lane k of vw is the word w of the block k: 4x8 transpose
+    __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+    __m256 t1 = _mm256_unpackhi_ps(v0, v1);
+    __m256 t2 = _mm256_unpacklo_ps(v2, v3);
+    __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+    // Blocks 0|4, 1|5, 2|6 and 3|7
+    __m256 u0 = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t2)));
+    __m256 u1 = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t2)));
+    __m256 u2 = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t1), _mm256_castps_pd(t3)));
+    __m256 u3 = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t1), _mm256_castps_pd(t3)));
+
+    _mm256_storeu_ps(out, _mm256_permute2f128_ps(u0, u1, 0x20));
+    _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(u2, u3, 0x20));
+    _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(u0, u1, 0x31));
+    _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(u2, u3, 0x31));
+}
+
+static void fill_avx2(float *U, size_t N, int dist, float a, float b, uint64_t seed, size_t first) {
+    __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b);
+
+    // Constant: no generator at all
+    if (dist == PRNG_CONSTANT) {
+        size_t i = 0;
+        for (; i + 8 <= N; i += 8)
+            _mm256_storeu_ps(U + i, va);
+        for (; i < N; i++)
+            U[i] = a;
+        return;
+    }
+
+    // Head up to the first element of a block
+    size_t head = (4 - first % 4) % 4;
+    if (head > N)
+        head = N;
+    fill_scalar(U, head, dist, a, b, seed, first);
+
+    size_t i = head;
+    for (; i + 32 <= N; i += 32)
+        blocks_avx2((first + i) / 4, seed, dist, va, vb, U + i);
+
+    fill_scalar(U + i, N - i, dist, a, b, seed, first + i);
+}
+
+#pragma GCC pop_options
+
+void prng_fill(float *U, size_t N, int dist, float a, float b, unsigned long long seed, size_t first, int vect) {
+    if (vect && __builtin_cpu_supports("avx2"))
+        fill_avx2(U, N, dist, a, b, (uint64_t) seed, first);
+    else
+        fill_scalar(U, N, dist, a, b, (uint64_t) seed, first);
+}
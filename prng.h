@@ -0,0 +1,26 @@
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stddef.h>
+
+// Counter-based generation of test arrays (Philox4x32-10): the value of U[i] only depends on the seed and on i,
+// so an array is the same whatever the number of threads filling it and whatever the kernel (scalar or AVX2)
+// Each Philox block (a 64-bit counter, the seed as key) gives 4 consecutive elements
+
+// Distributions
+#define PRNG_UNIFORM 0    // uniform in [a, b), 24 random bits
+#define PRNG_NORMAL 1     // normal of mean a and standard deviation b (Box-Muller)
+#define PRNG_CONSTANT 2   // a everywhere
+#define PRNG_COUNT 3
+
+// Fill U[0, N) with the elements first, first + 1, ... of the stream of seed, on the calling thread
+// The AVX2 kernel (8 blocks at a time) if vect is set and the CPU supports it, same values as the scalar one:
+// the log / sin / cos of Box-Muller are polynomials evaluated in the same order by both, without FMA
+void prng_fill(float *U, size_t N, int dist, float a, float b, unsigned long long seed, size_t first, int vect);
+
+const char *prng_name(int dist);
+
+// -1 if the name is unknown
+int prng_from_name(const char *name);
+
+#endif //PRNG_H
@@ -0,0 +1,292 @@
+#include <stdlib.h>
+
+#include "perf.h"
+#include "reduce.h"
+
+reducer_t *reducer_create(threadpool_t *pool, int mode) {
+    reducer_t *reducer = (reducer_t *) malloc(sizeof(reducer_t));
+    if (reducer == NULL)
+        return NULL;
+
+    reducer->pool = pool;
+    reducer->mode = mode;
+    // Enough slots for the slices of the lock-free mode and for the threads of the join mode
+    unsigned int nb_slots = pool->nb_thread > REDUCE_SLICES ? pool->nb_thread : REDUCE_SLICES;
+    reducer->slots = (reduce_slot_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(reduce_slot_t) * nb_slots);
+    reducer->partials = NULL;
+    reducer->capacity = 0;
+    reducer->ranges = (reduce_range_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(reduce_range_t) * pool->nb_thread);
+    if (reducer->slots == NULL || reducer->ranges == NULL) {
+        free(reducer->slots);
+        free(reducer->ranges);
+        free(reducer);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < pool->nb_thread; i++)
+        atomic_init(&reducer->ranges[i].range, 0);
+    atomic_init(&reducer->completed, 0);
+    atomic_init(&reducer->steals, 0);
+
+    return reducer;
+}
+
+void reducer_destroy(reducer_t *reducer) {
+    free(reducer->slots);
+    free(reducer->partials);
+    free(reducer->ranges);
+    free(reducer);
+}
+
+// Kernel of the current job on [begin, begin+size)
+static inline float apply(reducer_t *reducer, size_t begin, size_t size) {
+    if (reducer->half_kernel != NULL)
+        return reducer->half_kernel(reducer->H + begin, size);
+
+    if (reducer->op_kernel == NULL)
+        return reducer->kernel(reducer->U + begin, size);
+
+    return reducer->op_kernel(reducer->U + begin, reducer->V == NULL ? NULL : reducer->V + begin, size, reducer->p);
+}
+
+static inline float combine(int mode, float a, float b) {
+    if (mode == COMBINE_MAX)
+        return a > b ? a : b;
+
+    return a + b;
+}
+
+// Lock-free job: each worker computes a contiguous range of slices and stores them in their own slot
+// The worker completing the last slice adds up the slots, always in the same order
+static void lockfree_job(reducer_t *reducer, unsigned int worker) {
+    unsigned int nb_thread = reducer->pool->nb_thread;
+    // We keep a multiple of 8 floats per slice so that every slice starts as aligned as U
+    size_t elt_per_slice = (reducer->N / REDUCE_SLICES) & ~(size_t) 7;
+
+    unsigned int first = (unsigned int) (((unsigned long) REDUCE_SLICES * worker) / nb_thread);
+    unsigned int last = (unsigned int) (((unsigned long) REDUCE_SLICES * (worker + 1)) / nb_thread);
+
+    for (unsigned int s = first; s < last; s++) {
+        // The last slice also takes the remainder
+        size_t size = (s == REDUCE_SLICES - 1) ? reducer->N - s * elt_per_slice : elt_per_slice;
+        reducer->slots[s].v = apply(reducer, s * elt_per_slice, size);
+    }
+
+    // Release our slots, the last one to arrive acquires all of them
+    unsigned int done = atomic_fetch_add_explicit(&reducer->completed, last - first, memory_order_acq_rel) + (last - first);
+
+    if (last > first && done == REDUCE_SLICES) {
+        float r = reducer->slots[0].v;
+        for (unsigned int s = 1; s < REDUCE_SLICES; s++)
+            r = combine(reducer->combine, r, reducer->slots[s].v);
+        reducer->result = r;
+    }
+}
+
+// Tree job: each worker computes the partial sums of a contiguous range of blocks
+static void tree_job(reducer_t *reducer, unsigned int worker) {
+    unsigned int nb_thread = reducer->pool->nb_thread;
+    size_t nb_blocks = (reducer->N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+
+    size_t first = (nb_blocks * worker) / nb_thread;
+    size_t last = (nb_blocks * (worker + 1)) / nb_thread;
+
+    for (size_t b = first; b < last; b++) {
+        size_t begin = b * REDUCE_BLOCK;
+        size_t size = (reducer->N - begin < REDUCE_BLOCK) ? reducer->N - begin : REDUCE_BLOCK;
+        reducer->partials[b] = apply(reducer, begin, size);
+    }
+}
+
+// Packing of the ranges of the stealing mode
+static inline unsigned long long pack_range(size_t begin, size_t end) {
+    return (unsigned long long) begin | ((unsigned long long) end << 32);
+}
+
+static inline size_t range_begin(unsigned long long r) {
+    return (size_t) (r & 0xffffffffull);
+}
+
+static inline size_t range_end(unsigned long long r) {
+    return (size_t) (r >> 32);
+}
+
+// Stealing job: chunks from the front of our own range, then half of the range of another thread
+// A block is only given once (the ranges only shrink, or are refilled with blocks nobody else can reach),
+// so there is no ABA problem on the compare-and-swap
+static void steal_job(reducer_t *reducer, unsigned int worker) {
+    unsigned int nb_thread = reducer->pool->nb_thread;
+    _Atomic unsigned long long *own = &reducer->ranges[worker].range;
+
+    for (;;) {
+        unsigned long long r = atomic_load_explicit(own, memory_order_acquire);
+        size_t begin = range_begin(r), end = range_end(r);
+
+        if (begin < end) {
+            size_t chunk = (end - begin) / REDUCE_STEAL_SPLIT;
+            if (chunk == 0)
+                chunk = 1;
+
+            if (!atomic_compare_exchange_weak_explicit(own, &r, pack_range(begin + chunk, end),
+                                                       memory_order_acq_rel, memory_order_acquire))
+                continue;
+
+            for (size_t b = begin; b < begin + chunk; b++) {
+                size_t first = b * REDUCE_BLOCK;
+                size_t size = (reducer->N - first < REDUCE_BLOCK) ? reducer->N - first : REDUCE_BLOCK;
+                reducer->partials[b] = apply(reducer, first, size);
+            }
+            continue;
+        }
+
+        // Our range is empty: steal the back half of the first non empty range, starting with our neighbour
+        int stolen = 0;
+        for (unsigned int k = 1; k < nb_thread && !stolen; k++) {
+            _Atomic unsigned long long *victim = &reducer->ranges[(worker + k) % nb_thread].range;
+            unsigned long long v = atomic_load_explicit(victim, memory_order_acquire);
+
+            while (range_begin(v) < range_end(v)) {
+                size_t vbegin = range_begin(v), vend = range_end(v);
+                size_t half = (vend - vbegin + 1) / 2;
+
+                if (atomic_compare_exchange_weak_explicit(victim, &v, pack_range(vbegin, vend - half),
+                                                          memory_order_acq_rel, memory_order_acquire)) {
+                    // Nobody steals from an empty range, we are the only one writing ours
+                    atomic_store_explicit(own, pack_range(vend - half, vend), memory_order_release);
+                    atomic_fetch_add_explicit(&reducer->steals, 1, memory_order_relaxed);
+                    stolen = 1;
+                    break;
+                }
+            }
+        }
+
+        // Every block is taken (some may still be computed, the barrier of the pool waits for them)
+        if (!stolen)
+            return;
+    }
+}
+
+void reduce_slice(size_t N, unsigned int nb_thread, unsigned int worker, size_t *begin, size_t *size) {
+    size_t elt_per_thread = (N / nb_thread) & ~(size_t) 7;
+
+    *begin = worker * elt_per_thread;
+    *size = (worker == nb_thread - 1) ? N - *begin : elt_per_thread;
+}
+
+// Join job: one slice per thread, each result on its own cache line
+static void join_job(reducer_t *reducer, unsigned int worker) {
+    size_t begin, size;
+    reduce_slice(reducer->N, reducer->pool->nb_thread, worker, &begin, &size);
+
+    reducer->slots[worker].v = apply(reducer, begin, size);
+}
+
+// Pairwise sum (or max) of the partial sums, the shape of the tree only depends on their number
+static float tree_sum(float *partials, size_t n, int mode) {
+    if (n == 0)
+        return 0;
+
+    for (size_t stride = 1; stride < n; stride *= 2)
+        for (size_t i = 0; i + stride < n; i += 2 * stride)
+            partials[i] = combine(mode, partials[i], partials[i + stride]);
+
+    return partials[0];
+}
+
+// Runs the job described in reducer
+static float run(reducer_t *reducer) {
+    size_t N = reducer->N;
+
+    atomic_store_explicit(&reducer->steals, 0, memory_order_relaxed);
+
+    if (reducer->mode == REDUCE_LOCKFREE) {
+        atomic_store_explicit(&reducer->completed, 0, memory_order_relaxed);
+        reducer->result = 0;
+
+        pool_run(reducer->pool, (pool_job_t) lockfree_job, reducer);
+
+        return reducer->result;
+    } else if (reducer->mode == REDUCE_JOIN) {
+        pool_run(reducer->pool, (pool_job_t) join_job, reducer);
+
+        // When the threads end, we retrieve their result and add it into the result variable
+        PERF_BEGIN(PERF_REDUCE);
+        float r = reducer->slots[0].v;
+        for (unsigned int i = 1; i < reducer->pool->nb_thread; i++)
+            r = combine(reducer->combine, r, reducer->slots[i].v);
+        PERF_END(PERF_REDUCE);
+
+        return r;
+    } else {
+        // Tree and stealing modes
+        size_t nb_blocks = (N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+
+        // The table of partial sums only grows
+        if (nb_blocks > reducer->capacity) {
+            free(reducer->partials);
+            reducer->partials = (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * nb_blocks + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+            reducer->capacity = nb_blocks;
+        }
+
+        if (reducer->mode == REDUCE_STEAL) {
+            // One contiguous range of blocks per thread to start with, published to the workers by pool_run
+            unsigned int nb_thread = reducer->pool->nb_thread;
+            for (unsigned int i = 0; i < nb_thread; i++)
+                atomic_store_explicit(&reducer->ranges[i].range,
+                                      pack_range((nb_blocks * i) / nb_thread, (nb_blocks * (i + 1)) / nb_thread),
+                                      memory_order_relaxed);
+
+            pool_run(reducer->pool, (pool_job_t) steal_job, reducer);
+        } else {
+            pool_run(reducer->pool, (pool_job_t) tree_job, reducer);
+        }
+
+        // After the barrier every partial sum is available
+        PERF_BEGIN(PERF_REDUCE);
+        float r = tree_sum(reducer->partials, nb_blocks, reducer->combine);
+        PERF_END(PERF_REDUCE);
+
+        return r;
+    }
+}
+
+float reduce_tree(float *partials, size_t n, int combine) {
+    return tree_sum(partials, n, combine);
+}
+
+float reduce_run(reducer_t *reducer, reduce_kernel_t kernel, float *U, size_t N) {
+    reducer->kernel = kernel;
+    reducer->op_kernel = NULL;
+    reducer->half_kernel = NULL;
+    reducer->U = U;
+    reducer->V = NULL;
+    reducer->N = N;
+    reducer->combine = COMBINE_SUM;
+
+    return run(reducer);
+}
+
+// The kernels never write in the arrays
+float reduce_run_op(reducer_t *reducer, reduce_op_kernel_t kernel, int combine, const float *U, const float *V,
+                    size_t N, float p) {
+    reducer->kernel = NULL;
+    reducer->op_kernel = kernel;
+    reducer->half_kernel = NULL;
+    reducer->U = (float *) U;
+    reducer->V = V;
+    reducer->N = N;
+    reducer->p = p;
+    reducer->combine = combine;
+
+    return run(reducer);
+}
+
+float reduce_run_half(reducer_t *reducer, reduce_half_kernel_t kernel, const uint16_t *U, size_t N) {
+    reducer->kernel = NULL;
+    reducer->op_kernel = NULL;
+    reducer->half_kernel = kernel;
+    reducer->H = U;
+    reducer->N = N;
+    reducer->combine = COMBINE_SUM;
+
+    return run(reducer);
+}
@@ -0,0 +1,116 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "threadpool.h"
+
+// Lock-free mode: fixed number of slices, one padded slot each, the last slice to finish adds them up
+#define REDUCE_LOCKFREE 0
+// Deterministic mode: one partial sum per fixed size block, added up with a fixed-shape tree
+#define REDUCE_TREE 1
+// Join mode (as main.c used to do): one slice per thread, the partial sums are added in the order of the threads
+// Cheapest for small arrays but the result depends on the number of threads
+#define REDUCE_JOIN 2
+
+// Work-stealing mode: the blocks of the tree mode are cut in one contiguous range per thread, each thread takes chunks
+// from the front of its own range then steals half of the range of another one once it is empty
+// Same partial sums and same tree as the tree mode (hence the same result), but a slow core only delays its last chunk
+#define REDUCE_STEAL 3
+
+// Number of slices of the lock-free mode
+// It does not depend on the number of threads: the slices are only shared out between them,
+// thus the same additions are done in the same order whatever the number of threads
+#define REDUCE_SLICES 256
+
+// Number of floats per block of the tree mode (16 KB, stays in the L1 cache), also the tiles of the stealing mode
+#define REDUCE_BLOCK 4096
+
+// Stealing mode: a thread takes 1/REDUCE_STEAL_SPLIT of what is left of its range at a time, so the chunks start large
+// (few atomics) and get smaller near the end (small imbalance)
+#define REDUCE_STEAL_SPLIT 4
+
+// Per-element kernel applied on each slice / block, vect_norm for instance
+typedef float (*reduce_kernel_t)(float *U, size_t N);
+
+// Kernel of the generic reductions (ops.h): V is the second array of the binary ones (dot product), NULL otherwise,
+// p the parameter of the reduction (exponent of the p-norms)
+typedef float (*reduce_op_kernel_t)(const float *U, const float *V, size_t N, float p);
+
+// Kernel on 16 bits elements (fp16 / bf16 of half.h), the slices are cut in elements as for the float arrays
+typedef float (*reduce_half_kernel_t)(const uint16_t *U, size_t N);
+
+// How the partial results of the slices / blocks are combined
+#define COMBINE_SUM 0
+#define COMBINE_MAX 1
+
+// One partial sum per cache line to avoid false sharing
+typedef struct {
+    float v;
+    char pad[CACHE_LINE_SIZE - sizeof(float)];
+} reduce_slot_t;
+
+// Range of blocks [begin, end) left to a thread in the stealing mode, begin in the low 32 bits and end in the high ones
+// so that the owner and the thieves update it with a single compare-and-swap (up to 2^32 blocks, 2^44 floats)
+typedef struct {
+    _Atomic unsigned long long range;
+    char pad[CACHE_LINE_SIZE - sizeof(unsigned long long)];
+} reduce_range_t;
+
+typedef struct {
+    threadpool_t *pool;
+    int mode;
+
+    // Current job: either kernel on U, op_kernel on U and V, or half_kernel on H
+    reduce_kernel_t kernel;
+    reduce_op_kernel_t op_kernel;
+    reduce_half_kernel_t half_kernel;
+    float *U;
+    const uint16_t *H;
+    const float *V;
+    size_t N;
+    float p;
+    int combine;
+
+    // Lock-free mode: partial sum of each slice and number of slices already computed (join mode: of each thread)
+    reduce_slot_t *slots;
+    atomic_uint completed;
+    float result;
+
+    // Tree and stealing modes: partial sum of each block
+    float *partials;
+    size_t capacity;
+
+    // Stealing mode: blocks left to each thread, and number of chunks stolen during the last run
+    reduce_range_t *ranges;
+    atomic_uint steals;
+} reducer_t;
+
+// NULL if out of memory
+reducer_t *reducer_create(threadpool_t *pool, int mode);
+
+// Apply kernel on U split over the threads of the pool and add up the partial sums
+// The result is bit-identical for a given input whatever the number of threads
+float reduce_run(reducer_t *reducer, reduce_kernel_t kernel, float *U, size_t N);
+
+// Same with a generic kernel, its partial results are combined with combine (COMBINE_SUM or COMBINE_MAX)
+// V can be NULL, otherwise it is split exactly as U
+float reduce_run_op(reducer_t *reducer, reduce_op_kernel_t kernel, int combine, const float *U, const float *V,
+                    size_t N, float p);
+
+// Same on an array of 16 bits elements, the partial results are added
+float reduce_run_half(reducer_t *reducer, reduce_half_kernel_t kernel, const uint16_t *U, size_t N);
+
+void reducer_destroy(reducer_t *reducer);
+
+// Slice of worker in the join mode: a multiple of 8 floats per thread (each slice starts as aligned as U),
+// the last one also takes the remainder
+void reduce_slice(size_t N, unsigned int nb_thread, unsigned int worker, size_t *begin, size_t *size);
+
+// Pairwise sum (COMBINE_SUM) or max (COMBINE_MAX) of n partial results, in place, with the tree of REDUCE_TREE:
+// per-block partials computed elsewhere give the same result as the tree mode
+float reduce_tree(float *partials, size_t n, int combine);
+
+#endif //REDUCE_H
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Number of calls timed for each reduction, we keep the fastest one
+#define REPEAT 5
+
+
+struct timespec diff(struct timespec start, struct timespec end)
+{
+    struct timespec temp;
+
+    if (end.tv_nsec-start.tv_nsec<0)
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec-1;
+        temp.tv_nsec = 1000000000+end.tv_nsec-start.tv_nsec;
+    }
+    else
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec;
+        temp.tv_nsec = end.tv_nsec-start.tv_nsec;
+    }
+    return temp;
+}
+
+// Reference of each reduction, computed in double
+double reference(int op, float *U, float *V, size_t N, float p) {
+    double r = 0;
+
+    for (size_t i = 0; i < N; i++) {
+        double x = U[i];
+
+        switch (op) {
+            case OP_L1SQRT:
+                r += sqrt(fabs(x));
+                break;
+            case OP_L1:
+                r += fabs(x);
+                break;
+            case OP_L2SQ:
+                r += x * x;
+                break;
+            case OP_LINF:
+                r = fabs(x) > r ? fabs(x) : r;
+                break;
+            case OP_LP:
+                r += pow(fabs(x), p);
+                break;
+            case OP_DOT:
+                r += x * V[i];
+                break;
+        }
+    }
+
+    return r;
+}
+
+// Path used by time_op
+#define PATH_SCALAR 0
+#define PATH_AVX2 1
+#define PATH_THREADED 2
+
+// Fastest of REPEAT calls, in seconds, the result is stored in result
+double time_op(int op, int path, float *U, float *V, size_t N, float p, simdnorm_ctx_t *ctx, float *result) {
+    reduce_op_kernel_t kernel = op_kernel(op, path != PATH_SCALAR);
+    double best = 1E9;
+
+    for (unsigned int r = 0; r < REPEAT; r++) {
+        struct timespec begining, end;
+        clock_gettime(CLOCK_MONOTONIC, &begining);
+
+        if (path == PATH_THREADED)
+            *result = simdnorm_reduce(ctx, op, U, V, N, p);
+        else
+            *result = kernel(U, V, N, p);
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        struct timespec t = diff(begining, end);
+        double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+        if (d < best)
+            best = d;
+    }
+
+    return best;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 24;
+
+    // Get number of threads of the threaded path
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    // Exponent of the p-norm
+    float p = argc > 3 ? strtof(argv[3], NULL) : 3.0f;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N);
+    float *V = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N);
+
+    // Initialization, signed values so that the absolute values matter
+    for (size_t i = 0; i < N; i++) {
+        U[i] = 2.0f * ((float) rand() / (float) (RAND_MAX)) - 1.0f;
+        V[i] = 2.0f * ((float) rand() / (float) (RAND_MAX)) - 1.0f;
+    }
+
+    const char *paths[3] = {"scalar", "avx2", "threaded"};
+
+    printf("N = %zu, %u threads for the threaded path, p = %g, kernel %s\n", N, nb_thread, p,
+           kernel_name(kernel_current()));
+    printf("reduction, path, time, GB/s, relative error, speedup vs scalar\n");
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        double ref = reference(op, U, V, N, p);
+        // Bytes read by the reduction
+        double bytes = (double) N * sizeof(float) * (op_binary(op) ? 2 : 1);
+        double scalar = 0;
+
+        for (int path = PATH_SCALAR; path <= PATH_THREADED; path++) {
+            float result;
+            double t = time_op(op, path, U, V, N, p, ctx, &result);
+            if (path == PATH_SCALAR)
+                scalar = t;
+
+            printf("%s, %s, %e, %0.2f, %e, x%0.2f\n", op_name(op), paths[path], t, bytes / t * 1E-9,
+                   fabs((double) result - ref) / fabs(ref), scalar / t);
+        }
+    }
+
+    // The generic l1sqrt against the hand-written kernel: the macro-generated loop should cost nothing more
+    float result;
+    double t_generic = time_op(OP_L1SQRT, PATH_AVX2, U, V, N, p, ctx, &result);
+    double t_hand = 1E9;
+    for (unsigned int r = 0; r < REPEAT; r++) {
+        struct timespec begining, end;
+        clock_gettime(CLOCK_MONOTONIC, &begining);
+        volatile float v = vect_norm_avx2(U, N);
+        (void) v;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        struct timespec t = diff(begining, end);
+        double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+        if (d < t_hand)
+            t_hand = d;
+    }
+    printf("l1sqrt: generic %e s, vect_norm_avx2 %e s\n", t_generic, t_hand);
+
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+    free(V);
+
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <math.h>
+
+#include "harness.h"
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Inputs checked per call of sqrt_approx
+#define CHECK_CHUNK ((size_t) 1 << 20)
+
+typedef void (*approx_fn_t)(const float *U, float *out, size_t N, int newton);
+
+
+static inline uint32_t bits_of(float x) {
+    uint32_t b;
+    memcpy(&b, &x, sizeof(b));
+    return b;
+}
+
+static inline float float_of(uint32_t b) {
+    float x;
+    memcpy(&x, &b, sizeof(x));
+    return x;
+}
+
+// Every positive float (the kernels take the absolute value first): ULP distance to the correctly rounded sqrtf for
+// the normal ones, 0 expected for zero and the denormals, NaN for infinity and NaN
+// Returns the number of inputs outside of the documented behaviour
+unsigned long check(approx_fn_t fn, const char *path, int newton, unsigned long bound) {
+    float *in = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * CHECK_CHUNK);
+    float *out = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * CHECK_CHUNK);
+
+    unsigned long max_ulp = 0, errors = 0;
+    uint32_t worst = 0;
+    double max_rel = 0;
+
+    for (uint64_t base = 0; base < ((uint64_t) 1 << 31); base += CHECK_CHUNK) {
+        for (size_t i = 0; i < CHECK_CHUNK; i++)
+            in[i] = float_of((uint32_t) (base + i));
+
+        fn(in, out, CHECK_CHUNK, newton);
+
+        for (size_t i = 0; i < CHECK_CHUNK; i++) {
+            float x = in[i];
+
+            if (isnan(x) || isinf(x)) {
+                if (!isnan(out[i]))
+                    errors++;
+                continue;
+            }
+
+            if (x < FLT_MIN) {
+                if (out[i] != 0.0f)
+                    errors++;
+                continue;
+            }
+
+            float exact = sqrtf(x);
+            uint32_t a = bits_of(out[i]), b = bits_of(exact);
+            unsigned long ulp = a > b ? a - b : b - a;
+
+            if (ulp > max_ulp) {
+                max_ulp = ulp;
+                worst = bits_of(x);
+            }
+            double rel = fabs((double) out[i] - exact) / exact;
+            if (rel > max_rel)
+                max_rel = rel;
+
+            if (ulp > bound)
+                errors++;
+        }
+    }
+
+    printf("%s, %s: max %lu ULP (bound %lu) for x = %a, max relative error %e, %lu inputs out of the bound\n",
+           path, newton ? "rsqrt + Newton" : "rsqrt", max_ulp, bound, (double) float_of(worst), max_rel, errors);
+
+    free(in);
+    free(out);
+
+    return errors;
+}
+
+// Double reference of the norm
+double reference_norm(float *U, size_t N) {
+    double s = 0;
+
+    for (size_t i = 0; i < N; i++)
+        s += sqrt(fabs((double) U[i]));
+
+    return s;
+}
+
+typedef struct {
+    kernel_fn_t fn;
+    float *U;
+    size_t N;
+    volatile float result;
+} call_t;
+
+void call(call_t *c) {
+    c->result = c->fn(c->U, c->N);
+}
+
+// Throughput of the exact and approximate kernels on cache resident data (where the sqrt is the bottleneck)
+void bench(size_t max_n) {
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * max_n);
+
+    srand(42);
+    for (size_t i = 0; i < max_n; i++)
+        U[i] = 2.0f * ((float) rand() / (float) (RAND_MAX)) - 1.0f;
+
+    const kernel_fn_t fns[4] = {vect_norm, vect_norm_avx2, vect_norm_rsqrt, vect_norm_rsqrt_newton};
+    char exact[64];
+    snprintf(exact, sizeof(exact), "exact (%s)", kernel_name(kernel_current()));
+    const char *names[4] = {exact, "exact (avx2)", "rsqrt", "rsqrt + Newton"};
+
+    harness_config_t config = {10, 1000, 20, 0.2, NULL, 0};
+
+    printf("N, kernel, median ns, Gfloat/s, relative error, speedup vs exact avx2\n");
+    for (size_t n = 4096; n <= max_n; n *= 4) {
+        double ref = reference_norm(U, n);
+        double exact_avx2 = 0;
+
+        for (int k = 0; k < 4; k++) {
+            if (k == 1 && !kernel_supported(KERNEL_AVX2))
+                continue;
+
+            call_t c = {fns[k], U, n, 0};
+            harness_result_t r;
+            harness_measure((harness_fn_t) call, &c, &config, &r);
+
+            if (k == 1)
+                exact_avx2 = r.seconds.median;
+
+            printf("%zu, %s, %.0f, %0.2f, %e, x%0.2f\n", n, names[k], r.seconds.median * 1E9,
+                   (double) n / r.seconds.median * 1E-9, fabs((double) c.result - ref) / ref,
+                   exact_avx2 > 0 ? exact_avx2 / r.seconds.median : 1.0);
+        }
+    }
+
+    free(U);
+}
+
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 2) {
+        printf("Usage: %s check | bench [max_elts]\n", argv[0]);
+        exit(1);
+    }
+
+    if (strcmp(argv[1], "check") == 0) {
+        // Every float32 input, for both modes, on the scalar path and on the AVX2 one when the CPU has it
+        // (both are checked whatever the selected kernel: sqrt_approx only ever runs one of them)
+        unsigned long errors = check(sqrt_approx_scalar, "scalar", 0, RSQRT_MAX_ULP) +
+                               check(sqrt_approx_scalar, "scalar", 1, RSQRT_NEWTON_MAX_ULP);
+
+        if (kernel_supported(KERNEL_AVX2))
+            errors += check(sqrt_approx_avx2, "avx2", 0, RSQRT_MAX_ULP) +
+                      check(sqrt_approx_avx2, "avx2", 1, RSQRT_NEWTON_MAX_ULP);
+        else
+            printf("avx2: not supported by this CPU, not checked\n");
+
+        if (errors != 0) {
+            printf("FAILED\n");
+            exit(1);
+        }
+        printf("OK\n");
+    } else if (strcmp(argv[1], "bench") == 0) {
+        // From L1 (16 KB) to L2 (1 MB) by default
+        bench(argc > 2 ? (size_t) strtoull(argv[2], NULL, 10) : (size_t) 1 << 18);
+    } else {
+        printf("Usage: %s check | bench [max_elts]\n", argv[0]);
+        exit(1);
+    }
+
+
+    return 0;
+}
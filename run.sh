@@ -6,7 +6,7 @@ cmake ..
 make
 
 echo "Classic non vector"
-./nonvector 33554432
+./projetnonvect 33554432
 
 echo "Standard Version 2 threads"
 ./projet 33554432 2
@@ -19,4 +19,5 @@ echo "Mutex Version 2 threads"
 echo "Mutex Version 4 threads"
 ./projetmutex 33554432 4
 
-
+echo "Unaligned data, 2 threads"
+./projetunaligned 33554432 2
@@ -0,0 +1,304 @@
+#include <stdlib.h>
+
+#include <math.h>
+
+#include "simdnorm.h"
+
+// Function applied on each slice for a kernel and an accuracy mode, chosen once here
+// The accurate modes have a scalar and an AVX2 version: the vectorized one if the kernel is at least AVX2
+static kernel_fn_t select_fn(int kernel, int accuracy) {
+    int vect = kernel >= KERNEL_AVX2;
+
+    switch (accuracy) {
+        case ACCURACY_KAHAN:
+            return vect ? vect_norm_kahan_avx2 : norm_kahan;
+        case ACCURACY_PAIRWISE:
+            return vect ? vect_norm_pairwise_avx2 : norm_pairwise;
+        case ACCURACY_DOUBLE:
+            return vect ? vect_norm_double_avx2 : norm_double;
+        case ACCURACY_RSQRT:
+            return vect ? vect_norm_rsqrt_avx2 : norm_rsqrt;
+        case ACCURACY_RSQRT_NEWTON:
+            return vect ? vect_norm_rsqrt_newton_avx2 : norm_rsqrt_newton;
+        default:
+            return kernel_function(kernel);
+    }
+}
+
+simdnorm_ctx_t *simdnorm_create(unsigned int nb_thread) {
+    simdnorm_ctx_t *ctx = (simdnorm_ctx_t *) malloc(sizeof(simdnorm_ctx_t));
+    if (ctx == NULL)
+        return NULL;
+
+    ctx->pool = pool_create(nb_thread);
+    ctx->reducer = ctx->pool != NULL ? reducer_create(ctx->pool, REDUCE_TREE) : NULL;
+    if (ctx->reducer == NULL) {
+        if (ctx->pool != NULL)
+            pool_destroy(ctx->pool);
+        free(ctx);
+        return NULL;
+    }
+    ctx->kernel = kernel_current();
+    ctx->accuracy = ACCURACY_FAST;
+    ctx->fn = select_fn(ctx->kernel, ctx->accuracy);
+    ctx->stats = NULL;
+    ctx->stats_capacity = 0;
+
+    return ctx;
+}
+
+void simdnorm_destroy(simdnorm_ctx_t *ctx) {
+    reducer_destroy(ctx->reducer);
+    pool_destroy(ctx->pool);
+    free(ctx->stats);
+    free(ctx);
+}
+
+int simdnorm_set_kernel(simdnorm_ctx_t *ctx, int kernel) {
+    if (kernel < 0 || kernel >= KERNEL_COUNT)
+        kernel = KERNEL_COUNT - 1;
+
+    while (!kernel_supported(kernel))
+        kernel--;
+
+    ctx->kernel = kernel;
+    ctx->fn = select_fn(ctx->kernel, ctx->accuracy);
+
+    return kernel;
+}
+
+int simdnorm_set_accuracy(simdnorm_ctx_t *ctx, int accuracy) {
+    if (accuracy < 0 || accuracy >= ACCURACY_COUNT)
+        return -1;
+
+    ctx->accuracy = accuracy;
+    ctx->fn = select_fn(ctx->kernel, ctx->accuracy);
+
+    return accuracy;
+}
+
+int simdnorm_set_reduction(simdnorm_ctx_t *ctx, int reduction) {
+    if (reduction != REDUCE_LOCKFREE && reduction != REDUCE_TREE && reduction != REDUCE_JOIN && reduction != REDUCE_STEAL)
+        return -1;
+
+    ctx->reducer->mode = reduction;
+
+    return reduction;
+}
+
+unsigned int simdnorm_nb_thread(simdnorm_ctx_t *ctx) {
+    return ctx->pool->nb_thread;
+}
+
+threadpool_t *simdnorm_pool(simdnorm_ctx_t *ctx) {
+    return ctx->pool;
+}
+
+// The kernels never write in the array, they only take a float * for historical reasons
+
+float simdnorm_l1sqrt(simdnorm_ctx_t *ctx, const float *U, size_t N) {
+    return reduce_run(ctx->reducer, ctx->fn, (float *) U, N);
+}
+
+float simdnorm_l1sqrt_single(simdnorm_ctx_t *ctx, const float *U, size_t N) {
+    return ctx->fn((float *) U, N);
+}
+
+// Job descriptor of a batch, either an array of (ptr, len) or the rows of a matrix (ptrs NULL)
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    const float *const *ptrs;
+    const size_t *lens;
+    const float *M;
+    size_t cols;
+    size_t stride;
+    size_t count;
+    float *out;
+} batch_t;
+
+// The 8-rows kernels only exist for the fast accuracy mode
+static int batch_vect(simdnorm_ctx_t *ctx) {
+    return ctx->kernel >= KERNEL_AVX2 && ctx->accuracy == ACCURACY_FAST;
+}
+
+// Rows [first, last) of a batch on the calling thread
+static void batch_range(batch_t *batch, size_t first, size_t last) {
+    if (batch_vect(batch->ctx)) {
+        if (batch->ptrs != NULL)
+            vect_norm_batch_avx2(batch->ptrs + first, batch->lens + first, last - first, batch->out + first);
+        else
+            vect_norm_rows_avx2(batch->M + first * batch->stride, last - first, batch->cols, batch->stride,
+                                batch->out + first);
+        return;
+    }
+
+    for (size_t i = first; i < last; i++) {
+        if (batch->ptrs != NULL)
+            batch->out[i] = batch->ctx->fn((float *) batch->ptrs[i], batch->lens[i]);
+        else
+            batch->out[i] = batch->ctx->fn((float *) (batch->M + i * batch->stride), batch->cols);
+    }
+}
+
+// Each worker takes a contiguous block of rows, a multiple of 8 rows except for the last worker
+static void batch_job(batch_t *batch, unsigned int worker) {
+    unsigned int nb_thread = batch->ctx->pool->nb_thread;
+    size_t first = ((batch->count * worker) / nb_thread) & ~(size_t) 7;
+    size_t last = (worker == nb_thread - 1) ? batch->count : ((batch->count * (worker + 1)) / nb_thread) & ~(size_t) 7;
+
+    batch_range(batch, first, last);
+}
+
+void simdnorm_l1sqrt_batch(simdnorm_ctx_t *ctx, const float *const *ptrs, const size_t *lens, size_t count,
+                           float *out) {
+    // Less arrays than threads: each array is split over the threads instead
+    if (count < ctx->pool->nb_thread) {
+        for (size_t i = 0; i < count; i++)
+            out[i] = simdnorm_l1sqrt(ctx, ptrs[i], lens[i]);
+        return;
+    }
+
+    batch_t batch = {ctx, ptrs, lens, NULL, 0, 0, count, out};
+    pool_run(ctx->pool, (pool_job_t) batch_job, &batch);
+}
+
+void simdnorm_l1sqrt_rows(simdnorm_ctx_t *ctx, const float *M, size_t rows, size_t cols, size_t stride,
+                          float *out) {
+    if (rows < ctx->pool->nb_thread) {
+        for (size_t i = 0; i < rows; i++)
+            out[i] = simdnorm_l1sqrt(ctx, M + i * stride, cols);
+        return;
+    }
+
+    batch_t batch = {ctx, NULL, NULL, M, cols, stride, rows, out};
+    pool_run(ctx->pool, (pool_job_t) batch_job, &batch);
+}
+
+void simdnorm_l1sqrt_rows_single(simdnorm_ctx_t *ctx, const float *M, size_t rows, size_t cols, size_t stride,
+                                 float *out) {
+    batch_t batch = {ctx, NULL, NULL, M, cols, stride, rows, out};
+    batch_range(&batch, 0, rows);
+}
+
+float simdnorm_l1sqrt_f16(simdnorm_ctx_t *ctx, const uint16_t *U, size_t N) {
+    return reduce_run_half(ctx->reducer, ctx->kernel >= KERNEL_AVX2 ? vect_norm_f16 : norm_f16, U, N);
+}
+
+float simdnorm_l1sqrt_bf16(simdnorm_ctx_t *ctx, const uint16_t *U, size_t N) {
+    return reduce_run_half(ctx->reducer, ctx->kernel >= KERNEL_AVX2 ? vect_norm_bf16 : norm_bf16, U, N);
+}
+
+float simdnorm_reduce(simdnorm_ctx_t *ctx, int op, const float *U, const float *V, size_t N, float p) {
+    reduce_op_kernel_t kernel = op_kernel(op, ctx->kernel >= KERNEL_AVX2);
+    if (kernel == NULL)
+        return NAN;
+
+    return reduce_run_op(ctx->reducer, kernel, op_combine(op), U, op_binary(op) ? V : NULL, N, p);
+}
+
+float simdnorm_l1(simdnorm_ctx_t *ctx, const float *U, size_t N) {
+    return simdnorm_reduce(ctx, OP_L1, U, NULL, N, 0);
+}
+
+float simdnorm_l2(simdnorm_ctx_t *ctx, const float *U, size_t N) {
+    return sqrtf(simdnorm_reduce(ctx, OP_L2SQ, U, NULL, N, 0));
+}
+
+float simdnorm_linf(simdnorm_ctx_t *ctx, const float *U, size_t N) {
+    return simdnorm_reduce(ctx, OP_LINF, U, NULL, N, 0);
+}
+
+float simdnorm_lp(simdnorm_ctx_t *ctx, const float *U, size_t N, float p) {
+    if (!(p > 0))
+        return NAN;
+    if (isinf(p))
+        return simdnorm_linf(ctx, U, N);
+    if (p == 1)
+        return simdnorm_l1(ctx, U, N);
+    if (p == 2)
+        return simdnorm_l2(ctx, U, N);
+
+    return powf(simdnorm_reduce(ctx, OP_LP, U, NULL, N, p), 1.0f / p);
+}
+
+float simdnorm_dot(simdnorm_ctx_t *ctx, const float *U, const float *V, size_t N) {
+    return simdnorm_reduce(ctx, OP_DOT, U, V, N, 0);
+}
+
+// Job descriptor of the statistics, one stats_t per block of REDUCE_BLOCK floats
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    const float *U;
+    size_t N;
+    int mask;
+} stats_job_t;
+
+// Each worker takes a contiguous range of blocks, as the tree reduction
+static void stats_job(stats_job_t *job, unsigned int worker) {
+    unsigned int nb_thread = job->ctx->pool->nb_thread;
+    size_t nb_blocks = (job->N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    int vect = job->ctx->kernel >= KERNEL_AVX2;
+
+    size_t first = (nb_blocks * worker) / nb_thread;
+    size_t last = (nb_blocks * (worker + 1)) / nb_thread;
+
+    for (size_t b = first; b < last; b++) {
+        size_t begin = b * REDUCE_BLOCK;
+        size_t size = (job->N - begin < REDUCE_BLOCK) ? job->N - begin : REDUCE_BLOCK;
+        stats_kernel(job->U + begin, size, job->mask, vect, &job->ctx->stats[b]);
+    }
+}
+
+void simdnorm_stats(simdnorm_ctx_t *ctx, const float *U, size_t N, int mask, stats_t *out) {
+    size_t nb_blocks = (N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+
+    if (nb_blocks > ctx->stats_capacity) {
+        free(ctx->stats);
+        ctx->stats = (stats_t *) malloc(sizeof(stats_t) * nb_blocks);
+        ctx->stats_capacity = nb_blocks;
+    }
+
+    stats_job_t job = {ctx, U, N, mask};
+    pool_run(ctx->pool, (pool_job_t) stats_job, &job);
+
+    // Same pairwise tree as tree_sum in reduce.c
+    stats_init(out);
+    if (nb_blocks > 0) {
+        for (size_t stride = 1; stride < nb_blocks; stride *= 2)
+            for (size_t i = 0; i + stride < nb_blocks; i += 2 * stride)
+                stats_merge(&ctx->stats[i], &ctx->stats[i + stride]);
+
+        *out = ctx->stats[0];
+    }
+
+    stats_select(out, mask);
+}
+
+void simdnorm_stats_single(simdnorm_ctx_t *ctx, const float *U, size_t N, int mask, stats_t *out) {
+    stats_kernel(U, N, mask, ctx->kernel >= KERNEL_AVX2, out);
+    stats_select(out, mask);
+}
+
+// Job descriptor of the generation of an array
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    float *U;
+    size_t N;
+    int dist;
+    float a;
+    float b;
+    unsigned long long seed;
+} generate_t;
+
+// Same slices as the join reduction: the pages of a slice are written by the thread which reads them in normPar
+static void generate_job(generate_t *job, unsigned int worker) {
+    size_t begin, size;
+    reduce_slice(job->N, job->ctx->pool->nb_thread, worker, &begin, &size);
+
+    prng_fill(job->U + begin, size, job->dist, job->a, job->b, job->seed, begin, job->ctx->kernel >= KERNEL_AVX2);
+}
+
+void simdnorm_generate(simdnorm_ctx_t *ctx, float *U, size_t N, int dist, float a, float b, unsigned long long seed) {
+    generate_t job = {ctx, U, N, dist, a, b, seed};
+    pool_run(ctx->pool, (pool_job_t) generate_job, &job);
+}
@@ -0,0 +1,119 @@
+#ifndef SIMDNORM_H
+#define SIMDNORM_H
+
+#include <stddef.h>
+
+#include "accurate.h"
+#include "half.h"
+#include "kernels.h"
+#include "ops.h"
+#include "prng.h"
+#include "reduce.h"
+#include "stats.h"
+#include "threadpool.h"
+
+// libsimdnorm: sum of sqrt(|x|) over float arrays ("l1sqrt"), vectorized and multithreaded
+//
+// Everything goes through a context, which holds the thread pool, the kernel and the accuracy mode
+// A context is not thread-safe: use one per calling thread (or protect it)
+
+typedef struct {
+    threadpool_t *pool;
+    reducer_t *reducer;
+
+    // KERNEL_* of kernels.h
+    int kernel;
+    // ACCURACY_* of accurate.h
+    int accuracy;
+
+    // Function applied on each slice, depends on the kernel and on the accuracy mode
+    kernel_fn_t fn;
+
+    // Statistics of each block for simdnorm_stats, only grows
+    stats_t *stats;
+    size_t stats_capacity;
+} simdnorm_ctx_t;
+
+// Start a context with nb_thread threads (the calling thread included), the kernel selected at startup
+// (best one supported, or SIMDNORM_KERNEL), ACCURACY_FAST and the deterministic tree reduction
+// NULL if the threads could not be started (or out of memory)
+simdnorm_ctx_t *simdnorm_create(unsigned int nb_thread);
+
+// Stop the threads and free the context
+void simdnorm_destroy(simdnorm_ctx_t *ctx);
+
+// Use the given kernel, returns the one actually used (the best supported one below it)
+int simdnorm_set_kernel(simdnorm_ctx_t *ctx, int kernel);
+
+// Use the given accuracy mode (ACCURACY_*), returns it, -1 if unknown
+int simdnorm_set_accuracy(simdnorm_ctx_t *ctx, int accuracy);
+
+// Use the given reduction over the threads (REDUCE_LOCKFREE, REDUCE_TREE, REDUCE_JOIN or REDUCE_STEAL)
+// Returns it, -1 if unknown
+int simdnorm_set_reduction(simdnorm_ctx_t *ctx, int reduction);
+
+unsigned int simdnorm_nb_thread(simdnorm_ctx_t *ctx);
+
+// Pool of the context, for the benchmarks which want to run their own jobs on the same threads
+threadpool_t *simdnorm_pool(simdnorm_ctx_t *ctx);
+
+// Sum of sqrt(|U[i]|) for i < N, U can have any alignment and N any value
+float simdnorm_l1sqrt(simdnorm_ctx_t *ctx, const float *U, size_t N);
+
+// Same on one thread of the context only (the calling one)
+float simdnorm_l1sqrt_single(simdnorm_ctx_t *ctx, const float *U, size_t N);
+
+// Batch: out[i] = l1sqrt of the array ptrs[i] of lens[i] floats, for i < count
+// The arrays are shared out between the threads by blocks of rows, for short arrays (embeddings...)
+// In the fast mode with AVX2 the horizontal sums of 8 rows are done together
+void simdnorm_l1sqrt_batch(simdnorm_ctx_t *ctx, const float *const *ptrs, const size_t *lens, size_t count,
+                           float *out);
+
+// Same on the rows of a row-major matrix: out[r] = l1sqrt of the cols floats starting at M + r*stride
+// The 8 rows of a block are read in lockstep in the fast mode with AVX2
+void simdnorm_l1sqrt_rows(simdnorm_ctx_t *ctx, const float *M, size_t rows, size_t cols, size_t stride,
+                          float *out);
+
+// Same on the calling thread only
+void simdnorm_l1sqrt_rows_single(simdnorm_ctx_t *ctx, const float *M, size_t rows, size_t cols, size_t stride,
+                                 float *out);
+
+// l1sqrt of fp16 / bf16 arrays (uint16_t elements, see half.h), widened in the registers, on the threads of the context
+// Vectorized if the kernel of the context is at least AVX2, always with the fast accuracy mode
+float simdnorm_l1sqrt_f16(simdnorm_ctx_t *ctx, const uint16_t *U, size_t N);
+float simdnorm_l1sqrt_bf16(simdnorm_ctx_t *ctx, const uint16_t *U, size_t N);
+
+// Generic reductions (OP_* of ops.h) on the threads of the context, with the AVX2 kernels if the kernel of the
+// context is at least AVX2. The accuracy mode only applies to l1sqrt, these ones always accumulate in float
+// V is only read by OP_DOT, p only by OP_LP. Returns the raw sum (or max), without the final root
+float simdnorm_reduce(simdnorm_ctx_t *ctx, int op, const float *U, const float *V, size_t N, float p);
+
+// Sum of |U[i]|
+float simdnorm_l1(simdnorm_ctx_t *ctx, const float *U, size_t N);
+
+// sqrt of the sum of U[i]^2
+float simdnorm_l2(simdnorm_ctx_t *ctx, const float *U, size_t N);
+
+// Max of |U[i]|
+float simdnorm_linf(simdnorm_ctx_t *ctx, const float *U, size_t N);
+
+// (sum of |U[i]|^p)^(1/p), p > 0 (INFINITY gives the max norm)
+float simdnorm_lp(simdnorm_ctx_t *ctx, const float *U, size_t N, float p);
+
+// Sum of U[i] * V[i]
+float simdnorm_dot(simdnorm_ctx_t *ctx, const float *U, const float *V, size_t N);
+
+// Statistics of U asked for in mask (STAT_* of stats.h) in a single read, on the threads of the context
+// Same blocks and same pairwise tree as REDUCE_TREE, so the result does not depend on the number of threads
+// AVX2 kernel if the kernel of the context is at least AVX2, always accumulated in float
+void simdnorm_stats(simdnorm_ctx_t *ctx, const float *U, size_t N, int mask, stats_t *out);
+
+// Same on the calling thread only
+void simdnorm_stats_single(simdnorm_ctx_t *ctx, const float *U, size_t N, int mask, stats_t *out);
+
+// Fill U[0, N) with the distribution dist (PRNG_* of prng.h) on the threads of the context, each one its slice
+// The values only depend on seed (counter-based generator): the same array whatever the number of threads
+// AVX2 kernel if the kernel of the context is at least AVX2 (same values as the scalar one)
+void simdnorm_generate(simdnorm_ctx_t *ctx, float *U, size_t N, int dist, float a, float b, unsigned long long seed);
+
+#endif //SIMDNORM_H
@@ -0,0 +1,182 @@
+#include <stdint.h>
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "kernels.h"
+#include "stats.h"
+
+void stats_init(stats_t *s) {
+    s->norm = 0;
+    s->sum = 0;
+    s->min = INFINITY;
+    s->max = -INFINITY;
+    s->nan = 0;
+    s->inf = 0;
+}
+
+void stats_merge(stats_t *a, const stats_t *b) {
+    a->norm += b->norm;
+    a->sum += b->sum;
+    if (b->min < a->min)
+        a->min = b->min;
+    if (b->max > a->max)
+        a->max = b->max;
+    a->nan += b->nan;
+    a->inf += b->inf;
+}
+
+void stats_select(stats_t *s, int mask) {
+    if (!(mask & STAT_NORM))
+        s->norm = 0;
+    if (!(mask & STAT_SUM))
+        s->sum = 0;
+    if (!(mask & STAT_MIN))
+        s->min = 0;
+    if (!(mask & STAT_MAX))
+        s->max = 0;
+    if (!(mask & STAT_NAN))
+        s->nan = 0;
+    if (!(mask & STAT_INF))
+        s->inf = 0;
+}
+
+// Scalar version, the branches on mask are the same for the whole array
+// (x < min is false for a NaN, so NaN are ignored by min and max)
+__attribute__((optimize("no-tree-vectorize")))
+static void stats_scalar(const float *U, size_t N, int mask, stats_t *out) {
+    stats_t s;
+    stats_init(&s);
+
+    for (size_t i = 0; i < N; i++) {
+        float x = U[i];
+
+        if (mask & STAT_NORM)
+            s.norm += sqrtf(fabsf(x));
+        if (mask & STAT_SUM)
+            s.sum += x;
+        if ((mask & STAT_MIN) && x < s.min)
+            s.min = x;
+        if ((mask & STAT_MAX) && x > s.max)
+            s.max = x;
+        if ((mask & STAT_NAN) && isnan(x))
+            s.nan++;
+        if ((mask & STAT_INF) && isinf(x))
+            s.inf++;
+    }
+
+    *out = s;
+}
+
+// =============================================================== \\
+// AVX2 version: 16 floats per iteration, 2 accumulators per statistic (12 registers when all of them are asked for)
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+// Body of every AVX2 kernel: always inlined with a constant mask, the statistics not asked for are removed
+// by the compiler along with their accumulators
+__attribute__((always_inline))
+static inline void stats_body(const float *U, size_t N, int mask, stats_t *out) {
+    __m256 sign_mask = _mm256_set1_ps(-0.f);
+    __m256 inf = _mm256_set1_ps(INFINITY);
+
+    __m256 norm0 = _mm256_setzero_ps(), norm1 = _mm256_setzero_ps();
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    __m256 min0 = inf, min1 = inf;
+    __m256 max0 = _mm256_set1_ps(-INFINITY), max1 = _mm256_set1_ps(-INFINITY);
+    __m256i nan0 = _mm256_setzero_si256(), nan1 = _mm256_setzero_si256();
+    __m256i inf0 = _mm256_setzero_si256(), inf1 = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 16 <= N; i += 16) {
+        _mm_prefetch((const char *) (U + i + PREFETCH_DISTANCE), _MM_HINT_T0);
+        __m256 x0 = _mm256_loadu_ps(U + i);
+        __m256 x1 = _mm256_loadu_ps(U + i + 8);
+
+        if (mask & STAT_NORM) {
+            norm0 = _mm256_add_ps(norm0, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, x0)));
+            norm1 = _mm256_add_ps(norm1, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, x1)));
+        }
+        if (mask & STAT_SUM) {
+            sum0 = _mm256_add_ps(sum0, x0);
+            sum1 = _mm256_add_ps(sum1, x1);
+        }
+        // min_ps / max_ps return their second operand when one of them is NaN: the accumulator is kept
+        if (mask & STAT_MIN) {
+            min0 = _mm256_min_ps(x0, min0);
+            min1 = _mm256_min_ps(x1, min1);
+        }
+        if (mask & STAT_MAX) {
+            max0 = _mm256_max_ps(x0, max0);
+            max1 = _mm256_max_ps(x1, max1);
+        }
+        // A true comparison is -1 in each lane
+        if (mask & STAT_NAN) {
+            nan0 = _mm256_sub_epi32(nan0, _mm256_castps_si256(_mm256_cmp_ps(x0, x0, _CMP_UNORD_Q)));
+            nan1 = _mm256_sub_epi32(nan1, _mm256_castps_si256(_mm256_cmp_ps(x1, x1, _CMP_UNORD_Q)));
+        }
+        if (mask & STAT_INF) {
+            inf0 = _mm256_sub_epi32(inf0, _mm256_castps_si256(
+                    _mm256_cmp_ps(_mm256_andnot_ps(sign_mask, x0), inf, _CMP_EQ_OQ)));
+            inf1 = _mm256_sub_epi32(inf1, _mm256_castps_si256(
+                    _mm256_cmp_ps(_mm256_andnot_ps(sign_mask, x1), inf, _CMP_EQ_OQ)));
+        }
+    }
+
+    norm0 = _mm256_add_ps(norm0, norm1);
+    sum0 = _mm256_add_ps(sum0, sum1);
+    min0 = _mm256_min_ps(min0, min1);
+    max0 = _mm256_max_ps(max0, max1);
+    nan0 = _mm256_add_epi32(nan0, nan1);
+    inf0 = _mm256_add_epi32(inf0, inf1);
+
+    float *norm_fptr = (float *) &norm0, *sum_fptr = (float *) &sum0;
+    float *min_fptr = (float *) &min0, *max_fptr = (float *) &max0;
+    uint32_t *nan_ptr = (uint32_t *) &nan0, *inf_ptr = (uint32_t *) &inf0;
+
+    stats_t s;
+    stats_init(&s);
+    for (unsigned int k = 0; k < 8; k++) {
+        s.norm += norm_fptr[k];
+        s.sum += sum_fptr[k];
+        if (min_fptr[k] < s.min)
+            s.min = min_fptr[k];
+        if (max_fptr[k] > s.max)
+            s.max = max_fptr[k];
+        s.nan += nan_ptr[k];
+        s.inf += inf_ptr[k];
+    }
+
+    // Tail: less than 16 floats left
+    if (i < N) {
+        stats_t tail;
+        stats_scalar(U + i, N - i, mask, &tail);
+        stats_merge(&s, &tail);
+    }
+
+    *out = s;
+}
+
+#define STATS_CASE(m) case (m): stats_body(U, N, (m), out); break;
+#define STATS_CASE4(m) STATS_CASE(m) STATS_CASE((m) + 1) STATS_CASE((m) + 2) STATS_CASE((m) + 3)
+#define STATS_CASE16(m) STATS_CASE4(m) STATS_CASE4((m) + 4) STATS_CASE4((m) + 8) STATS_CASE4((m) + 12)
+
+// One specialized loop per mask
+static void stats_avx2(const float *U, size_t N, int mask, stats_t *out) {
+    switch (mask & STAT_ALL) {
+        STATS_CASE16(0)
+        STATS_CASE16(16)
+        STATS_CASE16(32)
+        STATS_CASE16(48)
+    }
+}
+
+#pragma GCC pop_options
+
+void stats_kernel(const float *U, size_t N, int mask, int vect, stats_t *out) {
+    if (vect && __builtin_cpu_supports("avx2"))
+        stats_avx2(U, N, mask, out);
+    else
+        stats_scalar(U, N, mask, out);
+}
@@ -0,0 +1,40 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+
+// Several statistics of an array in a single read: each vector is loaded once and updates every accumulator asked for
+#define STAT_NORM 1    // sum of sqrt(|x|), as vect_norm
+#define STAT_SUM 2     // sum of x
+#define STAT_MIN 4     // min of x, NaN ignored
+#define STAT_MAX 8     // max of x, NaN ignored
+#define STAT_NAN 16    // number of NaN
+#define STAT_INF 32    // number of +-Inf
+#define STAT_ALL 63
+
+// The norm and the sum are NaN as soon as one element is, min / max are +Inf / -Inf when there is no number at all
+// The fields which were not asked for are 0
+typedef struct {
+    float norm;
+    float sum;
+    float min;
+    float max;
+    unsigned long long nan;
+    unsigned long long inf;
+} stats_t;
+
+// Statistics of U[0, N) on the calling thread, the AVX2 kernel if vect is set and the CPU supports it
+// The kernel is specialized for each of the 64 masks, so the statistics not asked for cost nothing
+// The counts are accumulated on 32 bits in the AVX2 kernel: N < 2^34
+void stats_kernel(const float *U, size_t N, int mask, int vect, stats_t *out);
+
+// a = statistics of the concatenation of a and b
+void stats_merge(stats_t *a, const stats_t *b);
+
+// Neutral element of stats_merge
+void stats_init(stats_t *s);
+
+// Zero the fields not in mask
+void stats_select(stats_t *s, int mask);
+
+#endif //STATS_H
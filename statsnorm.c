@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <math.h>
+#include <time.h>
+
+#include "harness.h"
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+typedef struct {
+    simdnorm_ctx_t *ctx;
+    float *U;
+    size_t N;
+    // 0 for simdnorm_l1sqrt, a STAT_* mask otherwise
+    int mask;
+    stats_t result;
+} call_t;
+
+void call(call_t *c) {
+    if (c->mask == 0)
+        c->result.norm = simdnorm_l1sqrt(c->ctx, c->U, c->N);
+    else
+        simdnorm_stats(c->ctx, c->U, c->N, c->mask, &c->result);
+}
+
+double measure(call_t *c, int mask) {
+    harness_config_t config = {2, 30, 5, 2.0, NULL, 0};
+    harness_result_t r;
+
+    c->mask = mask;
+    harness_measure((harness_fn_t) call, c, &config, &r);
+
+    return r.seconds.median;
+}
+
+// Double reference of U with a few NaN and Inf, compared to the fused pass: 1 if they agree
+int check(simdnorm_ctx_t *ctx, size_t N) {
+    // Zeroed: every float is written below, but gcc cannot see it
+    float *U = (float *) calloc(N > 0 ? N : 1, sizeof(float));
+    if (U == NULL) {
+        printf("Could not allocate %zu floats\n", N);
+        exit(1);
+    }
+    for (size_t i = 0; i < N; i++)
+        U[i] = 2.0f * ((float) rand() / (float) (RAND_MAX)) - 1.0f;
+
+    // NaN and Inf everywhere in the array: heads, tails, middle of the blocks
+    for (size_t i = 3; i < N; i += 997) {
+        U[i] = NAN;
+        if (i + 5 < N)
+            U[i + 5] = (i & 1) ? INFINITY : -INFINITY;
+    }
+
+    double norm = 0, sum = 0;
+    float min = INFINITY, max = -INFINITY;
+    unsigned long long nan = 0, inf = 0;
+    for (size_t i = 0; i < N; i++) {
+        if (isnan(U[i])) {
+            nan++;
+            continue;
+        }
+        if (U[i] < min)
+            min = U[i];
+        if (U[i] > max)
+            max = U[i];
+        if (isinf(U[i])) {
+            inf++;
+            continue;
+        }
+        norm += sqrt(fabs((double) U[i]));
+        sum += U[i];
+    }
+
+    // norm and sum are NaN with NaN in the array: checked once the NaN and Inf are replaced by 0
+    int ok = 1;
+    stats_t s;
+    simdnorm_stats(ctx, U, N, STAT_MIN | STAT_MAX | STAT_NAN | STAT_INF, &s);
+    ok &= s.min == min && s.max == max && s.nan == nan && s.inf == inf && s.norm == 0 && s.sum == 0;
+
+    simdnorm_stats(ctx, U, N, STAT_ALL, &s);
+    ok &= (nan == 0 || (isnan(s.norm) && isnan(s.sum))) && s.min == min && s.max == max && s.nan == nan && s.inf == inf;
+
+    for (size_t i = 0; i < N; i++)
+        if (isnan(U[i]) || isinf(U[i]))
+            U[i] = 0;
+
+    simdnorm_stats(ctx, U, N, STAT_ALL, &s);
+    ok &= fabs((double) s.norm - norm) <= 1E-5 * norm && fabs((double) s.sum - sum) <= 1E-5 * norm;
+    ok &= s.nan == 0 && s.inf == 0;
+
+    free(U);
+
+    return ok;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    // Get number of elements, in DRAM by default (512 MB of floats)
+    size_t N = argc > 1 ? (size_t) strtoull(argv[1], NULL, 10) : (size_t) 1 << 27;
+
+    // Get number of threads
+    unsigned int nb_thread = argc > 2 ? (unsigned int) atoi(argv[2]) : 2;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    int ok = 1;
+    const size_t check_sizes[3] = {1, 4099, 1000003};
+    for (int k = 0; k < 3; k++)
+        ok &= check(ctx, check_sizes[k]);
+
+    call_t c = {ctx, (float *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(float) * N + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE)),
+                N, 0, {0}};
+
+    for (size_t i = 0; i < N; i++)
+        c.U[i] = 2.0f * ((float) rand() / (float) (RAND_MAX)) - 1.0f;
+
+    printf("N = %zu, %u threads, kernel %s, NaN / Inf check %s\n", N, nb_thread, kernel_name(kernel_current()),
+           ok ? "OK" : "FAILED");
+
+    double t_norm = measure(&c, 0);
+    printf("simdnorm_l1sqrt: %e s, %0.2f GB/s\n", t_norm, (double) N * sizeof(float) / t_norm * 1E-9);
+
+    // One pass per statistic
+    const int singles[6] = {STAT_NORM, STAT_SUM, STAT_MIN, STAT_MAX, STAT_NAN, STAT_INF};
+    const char *names[6] = {"norm", "sum", "min", "max", "nan", "inf"};
+    double t_single[6];
+    printf("statistic, separate pass s, GB/s\n");
+    for (int k = 0; k < 6; k++) {
+        t_single[k] = measure(&c, singles[k]);
+        printf("%s, %e, %0.2f\n", names[k], t_single[k], (double) N * sizeof(float) / t_single[k] * 1E-9);
+    }
+
+    // The first k statistics fused, against k separate passes
+    printf("statistics, fused s, separate passes s, speedup, fused / one pass\n");
+    double t_separate = 0;
+    for (int k = 0; k < 6; k++) {
+        t_separate += t_single[k];
+        double t_fused = measure(&c, (1 << (k + 1)) - 1);
+        printf("%d, %e, %e, x%0.2f, x%0.2f\n", k + 1, t_fused, t_separate, t_separate / t_fused,
+               t_fused / t_single[0]);
+    }
+
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(c.U);
+
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <time.h>
+
+#include "simdnorm.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+
+struct timespec diff(struct timespec start, struct timespec end)
+{
+    struct timespec temp;
+
+    if (end.tv_nsec-start.tv_nsec<0)
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec-1;
+        temp.tv_nsec = 1000000000+end.tv_nsec-start.tv_nsec;
+    }
+    else
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec;
+        temp.tv_nsec = end.tv_nsec-start.tv_nsec;
+    }
+    return temp;
+}
+
+// k-th CPU the process can run on (modulo their number), -1 if unknown
+int nth_cpu(unsigned int k) {
+    cpu_set_t cpus;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &cpus) != 0 || CPU_COUNT(&cpus) == 0)
+        return -1;
+
+    unsigned int target = k % (unsigned int) CPU_COUNT(&cpus);
+    for (int i = 0; i < CPU_SETSIZE; i++)
+        if (CPU_ISSET(i, &cpus) && target-- == 0)
+            return i;
+
+    return -1;
+}
+
+void pin_self(int cpu) {
+    if (cpu < 0)
+        return;
+
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &one);
+}
+
+// Worker w on the w-th CPU, so the noise lands on a known worker
+void pin_job(void *args, unsigned int worker) {
+    (void) args;
+    pin_self(nth_cpu(worker));
+}
+
+// Background load: a thread spinning on the CPU of the last worker (the noisy neighbour)
+atomic_int noise_stop;
+
+void *noise_thread(void *args) {
+    pin_self(*(int *) args);
+
+    volatile double x = 1;
+    while (!atomic_load_explicit(&noise_stop, memory_order_relaxed))
+        x = x * 1.0000001 + 1E-9;
+
+    return NULL;
+}
+
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Latencies of calls calls in the given reduction mode, sorted, in seconds
+void time_calls(simdnorm_ctx_t *ctx, int mode, float *U, size_t N, unsigned int calls, double *latencies,
+                unsigned long *steals) {
+    simdnorm_set_reduction(ctx, mode);
+    *steals = 0;
+
+    for (unsigned int c = 0; c < calls; c++) {
+        struct timespec begining, end;
+        clock_gettime(CLOCK_MONOTONIC, &begining);
+
+        volatile float r = simdnorm_l1sqrt(ctx, U, N);
+        (void) r;
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        struct timespec t = diff(begining, end);
+        latencies[c] = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+        *steals += atomic_load(&ctx->reducer->steals);
+    }
+
+    qsort(latencies, calls, sizeof(double), compare_double);
+}
+
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        printf("Usage: %s nb_elts nb_threads [calls]\n", argv[0]);
+        exit(1);
+    }
+
+    // Get number of elements
+    size_t N = (size_t) strtoull(argv[1], NULL, 10);
+
+    // Get number of threads
+    unsigned int nb_thread = (unsigned int) atoi(argv[2]);
+
+    // Number of timed calls per mode
+    unsigned int calls = argc > 3 ? (unsigned int) atoi(argv[3]) : 200;
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+    pool_run(simdnorm_pool(ctx), pin_job, NULL);
+
+    // init random seed
+    srand((unsigned int) time(NULL));
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * N);
+    for (size_t i = 0; i < N; i++)
+        U[i] = ((float) rand() / (float) (RAND_MAX));
+
+    double *latencies = (double *) malloc(sizeof(double) * calls);
+
+    const int modes[3] = {REDUCE_JOIN, REDUCE_TREE, REDUCE_STEAL};
+    const char *names[3] = {"static slices", "static blocks", "work stealing"};
+
+    int noise_cpu = nth_cpu(nb_thread - 1);
+    printf("N = %zu, %u threads, %u calls, noise on cpu %d\n", N, nb_thread, calls, noise_cpu);
+    printf("load, mode, min, median, p99, max, steals per call\n");
+
+    for (int noise = 0; noise < 2; noise++) {
+        pthread_t noisy;
+        if (noise) {
+            atomic_store(&noise_stop, 0);
+            pthread_create(&noisy, NULL, noise_thread, &noise_cpu);
+        }
+
+        for (int m = 0; m < 3; m++) {
+            unsigned long steals;
+            time_calls(ctx, modes[m], U, N, calls, latencies, &steals);
+
+            printf("%s, %s, %e, %e, %e, %e, %0.1f\n", noise ? "noise" : "idle", names[m], latencies[0],
+                   latencies[calls / 2], latencies[(size_t) ((calls - 1) * 0.99)], latencies[calls - 1],
+                   (double) steals / calls);
+        }
+
+        if (noise) {
+            atomic_store(&noise_stop, 1);
+            pthread_join(noisy, NULL);
+        }
+    }
+
+    simdnorm_destroy(ctx);
+
+    // free our memory
+    free(U);
+    free(latencies);
+
+
+    return 0;
+}
@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stream.h"
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (double) t.tv_sec + (double) t.tv_nsec * 1E-9;
+}
+
+// Chunk size rounded to the alignment (and at least one aligned block)
+static size_t aligned_chunk(size_t chunk) {
+    chunk = chunk & ~(size_t) (STREAM_ALIGN - 1);
+
+    return chunk == 0 ? STREAM_ALIGN : chunk;
+}
+
+void stream_evict(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    // Dirty pages cannot be dropped, we flush them first
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// =============================================================== \\
+// mmap
+
+float stream_norm_mmap(const char *path, simdnorm_ctx_t *ctx, size_t chunk, stream_stats_t *stats) {
+    chunk = aligned_chunk(chunk);
+    memset(stats, 0, sizeof(stream_stats_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NAN;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NAN;
+    }
+
+    // Nothing to map (mmap of 0 bytes fails): no float in the file, its norm is 0 as with pread
+    if (st.st_size < (off_t) sizeof(float)) {
+        close(fd);
+        return 0;
+    }
+
+    size_t size = (size_t) st.st_size;
+    size_t N = size / sizeof(float);
+
+    double begining = now();
+
+    float *U = (float *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (U == MAP_FAILED)
+        return NAN;
+
+    // Hints only: they can fail (no THP for the page cache on most file systems), this is not an error
+    madvise(U, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(U, size, MADV_HUGEPAGE);
+#endif
+
+    size_t elt_per_chunk = chunk / sizeof(float);
+
+    // We add the chunks in double: there can be many of them
+    double result = 0;
+
+    // Read-ahead window of one chunk: the kernel starts reading chunk k+1 while the pool reduces chunk k
+    madvise(U, chunk < size ? chunk : size, MADV_WILLNEED);
+
+    for (size_t begin = 0; begin < N; begin += elt_per_chunk) {
+        size_t n = N - begin < elt_per_chunk ? N - begin : elt_per_chunk;
+        size_t next = (begin + n) * sizeof(float);
+
+        if (next < size)
+            madvise((char *) U + next, size - next < chunk ? size - next : chunk, MADV_WILLNEED);
+
+        result += simdnorm_l1sqrt(ctx, U + begin, n);
+
+        // What has been reduced will not be read again
+        madvise((char *) U + begin * sizeof(float), n * sizeof(float), MADV_DONTNEED);
+    }
+
+    munmap(U, size);
+
+    stats->bytes = N * sizeof(float);
+    stats->seconds = now() - begining;
+
+    return (float) result;
+}
+
+// =============================================================== \\
+// pread, double buffering
+
+// Buffers shared by the reader thread and the computing one
+typedef struct {
+    int fd;
+    // Opened with O_DIRECT
+    int direct;
+    size_t chunk;
+
+    float *buffers[2];
+    // Number of bytes in each buffer, only the last one is short (end of file or error)
+    size_t filled[2];
+    int full[2];
+    // Set by the reader if a read failed
+    int error;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} doublebuffer_t;
+
+static void *reader_routine(doublebuffer_t *db) {
+    off_t offset = 0;
+
+    for (unsigned long k = 0; ; k++) {
+        int b = (int) (k & 1);
+
+        // Wait until the computing thread has released this buffer
+        pthread_mutex_lock(&db->lock);
+        while (db->full[b])
+            pthread_cond_wait(&db->changed, &db->lock);
+        pthread_mutex_unlock(&db->lock);
+
+        // Fill it, pread can return less than asked for: only an empty read is the end of the file
+        size_t got = 0;
+        int error = 0;
+        while (got < db->chunk) {
+            ssize_t r = pread(db->fd, (char *) db->buffers[b] + got, db->chunk - got, offset + (off_t) got);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r < 0) {
+                error = 1;
+                break;
+            }
+            if (r == 0)
+                break;
+            got += (size_t) r;
+
+            // With O_DIRECT the next offset would not be aligned anymore (EINVAL): a short read which is not a
+            // multiple of the alignment has to be the end of the file, anything else is an error
+            if (db->direct && got % STREAM_ALIGN != 0) {
+                struct stat st;
+                if (fstat(db->fd, &st) != 0 || offset + (off_t) got != st.st_size)
+                    error = 1;
+                break;
+            }
+        }
+        offset += (off_t) got;
+
+        pthread_mutex_lock(&db->lock);
+        db->filled[b] = got;
+        db->full[b] = 1;
+        db->error |= error;
+        pthread_cond_broadcast(&db->changed);
+        pthread_mutex_unlock(&db->lock);
+
+        if (got < db->chunk || error)
+            break;
+    }
+
+    return NULL;
+}
+
+// Open the file, with O_DIRECT if asked for and supported
+static int open_file(const char *path, int direct, stream_stats_t *stats) {
+    int fd = -1;
+
+    if (direct) {
+        fd = open(path, O_RDONLY | O_DIRECT);
+        if (fd < 0 && errno == EINVAL)
+            stats->direct_fallback = 1;
+    }
+
+    if (fd < 0)
+        fd = open(path, O_RDONLY);
+
+    if (fd >= 0)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    return fd;
+}
+
+float stream_norm_pread(const char *path, simdnorm_ctx_t *ctx, size_t chunk, int direct, stream_stats_t *stats) {
+    chunk = aligned_chunk(chunk);
+    memset(stats, 0, sizeof(stream_stats_t));
+
+    doublebuffer_t db;
+    memset(&db, 0, sizeof(db));
+
+    db.fd = open_file(path, direct, stats);
+    if (db.fd < 0)
+        return NAN;
+
+    db.direct = (fcntl(db.fd, F_GETFL) & O_DIRECT) != 0;
+    db.chunk = chunk;
+    db.buffers[0] = (float *) aligned_alloc(STREAM_ALIGN, chunk);
+    db.buffers[1] = (float *) aligned_alloc(STREAM_ALIGN, chunk);
+    pthread_mutex_init(&db.lock, NULL);
+    pthread_cond_init(&db.changed, NULL);
+
+    double begining = now();
+
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, (void *(*)(void *)) reader_routine, &db) != 0) {
+        close(db.fd);
+        free(db.buffers[0]);
+        free(db.buffers[1]);
+        return NAN;
+    }
+
+    double result = 0;
+    size_t bytes = 0;
+
+    // The bytes of a float split between two chunks cannot happen: the chunks are multiples of 4 bytes
+    for (unsigned long k = 0; ; k++) {
+        int b = (int) (k & 1);
+
+        pthread_mutex_lock(&db.lock);
+        while (!db.full[b])
+            pthread_cond_wait(&db.changed, &db.lock);
+        size_t filled = db.filled[b];
+        pthread_mutex_unlock(&db.lock);
+
+        size_t n = filled / sizeof(float);
+        if (n > 0)
+            result += simdnorm_l1sqrt(ctx, db.buffers[b], n);
+        bytes += n * sizeof(float);
+
+        // Give the buffer back to the reader
+        pthread_mutex_lock(&db.lock);
+        db.full[b] = 0;
+        pthread_cond_broadcast(&db.changed);
+        pthread_mutex_unlock(&db.lock);
+
+        // A short (or empty) buffer is the last one
+        if (filled < chunk)
+            break;
+    }
+
+    pthread_join(reader, NULL);
+
+    stats->bytes = bytes;
+    stats->seconds = now() - begining;
+
+    int error = db.error;
+
+    close(db.fd);
+    free(db.buffers[0]);
+    free(db.buffers[1]);
+    pthread_mutex_destroy(&db.lock);
+    pthread_cond_destroy(&db.changed);
+
+    return error ? NAN : (float) result;
+}
+
+int stream_read_only(const char *path, size_t chunk, int direct, stream_stats_t *stats) {
+    chunk = aligned_chunk(chunk);
+    memset(stats, 0, sizeof(stream_stats_t));
+
+    int fd = open_file(path, direct, stats);
+    if (fd < 0)
+        return -1;
+
+    void *buffer = aligned_alloc(STREAM_ALIGN, chunk);
+    double begining = now();
+    size_t bytes = 0;
+    int error = 0;
+
+    for (;;) {
+        ssize_t r = read(fd, buffer, chunk);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            error = 1;
+        if (r <= 0)
+            break;
+        bytes += (size_t) r;
+    }
+
+    stats->bytes = bytes;
+    stats->seconds = now() - begining;
+
+    free(buffer);
+    close(fd);
+
+    return error ? -1 : 0;
+}
@@ -0,0 +1,41 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+
+#include "simdnorm.h"
+
+// Default size of the chunks given to the reduction engine, multiple of the page size (and of the O_DIRECT alignment)
+#ifndef STREAM_CHUNK
+#define STREAM_CHUNK (64ul << 20)
+#endif
+
+// Alignment of the buffers / offsets / sizes for O_DIRECT
+#define STREAM_ALIGN 4096
+
+// What a streaming run did
+typedef struct {
+    // Bytes of floats read (the trailing bytes of a file whose size is not a multiple of 4 are ignored)
+    size_t bytes;
+    double seconds;
+    // 1 if O_DIRECT was asked for but not supported by the file system (the run fell back to buffered reads)
+    int direct_fallback;
+} stream_stats_t;
+
+// Norm of a file of float32 through mmap: MADV_SEQUENTIAL (and MADV_HUGEPAGE when available) on the mapping,
+// chunk by chunk through the context (its threads, kernel and accuracy mode), with MADV_WILLNEED on the next chunk to overlap I/O and compute
+// Returns NAN if the file cannot be read, 0 for a file without any float (as stream_norm_pread)
+float stream_norm_mmap(const char *path, simdnorm_ctx_t *ctx, size_t chunk, stream_stats_t *stats);
+
+// Same with pread into two buffers: a reader thread fills one while the pool reduces the other
+// direct: open the file with O_DIRECT (bypass the page cache)
+// Short reads are retried until the end of the file: NAN if a read fails, never the norm of a part of the file
+float stream_norm_pread(const char *path, simdnorm_ctx_t *ctx, size_t chunk, int direct, stream_stats_t *stats);
+
+// Read the whole file without computing anything, to get the raw bandwidth of the disk
+int stream_read_only(const char *path, size_t chunk, int direct, stream_stats_t *stats);
+
+// Drop the pages of the file from the page cache, so that the next run really reads the disk
+void stream_evict(const char *path);
+
+#endif //STREAM_H
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+
+#include "perf.h"
+#include "threadpool.h"
+
+// to be passed to each worker
+typedef struct {
+    threadpool_t *pool;
+    unsigned int worker;
+} workerarg_t;
+
+// Main loop of each worker: park until a new generation is published, run the job, signal the barrier
+static void *worker_routine(workerarg_t *wargs) {
+    threadpool_t *pool = wargs->pool;
+    unsigned int worker = wargs->worker;
+    unsigned long seen = 0;
+
+    free(wargs);
+    PERF_WORKER(pool->perf, worker);
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        // We sleep until something new is published (the loop handles spurious wake ups)
+        while (pool->generation == seen && !pool->stop)
+            pthread_cond_wait(&pool->start, &pool->lock);
+
+        if (pool->stop)
+            break;
+
+        seen = pool->generation;
+        pool_job_t job = pool->job;
+        void *args = pool->args;
+#ifdef SIMDNORM_PERF
+        perf_add_time(PERF_SPAWN, perf_now() - pool->published);
+#endif
+
+        // The job itself is run without holding the lock
+        pthread_mutex_unlock(&pool->lock);
+        PERF_BEGIN(PERF_COMPUTE);
+        job(args, worker);
+        PERF_END(PERF_COMPUTE);
+        pthread_mutex_lock(&pool->lock);
+
+        // Last one to finish wakes up the thread waiting in pool_run
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    PERF_THREAD_EXIT();
+
+    return NULL;
+}
+
+// Stop and join the workers [1, nb_started) and free the pool
+static void pool_stop(threadpool_t *pool, unsigned int nb_started) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    // A join can only fail on a thread which was never started: there are none here
+    for (unsigned int i = 1; i < nb_started; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+
+#ifdef SIMDNORM_PERF
+    perf_totals_destroy(pool->perf);
+#endif
+
+    free(pool->threads);
+    free(pool);
+}
+
+threadpool_t *pool_create(unsigned int nb_thread) {
+    if (nb_thread == 0)
+        nb_thread = 1;
+
+    threadpool_t *pool = (threadpool_t *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE * ((sizeof(threadpool_t) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE));
+    if (pool == NULL)
+        return NULL;
+
+    pool->nb_thread = nb_thread;
+    pool->threads = (pthread_t *) malloc(sizeof(pthread_t) * nb_thread);
+    if (pool->threads == NULL) {
+        free(pool);
+        return NULL;
+    }
+    pool->job = NULL;
+    pool->args = NULL;
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->stop = 0;
+#ifdef SIMDNORM_PERF
+    // Without its table the pool still works, its calls are just not counted
+    pool->perf = perf_totals_create(nb_thread);
+#endif
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    // Worker 0 is the caller of pool_run, we only spawn the others
+    // The first failure stops everything: the workers already started are joined
+    for (unsigned int i = 1; i < nb_thread; i++) {
+        workerarg_t *wargs = (workerarg_t *) malloc(sizeof(workerarg_t));
+        if (wargs == NULL) {
+            pool_stop(pool, i);
+            return NULL;
+        }
+        wargs->pool = pool;
+        wargs->worker = i;
+
+        if (pthread_create(&pool->threads[i], NULL, (void *(*)(void *)) worker_routine, wargs) != 0) {
+            free(wargs);
+            pool_stop(pool, i);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void pool_run(threadpool_t *pool, pool_job_t job, void *args) {
+    PERF_WORKER(pool->perf, 0);
+
+    if (pool->nb_thread > 1) {
+        PERF_BEGIN(PERF_SPAWN);
+
+        // We publish the job descriptor and wake everybody up
+        pthread_mutex_lock(&pool->lock);
+        pool->job = job;
+        pool->args = args;
+        pool->pending = pool->nb_thread - 1;
+        pool->generation++;
+#ifdef SIMDNORM_PERF
+        pool->published = perf_now();
+#endif
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+
+        PERF_END(PERF_SPAWN);
+    }
+
+    // Share of the calling thread
+    PERF_BEGIN(PERF_COMPUTE);
+    job(args, 0);
+    PERF_END(PERF_COMPUTE);
+
+    if (pool->nb_thread > 1) {
+        PERF_BEGIN(PERF_JOIN);
+
+        // Completion barrier: we wait for the other workers
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending != 0)
+            pthread_cond_wait(&pool->done, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+
+        PERF_END(PERF_JOIN);
+    }
+}
+
+perf_totals_t *pool_perf(threadpool_t *pool) {
+#ifdef SIMDNORM_PERF
+    return pool->perf;
+#else
+    (void) pool;
+    return NULL;
+#endif
+}
+
+void pool_destroy(threadpool_t *pool) {
+    pool_stop(pool, pool->nb_thread);
+}
@@ -0,0 +1,59 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+
+#include "perf.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Job executed by every member of the pool: args is the job descriptor published by pool_run
+// and worker the index of the member executing it (0 is the thread calling pool_run)
+typedef void (*pool_job_t)(void *args, unsigned int worker);
+
+// Persistent pool of nb_thread-1 workers, the thread calling pool_run acts as worker 0
+typedef struct {
+    pthread_t *threads;
+    unsigned int nb_thread;
+
+    // Parking lot of the workers: they sleep on start until generation changes
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+
+    // Job currently published
+    pool_job_t job;
+    void *args;
+
+    // Incremented each time a job is published, tells the workers there is something new to do
+    unsigned long generation;
+    // Number of workers which have not finished the current job yet (completion barrier)
+    unsigned int pending;
+    // Set when the pool is destroyed
+    int stop;
+
+#ifdef SIMDNORM_PERF
+    // Time at which the current job was published (spawn phase of perf.h)
+    double published;
+    // Counters of the workers of this pool only
+    perf_totals_t *perf;
+#endif
+} threadpool_t;
+
+// Start the workers once, they stay parked until a job is published
+// NULL if an allocation or a thread creation failed (the workers already started are stopped)
+threadpool_t *pool_create(unsigned int nb_thread);
+
+// Publish a job, run its share in the calling thread and wait until every worker is done
+void pool_run(threadpool_t *pool, pool_job_t job, void *args);
+
+// Totals of the counters of the pool (perf.h), NULL without SIMDNORM_PERF
+perf_totals_t *pool_perf(threadpool_t *pool);
+
+// Wake up the workers to let them exit, join them and free the pool
+void pool_destroy(threadpool_t *pool);
+
+#endif //THREADPOOL_H
@@ -0,0 +1,502 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "harness.h"
+#include "tune.h"
+
+static const char *variant_names[TUNE_VARIANTS] = {"scalar", "sse2", "avx2x1", "avx2x2", "avx2x4", "avx2x8", "avx512"};
+static const kernel_fn_t variant_fns[TUNE_VARIANTS] = {norm, vect_norm_sse2, vect_norm_avx2_x1, vect_norm_avx2_x2,
+                                                       vect_norm_avx2_x4, vect_norm_avx2_x8, vect_norm_avx512};
+// ISA needed by each variant
+static const int variant_kernels[TUNE_VARIANTS] = {KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2, KERNEL_AVX2, KERNEL_AVX2,
+                                                   KERNEL_AVX2, KERNEL_AVX512};
+
+// REDUCE_* then TUNE_DIRECT
+static const char *reduction_names[5] = {"lockfree", "tree", "join", "steal", "direct"};
+
+const char *tune_variant_name(int variant) {
+    return (variant >= 0 && variant < TUNE_VARIANTS) ? variant_names[variant] : "unknown";
+}
+
+int tune_variant_from_name(const char *name) {
+    for (int v = 0; v < TUNE_VARIANTS; v++)
+        if (strcmp(name, variant_names[v]) == 0)
+            return v;
+
+    return -1;
+}
+
+const char *tune_reduction_name(int reduction) {
+    return (reduction >= 0 && reduction <= TUNE_DIRECT) ? reduction_names[reduction] : "unknown";
+}
+
+int tune_reduction_from_name(const char *name) {
+    for (int r = 0; r <= TUNE_DIRECT; r++)
+        if (strcmp(name, reduction_names[r]) == 0)
+            return r;
+
+    return -1;
+}
+
+// Model name of /proc/cpuinfo: a profile is only valid on the CPU it was made on
+static void cpu_model(char *cpu, size_t size) {
+    char line[256];
+    FILE *f = fopen("/proc/cpuinfo", "r");
+
+    snprintf(cpu, size, "unknown");
+    if (f == NULL)
+        return;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char *value = strchr(line, ':');
+            if (value != NULL) {
+                value += (value[1] == ' ') ? 2 : 1;
+                value[strcspn(value, "\n")] = '\0';
+                snprintf(cpu, size, "%s", value);
+            }
+            break;
+        }
+    }
+
+    fclose(f);
+}
+
+// Size class of N: the nearest probed size (in log scale)
+static unsigned int size_class(size_t N) {
+    unsigned int lg = 0;
+    while (lg < 63 && ((size_t) 2 << lg) <= N)
+        lg++;
+
+    if (lg <= TUNE_MIN_LOG)
+        return 0;
+
+    unsigned int k = (lg - TUNE_MIN_LOG + 1) / 2;
+    return k < TUNE_CLASSES ? k : TUNE_CLASSES - 1;
+}
+
+// Variant of the kernel selected without tuning (kernel_current, AVX2_UNROLL accumulators for AVX2)
+static int default_variant() {
+    switch (kernel_current()) {
+        case KERNEL_AVX512:
+            return TUNE_AVX512;
+        case KERNEL_AVX2:
+            return AVX2_UNROLL == 1 ? TUNE_AVX2_X1 : AVX2_UNROLL == 2 ? TUNE_AVX2_X2 :
+                   AVX2_UNROLL == 8 ? TUNE_AVX2_X8 : TUNE_AVX2_X4;
+        case KERNEL_SSE2:
+            return TUNE_SSE2;
+        default:
+            return TUNE_SCALAR;
+    }
+}
+
+// Profile without any measure: every class on the calling thread with the default kernel
+static void default_choices(tune_t *tune) {
+    tune_choice_t c = {1, TUNE_DIRECT, default_variant(), 0};
+
+    for (unsigned int k = 0; k < TUNE_CLASSES; k++)
+        tune->choices[k] = c;
+}
+
+// NULL if the threads cannot be started
+static simdnorm_ctx_t *context(tune_t *tune, unsigned int nb_thread) {
+    for (unsigned int i = 0; i < tune->nb_ctx; i++)
+        if (simdnorm_nb_thread(tune->ctx[i]) == nb_thread)
+            return tune->ctx[i];
+
+    simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+    if (ctx == NULL)
+        return NULL;
+
+    // Full: the last one started makes room (only happens with overrides)
+    if (tune->nb_ctx == TUNE_CONTEXTS)
+        simdnorm_destroy(tune->ctx[--tune->nb_ctx]);
+
+    tune->ctx[tune->nb_ctx] = ctx;
+    return tune->ctx[tune->nb_ctx++];
+}
+
+// TUNE_DIRECT: same blocks and same tree as REDUCE_TREE, on the calling thread
+static float direct(tune_t *tune, kernel_fn_t fn, const float *U, size_t N) {
+    if (N <= REDUCE_BLOCK)
+        return fn((float *) U, N);
+
+    size_t nb_blocks = (N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    if (nb_blocks > tune->partials_capacity) {
+        free(tune->partials);
+        tune->partials = (float *) malloc(sizeof(float) * nb_blocks);
+        tune->partials_capacity = tune->partials != NULL ? nb_blocks : 0;
+    }
+
+    // No room for the partial sums: the blocks are added in double one after the other instead of through the tree
+    if (tune->partials == NULL) {
+        double result = 0;
+        for (size_t begin = 0; begin < N; begin += REDUCE_BLOCK)
+            result += fn((float *) U + begin, (N - begin < REDUCE_BLOCK) ? N - begin : REDUCE_BLOCK);
+        return (float) result;
+    }
+
+    for (size_t b = 0; b < nb_blocks; b++) {
+        size_t begin = b * REDUCE_BLOCK;
+        size_t size = (N - begin < REDUCE_BLOCK) ? N - begin : REDUCE_BLOCK;
+        tune->partials[b] = fn((float *) U + begin, size);
+    }
+
+    return reduce_tree(tune->partials, nb_blocks, COMBINE_SUM);
+}
+
+static void stop_contexts(tune_t *tune) {
+    for (unsigned int i = 0; i < tune->nb_ctx; i++)
+        simdnorm_destroy(tune->ctx[i]);
+    tune->nb_ctx = 0;
+}
+
+// =============================================================== \\
+// Probe
+
+typedef struct {
+    tune_t *tune;
+    kernel_fn_t fn;
+    simdnorm_ctx_t *ctx;
+    float *U;
+    size_t N;
+    volatile float result;
+} probe_call_t;
+
+static void probe_direct(probe_call_t *c) {
+    c->result = direct(c->tune, c->fn, c->U, c->N);
+}
+
+static void probe_pool(probe_call_t *c) {
+    c->result = simdnorm_l1sqrt(c->ctx, c->U, c->N);
+}
+
+// Number of threads probed after nb_thread: the next power of 2, max_thread after the last one below it
+static unsigned int next_probed(unsigned int nb_thread, unsigned int max_thread) {
+    if (nb_thread == max_thread)
+        return max_thread + 1;
+
+    return nb_thread * 2 <= max_thread ? nb_thread * 2 : max_thread;
+}
+
+int tune_probe(tune_t *tune, double budget) {
+    stop_contexts(tune);
+
+    size_t max_N = (size_t) 1 << TUNE_MAX_LOG;
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * max_N);
+    if (U == NULL)
+        return -1;
+    prng_fill(U, max_N, PRNG_UNIFORM, -1.0f, 1.0f, 1, 0, kernel_current() >= KERNEL_AVX2);
+
+    // Warm cache: the calls of an application on the same array one after the other
+    harness_config_t config = {1, 1000, 3, budget, NULL, 0};
+    harness_result_t r;
+
+    // Each variant alone on one thread, the best one is then used with more threads too
+    for (unsigned int k = 0; k < TUNE_CLASSES; k++) {
+        probe_call_t c = {tune, NULL, NULL, U, (size_t) 1 << (TUNE_MIN_LOG + 2 * k), 0};
+        tune_choice_t best = {1, TUNE_DIRECT, TUNE_SCALAR, 0};
+
+        for (int v = 0; v < TUNE_VARIANTS; v++) {
+            if (!kernel_supported(variant_kernels[v]))
+                continue;
+
+            c.fn = variant_fns[v];
+            harness_measure((harness_fn_t) probe_direct, &c, &config, &r);
+            if (best.seconds == 0 || r.seconds.median < best.seconds) {
+                best.variant = v;
+                best.seconds = r.seconds.median;
+            }
+        }
+
+        tune->choices[k] = best;
+    }
+
+    // 2, 4, 8... threads, then max_thread itself if it is not a power of 2, every reduction
+    unsigned int max_thread = tune->max_thread;
+    for (unsigned int nb_thread = 2; nb_thread <= max_thread; nb_thread = next_probed(nb_thread, max_thread)) {
+        simdnorm_ctx_t *ctx = simdnorm_create(nb_thread);
+
+        // These threads cannot be started: the classes keep what was measured with fewer
+        if (ctx == NULL)
+            break;
+
+        for (unsigned int k = 0; k < TUNE_CLASSES; k++) {
+            tune_choice_t *best = &tune->choices[k];
+            probe_call_t c = {tune, NULL, ctx, U, (size_t) 1 << (TUNE_MIN_LOG + 2 * k), 0};
+            int variant = best->variant;
+
+            simdnorm_set_kernel(ctx, variant_kernels[variant]);
+            ctx->fn = variant_fns[variant];
+
+            for (int reduction = REDUCE_LOCKFREE; reduction <= REDUCE_STEAL; reduction++) {
+                simdnorm_set_reduction(ctx, reduction);
+                harness_measure((harness_fn_t) probe_pool, &c, &config, &r);
+
+                if (r.seconds.median < best->seconds) {
+                    tune_choice_t choice = {nb_thread, reduction, variant, r.seconds.median};
+                    *best = choice;
+                }
+            }
+        }
+
+        simdnorm_destroy(ctx);
+    }
+
+    free(U);
+    tune->probed = 1;
+
+    return 0;
+}
+
+// =============================================================== \\
+// Profile file
+
+int tune_save(const tune_t *tune, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+        return -1;
+
+    fprintf(f, "# simdnorm tuning profile: size threads reduction kernel seconds\n");
+    fprintf(f, "cpu %s\n", tune->cpu);
+    fprintf(f, "max_thread %u\n", tune->max_thread);
+    for (unsigned int k = 0; k < TUNE_CLASSES; k++) {
+        const tune_choice_t *c = &tune->choices[k];
+        fprintf(f, "%zu %u %s %s %e\n", (size_t) 1 << (TUNE_MIN_LOG + 2 * k), c->nb_thread,
+                tune_reduction_name(c->reduction), tune_variant_name(c->variant), c->seconds);
+    }
+
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+int tune_load(tune_t *tune, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+
+    char line[256];
+    tune_choice_t choices[TUNE_CLASSES];
+    unsigned int found = 0;
+    int ok = 1;
+
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (line[0] == '#' || line[0] == '\0')
+            continue;
+
+        if (strncmp(line, "cpu ", 4) == 0) {
+            ok = strcmp(line + 4, tune->cpu) == 0;
+            continue;
+        }
+
+        unsigned int max_thread;
+        if (sscanf(line, "max_thread %u", &max_thread) == 1) {
+            ok = max_thread == tune->max_thread;
+            continue;
+        }
+
+        size_t size;
+        char reduction[32], variant[32];
+        tune_choice_t c;
+        if (sscanf(line, "%zu %u %31s %31s %le", &size, &c.nb_thread, reduction, variant, &c.seconds) != 5 ||
+            found >= TUNE_CLASSES || size != (size_t) 1 << (TUNE_MIN_LOG + 2 * found)) {
+            ok = 0;
+            break;
+        }
+
+        c.reduction = tune_reduction_from_name(reduction);
+        c.variant = tune_variant_from_name(variant);
+        ok = c.reduction >= 0 && c.variant >= 0 && kernel_supported(variant_kernels[c.variant]) &&
+             c.nb_thread >= 1 && c.nb_thread <= tune->max_thread && (c.reduction == TUNE_DIRECT) == (c.nb_thread == 1);
+        choices[found++] = c;
+    }
+
+    fclose(f);
+
+    if (!ok || found != TUNE_CLASSES)
+        return -1;
+
+    memcpy(tune->choices, choices, sizeof(choices));
+    tune->probed = 0;
+    stop_contexts(tune);
+
+    return 0;
+}
+
+// =============================================================== \\
+// Overrides
+
+int tune_override(tune_t *tune, int nb_thread, int reduction, int variant) {
+    if (nb_thread == 0 || nb_thread < -1 || reduction < -1 || reduction > TUNE_DIRECT || variant < -1 ||
+        variant >= TUNE_VARIANTS || (variant >= 0 && !kernel_supported(variant_kernels[variant])))
+        return -1;
+
+    tune->force_thread = nb_thread;
+    tune->force_reduction = reduction;
+    tune->force_variant = variant;
+
+    return 0;
+}
+
+int tune_override_string(tune_t *tune, const char *s) {
+    int nb_thread = tune->force_thread, reduction = tune->force_reduction, variant = tune->force_variant;
+
+    char *copy = strdup(s);
+    char *save = NULL;
+    int ok = 1;
+
+    for (char *item = strtok_r(copy, ",", &save); ok && item != NULL; item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '=');
+        if (value == NULL) {
+            ok = 0;
+            break;
+        }
+        *value++ = '\0';
+
+        if (strcmp(item, "threads") == 0) {
+            nb_thread = atoi(value);
+            ok = nb_thread > 0;
+        } else if (strcmp(item, "reduction") == 0) {
+            reduction = tune_reduction_from_name(value);
+            ok = reduction >= 0;
+        } else if (strcmp(item, "kernel") == 0) {
+            variant = tune_variant_from_name(value);
+            ok = variant >= 0;
+        } else {
+            ok = 0;
+        }
+    }
+
+    free(copy);
+
+    return ok ? tune_override(tune, nb_thread, reduction, variant) : -1;
+}
+
+// =============================================================== \\
+// Calls
+
+tune_t *tune_create(const char *path, unsigned int max_thread, double budget) {
+    tune_t *tune = (tune_t *) calloc(1, sizeof(tune_t));
+    if (tune == NULL)
+        return NULL;
+
+    if (max_thread == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        max_thread = cpus > 0 ? (unsigned int) cpus : 1;
+    }
+    tune->max_thread = max_thread;
+    tune->force_thread = -1;
+    tune->force_reduction = -1;
+    tune->force_variant = -1;
+    cpu_model(tune->cpu, sizeof(tune->cpu));
+
+    if (path == NULL)
+        path = getenv(TUNE_FILE_ENV) != NULL ? getenv(TUNE_FILE_ENV) : TUNE_FILE;
+
+    // A probe which could not run leaves the defaults, they are not saved: the next run probes again
+    if (tune_load(tune, path) != 0) {
+        if (tune_probe(tune, budget) == 0)
+            tune_save(tune, path);
+        else
+            default_choices(tune);
+    }
+
+    const char *forced = getenv(TUNE_ENV);
+    if (forced != NULL && tune_override_string(tune, forced) != 0)
+        fprintf(stderr, "%s: invalid override \"%s\", ignored\n", TUNE_ENV, forced);
+
+    return tune;
+}
+
+void tune_destroy(tune_t *tune) {
+    stop_contexts(tune);
+    free(tune->partials);
+    free(tune);
+}
+
+tune_choice_t tune_decide(const tune_t *tune, size_t N) {
+    tune_choice_t c = tune->choices[size_class(N)];
+    tune_choice_t tuned = c;
+
+    if (tune->force_variant >= 0)
+        c.variant = tune->force_variant;
+
+    if (tune->force_reduction == TUNE_DIRECT) {
+        c.nb_thread = 1;
+        c.reduction = TUNE_DIRECT;
+    } else {
+        if (tune->force_thread > 0)
+            c.nb_thread = (unsigned int) tune->force_thread;
+        if (tune->force_reduction >= 0)
+            c.reduction = tune->force_reduction;
+
+        // A single thread without a forced reduction goes direct, more threads need one (the default one then)
+        if (c.nb_thread == 1 && tune->force_reduction < 0)
+            c.reduction = TUNE_DIRECT;
+        else if (c.nb_thread > 1 && c.reduction == TUNE_DIRECT)
+            c.reduction = REDUCE_TREE;
+    }
+
+    // The time of the probe only holds for what it measured
+    if (c.nb_thread != tuned.nb_thread || c.reduction != tuned.reduction || c.variant != tuned.variant)
+        c.seconds = 0;
+
+    return c;
+}
+
+float tune_l1sqrt(tune_t *tune, const float *U, size_t N) {
+    tune_choice_t c = tune_decide(tune, N);
+    tune->calls[size_class(N)]++;
+
+    if (c.reduction == TUNE_DIRECT)
+        return direct(tune, variant_fns[c.variant], U, N);
+
+    // Threads which cannot be started: the same kernel on the calling thread
+    simdnorm_ctx_t *ctx = context(tune, c.nb_thread);
+    if (ctx == NULL)
+        return direct(tune, variant_fns[c.variant], U, N);
+
+    if (ctx->fn != variant_fns[c.variant]) {
+        simdnorm_set_kernel(ctx, variant_kernels[c.variant]);
+        ctx->fn = variant_fns[c.variant];
+    }
+    simdnorm_set_reduction(ctx, c.reduction);
+
+    return simdnorm_l1sqrt(ctx, U, N);
+}
+
+void tune_report(const tune_t *tune, FILE *out) {
+    fprintf(out, "Profile: %s, up to %u threads, %s\n", tune->cpu, tune->max_thread,
+            tune->probed ? "probed now" : "read from the file");
+
+    if (tune->force_thread > 0 || tune->force_reduction >= 0 || tune->force_variant >= 0) {
+        fprintf(out, "Overrides:");
+        if (tune->force_thread > 0)
+            fprintf(out, " threads=%d", tune->force_thread);
+        if (tune->force_reduction >= 0)
+            fprintf(out, " reduction=%s", tune_reduction_name(tune->force_reduction));
+        if (tune->force_variant >= 0)
+            fprintf(out, " kernel=%s", tune_variant_name(tune->force_variant));
+        fprintf(out, "\n");
+    } else {
+        fprintf(out, "Overrides: none\n");
+    }
+
+    fprintf(out, "size, from, to, threads, reduction, kernel, probed median s, calls\n");
+    for (unsigned int k = 0; k < TUNE_CLASSES; k++) {
+        size_t size = (size_t) 1 << (TUNE_MIN_LOG + 2 * k);
+        size_t from = k == 0 ? 0 : size >> 1;
+        tune_choice_t c = tune_decide(tune, size);
+
+        fprintf(out, "%zu, %zu, ", size, from);
+        if (k == TUNE_CLASSES - 1)
+            fprintf(out, "-, ");
+        else
+            fprintf(out, "%zu, ", (size << 1) - 1);
+        fprintf(out, "%u, %s, %s, %e, %llu\n", c.nb_thread, tune_reduction_name(c.reduction),
+                tune_variant_name(c.variant), c.seconds, tune->calls[k]);
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <stdio.h>
+
+#include "simdnorm.h"
+
+// Autotuner: the best number of threads, reduction (how the array is cut between them) and kernel depend on N and
+// on the machine (2 threads lose against 1 below some size, the unrolling which wins in the L1 cache is not the one
+// which wins in DRAM...). The machine is probed once, the profile is saved in a file and every call then picks its
+// settings from N
+
+// Variants of the kernel: every ISA, and the AVX2 one with 1, 2, 4 or 8 accumulators
+#define TUNE_SCALAR 0
+#define TUNE_SSE2 1
+#define TUNE_AVX2_X1 2
+#define TUNE_AVX2_X2 3
+#define TUNE_AVX2_X4 4
+#define TUNE_AVX2_X8 5
+#define TUNE_AVX512 6
+#define TUNE_VARIANTS 7
+
+// Reduction of a single thread: the kernel is called by the calling thread, no pool at all (after the REDUCE_* of
+// reduce.h). Above REDUCE_BLOCK floats it still goes block by block with the tree of REDUCE_TREE: one float sum over
+// 16M floats drifts by 1E-4, and this way the result is the one of REDUCE_TREE with the same kernel
+#define TUNE_DIRECT 4
+
+// Sizes probed: 2^TUNE_MIN_LOG, then x4 up to 2^TUNE_MAX_LOG floats (64 MB), one size class each
+// Bigger arrays take the settings of the last class
+#define TUNE_MIN_LOG 8
+#define TUNE_MAX_LOG 24
+#define TUNE_CLASSES ((TUNE_MAX_LOG - TUNE_MIN_LOG) / 2 + 1)
+
+// Profile used when no path is given
+#define TUNE_FILE "simdnorm.tune"
+#define TUNE_FILE_ENV "SIMDNORM_TUNE_FILE"
+
+// Override of the tuned settings, any of "threads=4", "reduction=steal", "kernel=avx2x8", separated by commas
+#define TUNE_ENV "SIMDNORM_TUNE"
+
+// How a size class is run
+typedef struct {
+    unsigned int nb_thread;
+    // REDUCE_* of reduce.h, TUNE_DIRECT with a single thread
+    int reduction;
+    // TUNE_* variant
+    int variant;
+    // Median time of a call measured by the probe (0 if not measured)
+    double seconds;
+} tune_choice_t;
+
+// Contexts started on demand, one per number of threads used
+#define TUNE_CONTEXTS 8
+
+typedef struct {
+    // Largest number of threads probed
+    unsigned int max_thread;
+    char cpu[128];
+
+    tune_choice_t choices[TUNE_CLASSES];
+
+    // Overrides, -1 when tuned
+    int force_thread;
+    int force_reduction;
+    int force_variant;
+
+    // 1 if the profile was probed by tune_create, 0 if it was read from the file
+    int probed;
+
+    simdnorm_ctx_t *ctx[TUNE_CONTEXTS];
+    unsigned int nb_ctx;
+
+    // Partial sums of the blocks of TUNE_DIRECT, only grows
+    float *partials;
+    size_t partials_capacity;
+
+    // Calls made in each class, for the report
+    unsigned long long calls[TUNE_CLASSES];
+} tune_t;
+
+// Read the profile of path (TUNE_FILE_ENV, or TUNE_FILE, if NULL). If it is missing, or made on another CPU or
+// for another max_thread (0: every CPU), the machine is probed (budget: about that many seconds per measure) and
+// the profile is written back. TUNE_ENV is applied on top
+// If the probe cannot run (no memory for its array) every class takes the default kernel on the calling thread,
+// and nothing is written. NULL only if the tuner itself cannot be allocated
+tune_t *tune_create(const char *path, unsigned int max_thread, double budget);
+
+void tune_destroy(tune_t *tune);
+
+// Probe every size class again, the contexts are restarted: every power of 2 of threads up to max_thread, and
+// max_thread itself. Returns 0, -1 if the array of the probe cannot be allocated (the profile is left unchanged)
+int tune_probe(tune_t *tune, double budget);
+
+// 0, -1 if the file could not be read / written or does not match this machine (tune_load)
+int tune_load(tune_t *tune, const char *path);
+int tune_save(const tune_t *tune, const char *path);
+
+// Force some settings (-1: keep the tuned one). Returns 0, -1 if one is invalid
+int tune_override(tune_t *tune, int nb_thread, int reduction, int variant);
+
+// Parse an override string as in TUNE_ENV. Returns 0, -1 if it is malformed
+int tune_override_string(tune_t *tune, const char *s);
+
+// Settings used for an array of N floats, overrides included
+tune_choice_t tune_decide(const tune_t *tune, size_t N);
+
+// l1sqrt of U with the settings of N
+float tune_l1sqrt(tune_t *tune, const float *U, size_t N);
+
+// Profile, overrides and calls made in each class
+void tune_report(const tune_t *tune, FILE *out);
+
+const char *tune_variant_name(int variant);
+int tune_variant_from_name(const char *name);
+const char *tune_reduction_name(int reduction);
+int tune_reduction_from_name(const char *name);
+
+#endif //TUNE_H
@@ -3,15 +3,17 @@
 
 #include <immintrin.h>
 #include <math.h>
-#include <errno.h>
-#include <pthread.h>
 #include <time.h>
 
-#define VECT 1
-#define SCALAR 0
+#include "simdnorm.h"
 
 // On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
 #define CACHE_LINE_SIZE 64
+#endif
+
+// Number of calls timed for each (offset, length), we keep the fastest one
+#define REPEAT 5
 
 
 struct timespec diff(struct timespec start, struct timespec end)
@@ -31,38 +33,18 @@ struct timespec diff(struct timespec start, struct timespec end)
     return temp;
 }
 
-
-
-// Classical norm function
-float norm(float *U, long N) {
-    float d=0;
-    for (long i = 0; i < N; i++)
-        d += sqrtf(fabsf(U[i]));
-
-    return d;
-}
-
-
-float vect_norm(float *U, unsigned int N) {
-    // ptr on the array to perform the sum on
+// Previous version of vect_norm: aligned data only, N / 8 full vectors and the remainder dropped
+// Only kept as the reference to check that the peeling / masked tail costs nothing on aligned data
+__attribute__((target("avx2")))
+float aligned_vect_norm(float *U, size_t N) {
     __m256* u_v = (__m256*) U;
-
-    // Accumulator to store 8 partial sums
     __m256 acc = _mm256_set1_ps(0.0f);
-
-    // Used later to sum horitally over the vector
     float *acc_fptr = (float *) &acc;
-
-    // Sign mask to take abs value
     __m256 sign_mask = _mm256_set1_ps(-0.f);
 
-    // We use vector operation to compute the square root and the absolute value
-    // Then we add the vector to the accumulator using vector add
-    // Doing so we gain a x8 in time to compute the sum
-    for (unsigned int i = 0; i < N / 8; i++)
+    for (size_t i = 0; i < N / 8; i++)
         acc = _mm256_add_ps(acc, _mm256_sqrt_ps(_mm256_andnot_ps(sign_mask, u_v[i])));
 
-    // We only have to sum the 8 float in the acc vector
     float result = 0;
     for (unsigned int i = 0; i < 8; i++)
         result += acc_fptr[i];
@@ -70,100 +52,47 @@ float vect_norm(float *U, unsigned int N) {
     return result;
 }
 
-// to be passed to each thread
-typedef struct {
-    // begining of the array to consider
-    float *begin;
-    // Where to store the result of each thread
-    float *result;
-    // size of the considered array
-    long size;
-
-} threadarg_t;
+// Exact enough reference to check the results
+double reference_norm(float *U, size_t N) {
+    double d = 0;
+    for (size_t i = 0; i < N; i++)
+        d += sqrt(fabs((double) U[i]));
 
-// routine used to encapsulate the call to the norm function in each thread
-void norm_routine(threadarg_t* args)
-{
-    // We compute the norm using the given norm function
-    // We store the result at the requested adress
-    *args->result = vect_norm(args->begin, args->size);
-
-    // We terminate the thread
-    pthread_exit(NULL);
+    return d;
 }
 
-float normPar(float *U, long N, unsigned char mode, unsigned  int nb_threads) {
-    // pointer to the norm function to use
-
-
-    // if more than one thread (one thread is actually handle in the main thread / process
-    if (mode == VECT) {
-        // We begin by initializing the argument for each thread
-
-        long elt_per_thread = (long) (N / nb_threads);
-
-        // In case of non aligned data
-        long rem = N % nb_threads;
-
-        threadarg_t *args = (threadarg_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(threadarg_t) * nb_threads);
-
-        pthread_t *pool = (pthread_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(pthread_t) *  (nb_threads-1));
-        float *results = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * nb_threads);
-
-        int errcode = 0;
-
-        for (unsigned int i = 1; i < nb_threads; i++) {
-            // We construct the argument for each thread
-            args[i].begin = &(U[i * elt_per_thread]);
-            args[i].size = elt_per_thread;
-            args[i].result = results+i;
-
-            // We create the thread
-            errcode += (int) pthread_create(&pool[i], NULL, (void* (*)(void*)) norm_routine, &args[i]);
-
-        }
-
-        if (errcode != 0) {
-            printf("Something went wrong with thread creation");
-            exit(1);
-        }
-
-        // Computations in the main thread
-        // We direclty store it in our result variable
-        float r = vect_norm(U, elt_per_thread);
+// Context of libsimdnorm used by normPar (deterministic tree reduction)
+static simdnorm_ctx_t *ctx = NULL;
 
-        errcode = 0;
-
-        for (unsigned i = 1; i < nb_threads; i++) {
-
-            errcode += pthread_join(pool[i], NULL);
+float normPar(float *U, size_t N, unsigned int nb_threads) {
+    if (ctx == NULL || simdnorm_nb_thread(ctx) != nb_threads) {
+        if (ctx != NULL)
+            simdnorm_destroy(ctx);
+        ctx = simdnorm_create(nb_threads);
+    }
 
-            // When the threads end, we retrieve their result and add it into the result variable
-            r += results[i];
+    // The blocks of the reducer start anywhere in U, the kernels handle both the offsets and the tails
+    return simdnorm_l1sqrt(ctx, U, N);
+}
 
-        }
+// Fastest of REPEAT calls to normPar, in seconds, the result of the last call is stored in result
+double time_normPar(float *U, size_t N, unsigned int nb_threads, float *result) {
+    double best = 1E9;
 
-        // Check if the joins succeded
-        if (errcode != 0) {
-            printf("Something went wront with thread join");
-            exit(1);
-        }
+    for (unsigned int r = 0; r < REPEAT; r++) {
+        struct timespec begining, end;
+        clock_gettime(CLOCK_MONOTONIC, &begining);
 
-        // Free our memory
-        free(pool);
-        free(args);
-        free(results);
+        *result = normPar(U, N, nb_threads);
 
-        return r;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        struct timespec t = diff(begining, end);
+        double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+        if (d < best)
+            best = d;
     }
-    else {
-        // Single thread: just call the wanted function on the array
-        float result = norm(U, N);
 
-        // Return the result
-        return result;
-
-    }
+    return best;
 }
 
 
@@ -178,68 +107,88 @@ int main(int argc, char *argv[]) {
     // init random seed
     srand((unsigned int)time(NULL));
 
-    // Get number of elements
-    unsigned N = (unsigned int) atoi(argv[1]);
+    // Get number of elements, rounded to a multiple of 8: the sweep adds 0 to 7 floats to it
+    size_t N = ((size_t) strtoull(argv[1], NULL, 10)) & ~(size_t) 7;
 
     // Get number of threads
     unsigned int nb_thread = (unsigned int) atoi(argv[2]);
 
-    // We allocate our array
-    // We align our array: it has 2 purposes: first it optimizes the cache
-    // and it guarantees us that the data are well aligned for the vectorial instructions
-    // since my cache line is 64
-    float* U = (float*) aligned_alloc(CACHE_LINE_SIZE, sizeof(float)*N);
+    // We allocate room for the largest offset and the largest tail
+    float* U = (float*) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * (N + 16));
 
     // Initialization
-    for (long i = 0; i < N; i++)
+    for (size_t i = 0; i < N + 16; i++)
         U[i] = ((float)rand()/(float)(RAND_MAX));
         //U[i] = 1.0f; // To easily check the correctness of the output
 
-    // Use to store the result
-    float result;
-
     // =============================================================== \\
-    // Test of the classical method on a single thread
-
-    struct timespec begining_classic;
-    clock_gettime(CLOCK_REALTIME, &begining_classic);
-
-    result = normPar(U, N, SCALAR, 1);
-
-    struct timespec end_classic;
-    clock_gettime(CLOCK_REALTIME, &end_classic);
+    // Aligned data: the previous kernel against each kernel available on this CPU, on one thread
+
+    // volatile: the result of the previous kernel is never used, we do not want the call to be removed
+    volatile float result;
+    double t_old = 1E9;
+
+    for (unsigned int r = 0; r < REPEAT; r++) {
+        struct timespec begining, end, t;
+
+        clock_gettime(CLOCK_MONOTONIC, &begining);
+        result = aligned_vect_norm(U, N);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        t = diff(begining, end);
+        double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+        if (d < t_old)
+            t_old = d;
+    }
 
     printf("%e\n", result);
+    printf("Aligned only vectorized norm (avx2), 1 thread: %e\n", t_old);
 
-    // =============================================================== \\
-    // Test of the vectoriel method multithreaded
-    struct timespec begining_vect_thread;
-    clock_gettime(CLOCK_REALTIME, &begining_vect_thread);
+    int selected = kernel_current();
 
-    result = normPar(U, N, VECT, nb_thread);
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (!kernel_supported(k))
+            continue;
 
-    struct timespec end_vect_thread;
-    clock_gettime(CLOCK_REALTIME, &end_vect_thread);
+        kernel_select(k);
 
+        double t_new = 1E9;
+        for (unsigned int r = 0; r < REPEAT; r++) {
+            struct timespec begining, end, t;
 
-    printf("%e\n", result);
+            clock_gettime(CLOCK_MONOTONIC, &begining);
+            result = vect_norm(U, N);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            t = diff(begining, end);
+            double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+            if (d < t_new)
+                t_new = d;
+        }
 
-    printf("%e\n", result);
+        printf("%e\n", result);
+        printf("Any alignment vectorized norm (%s), 1 thread: %e\n", kernel_name(k), t_new);
+    }
+
+    // The sweep uses the kernel picked at startup (or forced with SIMDNORM_KERNEL)
+    kernel_select(selected);
 
     // =============================================================== \\
-    // Execution time comparison
+    // Sweep over the offsets (in floats) and the lengths not divisible by 8
 
-    struct timespec classic = diff(begining_classic, end_classic);
-    struct timespec vect = diff(begining_vect_thread, end_vect_thread);
+    printf("offset, length, time, result, relative error, %d thread, %s\n", nb_thread, kernel_name(kernel_current()));
+    for (unsigned int offset = 0; offset < 8; offset++) {
+        for (unsigned int tail = 0; tail < 8; tail++) {
+            size_t n = N + tail;
 
-    double d1 = (double) (classic.tv_sec * 1000000000l + classic.tv_nsec) * 1E-9;
-    double d2 = (double) (vect.tv_sec * 1000000000l + vect.tv_nsec) * 1E-9;
+            float r;
+            double t = time_normPar(U + offset, n, nb_thread, &r);
+            double ref = reference_norm(U + offset, n);
 
+            printf("%u, %zu, %e, %e, %e\n", offset, n, t, r, fabs((double) r - ref) / ref);
+        }
+    }
 
-    printf("Usual scalar norm, 1 thread: %e\n", d1);
-    printf("Vectorized norm, %d thread: %e\n", nb_thread, d2);
+    simdnorm_destroy(ctx);
 
-    printf("Speedup x%0.1f\n", d1 / d2);
     // free our memory
     free(U);
 
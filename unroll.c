@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <immintrin.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#include "kernels.h"
+
+// On my machine a cache line is 64 bytes long
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Each measure repeats the calls during at least this time (in seconds), we keep the fastest call
+#define MIN_DURATION 0.1
+
+
+struct timespec diff(struct timespec start, struct timespec end)
+{
+    struct timespec temp;
+
+    if (end.tv_nsec-start.tv_nsec<0)
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec-1;
+        temp.tv_nsec = 1000000000+end.tv_nsec-start.tv_nsec;
+    }
+    else
+    {
+        temp.tv_sec = end.tv_sec-start.tv_sec;
+        temp.tv_nsec = end.tv_nsec-start.tv_nsec;
+    }
+    return temp;
+}
+
+typedef float (*kernel_t)(float *U, size_t N);
+
+// Fastest call of kernel on U, in seconds and in TSC cycles
+void measure(kernel_t kernel, float *U, size_t N, double *seconds, double *cycles) {
+    double total = 0;
+    *seconds = 1E9;
+    *cycles = 1E18;
+
+    // volatile: we do not want the calls to be removed
+    volatile float result;
+
+    // Warmup: the data is brought in the cache level we want to measure
+    result = kernel(U, N);
+
+    while (total < MIN_DURATION) {
+        struct timespec begining, end;
+        clock_gettime(CLOCK_MONOTONIC, &begining);
+        unsigned long long c0 = __rdtsc();
+
+        result = kernel(U, N);
+
+        unsigned long long c1 = __rdtsc();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        struct timespec t = diff(begining, end);
+        double d = (double) (t.tv_sec * 1000000000l + t.tv_nsec) * 1E-9;
+
+        total += d;
+        if (d < *seconds)
+            *seconds = d;
+        if ((double) (c1 - c0) < *cycles)
+            *cycles = (double) (c1 - c0);
+    }
+
+    (void) result;
+}
+
+// Size of a cache level in bytes, with a default value if the system does not know it
+long cache_size(int name, long fallback) {
+    long size = sysconf(name);
+    return size > 0 ? size : fallback;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    if (!kernel_supported(KERNEL_AVX2)) {
+        printf("This benchmark needs AVX2");
+        exit(1);
+    }
+
+    // Half of each cache level, so that the array stays in it, and 8 times the last level for the DRAM
+    long l1 = cache_size(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+    long l2 = cache_size(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024);
+    long l3 = cache_size(_SC_LEVEL3_CACHE_SIZE, 16 * 1024 * 1024);
+
+    const char *levels[4] = {"L1", "L2", "L3", "DRAM"};
+    size_t sizes[4] = {
+            (size_t) l1 / 2 / sizeof(float),
+            (size_t) l2 / 2 / sizeof(float),
+            (size_t) l3 / 2 / sizeof(float),
+            (size_t) l3 * 8 / sizeof(float)
+    };
+
+    // We keep the DRAM size under 1 GB, it can also be given on the command line
+    if (sizes[3] > ((size_t) 1 << 28))
+        sizes[3] = (size_t) 1 << 28;
+    if (argc > 1)
+        sizes[3] = (size_t) strtoull(argv[1], NULL, 10);
+
+    kernel_t kernels[4] = {vect_norm_avx2_x1, vect_norm_avx2_x2, vect_norm_avx2_x4, vect_norm_avx2_x8};
+    unsigned int nb_acc[4] = {1, 2, 4, 8};
+
+    float *U = (float *) aligned_alloc(CACHE_LINE_SIZE, sizeof(float) * sizes[3]);
+
+    // Initialization
+    for (size_t i = 0; i < sizes[3]; i++)
+        U[i] = ((float) rand() / (float) (RAND_MAX));
+
+    printf("level, N, accumulators, GB/s, TSC cycles/element\n");
+    for (int l = 0; l < 4; l++) {
+        for (int k = 0; k < 4; k++) {
+            double seconds, cycles;
+            measure(kernels[k], U, sizes[l], &seconds, &cycles);
+
+            printf("%s, %zu, %u, %0.2f, %0.3f\n", levels[l], sizes[l], nb_acc[k],
+                   (double) sizes[l] * sizeof(float) / seconds * 1E-9, cycles / sizes[l]);
+        }
+    }
+
+    // free our memory
+    free(U);
+
+
+    return 0;
+}